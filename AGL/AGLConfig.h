@@ -7,3 +7,12 @@
         #define AGL_API __attribute__((visibility("default")))
     #endif
 #endif
+
+// SSE2 code paths, available on every x64 target
+#ifndef AGL_SSE
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define AGL_SSE 1
+    #else
+        #define AGL_SSE 0
+    #endif
+#endif
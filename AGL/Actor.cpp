@@ -1,5 +1,6 @@
 #include "Actor.h"
 #include <rpp/debugging.h>
+#include <cmath>
 #include "OpenGL.h"
 
 namespace AGL
@@ -21,26 +22,144 @@ namespace AGL
         if (auto err = AGL::glGetErrorStr()) LogError("%s failed: %s", what, err); \
     } while (false)
 
+    uint32_t Actor::ShaderFeatures() const
+    {
+        uint32_t features = sf_AlphaTest;
+        if (Mat.texture)             features |= sf_HasTexture;
+        if (Mesh.hasAttrib(a_Color)) features |= sf_VertexColor;
+        if (Mesh.instanced())        features |= sf_Instanced;
+        return features;
+    }
+
+    bool Actor::Opaque() const
+    {
+        if (Mat.color.a < 1.0f)
+            return false;
+        const Texture* texture = Mat.texture ? Mat.texture.texture : nullptr;
+        return !texture || texture->channels() != 4;
+    }
+
+    void Actor::GenerateLods(const void* vertices, int numVertices, const index_t* indices, int numIndices,
+                             const VertexDescr& layout, int maxLods, float firstScreenSize)
+    {
+        Lods.clear();
+        CurrentLod = 0;
+        LodRadius  = 0.0f;
+
+        int offset = 0, i = 0;
+        for (; i < 4 && layout.items[i].size; offset += layout.items[i++].bytes())
+            if (layout.items[i].attr == a_Position) break;
+        if (i == 4 || layout.items[i].attr != a_Position || layout.items[i].type != vt_Float
+                   || layout.items[i].size < 3) {
+            LogWarning("Actor::GenerateLods %s: requires float xyz a_Position", NodeName.c_str());
+            return;
+        }
+        const float* positions = (const float*)((const char*)vertices + offset);
+        auto position = [&](int v) { return (const float*)((const char*)positions + (size_t)v * layout.sizeOf); };
+
+        Vector3 min = { +1e30f, +1e30f, +1e30f }, max = { -1e30f, -1e30f, -1e30f };
+        for (int v = 0; v < numVertices; ++v)
+        {
+            const float* p = position(v);
+            min = { std::min(min.x, p[0]), std::min(min.y, p[1]), std::min(min.z, p[2]) };
+            max = { std::max(max.x, p[0]), std::max(max.y, p[1]), std::max(max.z, p[2]) };
+        }
+        LodCenter = { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+        for (int v = 0; v < numVertices; ++v)
+        {
+            const float* p = position(v);
+            const float dx = p[0] - LodCenter.x, dy = p[1] - LodCenter.y, dz = p[2] - LodCenter.z;
+            LodRadius = std::max(LodRadius, sqrtf(dx*dx + dy*dy + dz*dz));
+        }
+
+        vector<index_t> chain { indices, indices + numIndices };
+        vector<MeshLod> lods = MeshOptimizer::generateLods(chain, positions, layout.sizeOf, numVertices, maxLods + 1);
+
+        // every LOD gets its own compacted copy of the vertices it still references
+        vector<char> lodVertices;
+        vector<index_t> lodIndices;
+        float screenSize = firstScreenSize;
+        for (size_t l = 1; l < lods.size(); ++l, screenSize *= 0.5f)
+        {
+            // a level collapsed to nothing would make the actor vanish, coarser ones are empty too
+            if (lods[l].numIndices == 0)
+                break;
+            lodVertices.assign((const char*)vertices, (const char*)vertices + (size_t)numVertices * layout.sizeOf);
+            const index_t* first = chain.data() + lods[l].firstIndex;
+            lodIndices.assign(first, first + lods[l].numIndices);
+            const int used = MeshOptimizer::optimizeVertexFetch(lodVertices.data(), numVertices, layout.sizeOf,
+                                                                lodIndices.data(), (int)lodIndices.size());
+            Lods.emplace_back();
+            ActorLod& lod = Lods.back();
+            if (MeshArena* arena = Mesh.meshArena()) // keep LODs batchable with LOD 0
+                lod.Mesh.create(*arena, lodVertices.data(), used, lodIndices.data(), (int)lodIndices.size(), layout);
+            else
+                lod.Mesh.create(lodVertices.data(), used, lodIndices.data(), (int)lodIndices.size(), layout);
+            lod.ScreenSize = screenSize;
+            lod.Error = lods[l].error;
+        }
+    }
+
+    const VertexBuffer& Actor::SelectLod(const Matrix4& model, const Matrix4& viewProjection)
+    {
+        if (Lods.empty() || LodRadius <= 0.0f)
+            return Mesh;
+
+        // clip w is the view depth, and the length of the clip y row scales object units into NDC
+        const Matrix4 mvp = viewProjection * model;
+        const float* m = mvp.m;
+        const float depth = m[3]*LodCenter.x + m[7]*LodCenter.y + m[11]*LodCenter.z + m[15];
+        const float scale = sqrtf(m[1]*m[1] + m[5]*m[5] + m[9]*m[9]);
+        const float screenSize = depth > 0.0f ? LodRadius * scale / depth : 1e30f;
+
+        int lod = std::min(std::max(CurrentLod, 0), (int)Lods.size());
+        while (lod < (int)Lods.size() && screenSize < Lods[lod].ScreenSize * (1.0f - LodHysteresis))
+            ++lod;
+        while (lod > 0 && screenSize > Lods[lod-1].ScreenSize * (1.0f + LodHysteresis))
+            --lod;
+        CurrentLod = lod;
+        return lod == 0 ? Mesh : Lods[lod-1].Mesh;
+    }
+
+    bool Actor::BatchMesh(const VertexBuffer& mesh, const Matrix4& model)
+    {
+        BatchRenderer& batches = Core.Batches();
+        if (!batches.active() || Mat.shader || !mesh.inArena() || !Opaque())
+            return false;
+        Shader* shader = Core.BatchShaders().variant(ShaderFeatures());
+        const Texture* texture = Mat.texture ? Mat.texture.texture : nullptr;
+        return shader && batches.add(mesh, *shader, texture, model, Mat.color);
+    }
+
+    void Actor::DrawMesh(const VertexBuffer& mesh, const Matrix4& model, const Matrix4& viewProjection)
+    {
+        Shader& shader = Mat.shader ? *Mat.shader : *Core.SceneShaders().variant(ShaderFeatures());
+        CheckGLResult(shader.bind(), "shader.bind()");
+        if (shader.activeBlock(ub_ObjectData))
+            CheckGLResult(Core.BindObjectUniforms(model), "Core.BindObjectUniforms()");
+        else
+            CheckGLResult(shader.bind(u_Transform, viewProjection * model), "shader.bind(u_Transform)");
+        CheckGLResult(shader.bind(u_DiffuseColor, Mat.color), "shader.bind(u_DiffuseColor)");
+        if (Mat.texture)
+            CheckGLResult(shader.bind(u_DiffuseTex, Mat.texture.texture), "shader.bind(u_DiffuseTex)");
+        CheckGLResult(mesh.draw(), "mesh.draw()");
+    }
+
     void Actor::Render(const Matrix4& parentWorld, const Matrix4& viewProjection)
     {
         Matrix4 worldTransform = WorldTransform(parentWorld);
         if (Mesh)
         {
-            Matrix4 modelViewProj = viewProjection * worldTransform;
-            if (!Mat.shader)
+            Matrix4 model = UseMeshTransform ? worldTransform * MeshTransform : worldTransform;
+            const VertexBuffer& mesh = SelectLod(model, viewProjection);
+            Core.CountLodTriangles(mesh.numTriangles(), Mesh.numTriangles());
+            if (!BatchMesh(mesh, model))
             {
-                if      (Mat.texture)        Mat.shader = &Core.Simple3dShader();
-                else if (Mesh.hasAttrib(a_Color)) Mat.shader = &Core.VertexColor3dShader();
-                else                              Mat.shader = &Core.Color3dShader();
+                // queued batches must be in the depth buffer before we blend over them
+                if (!Opaque())
+                    Core.Batches().submit();
+                DrawMesh(mesh, model, viewProjection);
             }
-
-            Shader& shader = *Mat.shader;
-            CheckGLResult(shader.bind(), "shader.bind()");
-            CheckGLResult(shader.bind(u_Transform, modelViewProj), "shader.bind(u_Transform)");
-            CheckGLResult(shader.bind(u_DiffuseColor, Mat.color), "shader.bind(u_DiffuseColor)");
-            if (Mat.texture)
-                CheckGLResult(shader.bind(u_DiffuseTex, Mat.texture.texture), "shader.bind(u_DiffuseTex)");
-            CheckGLResult(Mesh.draw(), "mesh.draw()");
         }
 
         for (int i = 0; i < (int)ChildNodes.size(); ++i)
@@ -5,6 +5,14 @@ namespace AGL
 {
     /////////////////////////////////////////////////////////////////////////////////
 
+    /** @brief Lower detail mesh of an Actor */
+    struct ActorLod
+    {
+        VertexBuffer Mesh;
+        float ScreenSize = 0.0f; // used below this bounding sphere diameter / screen height
+        float Error = 0.0f;      // object space simplification error
+    };
+
     /** 
      * @brief Basic VISIBLE scene object
      */
@@ -16,10 +24,62 @@ namespace AGL
         VertexBuffer Mesh;
         Material Mat;
 
+        // Keeps a shared TextureLibrary texture alive while Mat.texture refers to it
+        TextureHandle SharedTexture;
+
+        // Applied before the world transform, eg QuantizedPositions::transform() of a quantized Mesh
+        Matrix4 MeshTransform = Matrix4::Identity();
+        bool UseMeshTransform = false;
+
+        // Increasingly coarse versions of Mesh, sorted by decreasing ScreenSize, @see GenerateLods()
+        vector<ActorLod> Lods;
+        Vector3 LodCenter = Vector3::Zero(); // mesh space bounding sphere, LODs are disabled if LodRadius is 0
+        float LodRadius = 0.0f;
+        float LodHysteresis = 0.1f; // relative ScreenSize band that keeps the LOD from flickering at a threshold
+        int CurrentLod = 0;         // 0 is Mesh, i is Lods[i-1]
+
         Actor(GLCore& core, SceneNode* parent, string name, int typeFlags = 0);
 
+        /**
+         * @return ShaderFeature mask of this actor's mesh and material,
+         *         used to select a GLCore::SceneShaders() variant if Mat.shader is not set
+         */
+        uint32_t ShaderFeatures() const;
+
+        /**
+         * @return TRUE if the material doesn't blend: its color is fully opaque and
+         *         its texture has no alpha channel. Only opaque actors are batched
+         */
+        bool Opaque() const;
+
+        /**
+         * Simplifies the geometry Mesh was created from into up to `maxLods` Lods, halving
+         * the triangle count each time, and sets the bounding sphere. Lods[i] is selected
+         * once the actor is smaller than firstScreenSize / 2^i of the screen height.
+         * If Mesh lives in a MeshArena, the Lods are allocated from the same arena, so they
+         * can still be batched. Create Mesh before calling this
+         */
+        void GenerateLods(const void* vertices, int numVertices, const index_t* indices, int numIndices,
+                          const VertexDescr& layout, int maxLods = 3, float firstScreenSize = 0.25f);
+
+        template<class VERTEX>
+        void GenerateLods(const vector<VERTEX>& vertices, const vector<index_t>& indices,
+                          int maxLods = 3, float firstScreenSize = 0.25f)
+        {
+            GenerateLods(vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size(),
+                         VERTEX::layout(), maxLods, firstScreenSize);
+        }
+
         void Update(float deltaTime) override;
         void Render(const Matrix4& parentWorld, const Matrix4& viewProjection) override;
+
+    private:
+        // Mesh or one of Lods by the projected bounding sphere size
+        const VertexBuffer& SelectLod(const Matrix4& model, const Matrix4& viewProjection);
+
+        // queues mesh into Core.Batches() if it is arena resident, @return FALSE if not batched
+        bool BatchMesh(const VertexBuffer& mesh, const Matrix4& model);
+        void DrawMesh(const VertexBuffer& mesh, const Matrix4& model, const Matrix4& viewProjection);
     };
 
     /////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,176 @@
+#include "BatchRenderer.h"
+#include "OpenGL.h"
+#include "GLState.h"
+#include <algorithm>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    BatchRenderer::~BatchRenderer()
+    {
+        destroy();
+    }
+
+    bool BatchRenderer::supported()
+    {
+        return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance
+                                    && GLEW_ARB_shader_storage_buffer_object);
+    }
+
+    bool BatchRenderer::begin(MeshArena& arena)
+    {
+        Active = Enabled && supported() && MeshArena::supported();
+        if (!Active)
+            return false;
+        Arena = &arena;
+        FrameStats = {};
+        clearBatches();
+        return true;
+    }
+
+    void BatchRenderer::clearBatches()
+    {
+        for (int i = 0; i < NumBatches; ++i)
+        {
+            Batches[i].commands.clear();
+            Batches[i].draws.clear();
+        }
+        NumBatches = 0;
+        LastBatch = -1;
+    }
+
+    bool BatchRenderer::add(const VertexBuffer& mesh, Shader& shader, const Texture* texture,
+                            const Matrix4& model, const Color& color)
+    {
+        if (!Active || mesh.meshArena() != Arena || mesh.mode() != DrawIndexed)
+            return false;
+
+        const MeshArena::DrawRange range = Arena->range(mesh.arenaAllocation());
+        if (range.numIndices == 0)
+            return false;
+
+        queue(range, shader, texture, model, color);
+        return true;
+    }
+
+    void BatchRenderer::queue(const MeshArena::DrawRange& range, Shader& shader, const Texture* texture,
+                              const Matrix4& model, const Color& color)
+    {
+        int index = LastBatch;
+        if (index == -1 || Batches[index].shader != &shader || Batches[index].texture != texture
+                        || Batches[index].vertexArray != range.vertexArray)
+        {
+            index = -1;
+            for (int i = 0; i < NumBatches; ++i)
+            {
+                const Batch& b = Batches[i];
+                if (b.shader == &shader && b.texture == texture && b.vertexArray == range.vertexArray)
+                    { index = i; break; }
+            }
+            if (index == -1)
+            {
+                if (NumBatches == (int)Batches.size())
+                    Batches.emplace_back();
+                index = NumBatches++;
+                Batch& b = Batches[index];
+                b.shader  = &shader;
+                b.texture = texture;
+                b.vertexArray = range.vertexArray;
+            }
+            LastBatch = index;
+        }
+
+        Batch& batch = Batches[index];
+        // baseInstance is assigned in flush(), once the global draw order is known
+        batch.commands.push_back({ (uint32_t)range.numIndices, 1u, (uint32_t)range.firstIndex,
+                                   range.baseVertex, 0u });
+        batch.draws.push_back({ model, color });
+    }
+
+    // uploads `numBytes` to `target`, growing and orphaning the buffer like VertexBuffer::update
+    static void uploadStream(GLenum target, uint32_t& buffer, int32_t& capacity, const void* data, int numBytes)
+    {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        if (numBytes > capacity)
+            capacity = std::max(numBytes, capacity + capacity / 2);
+        glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, numBytes, data);
+    }
+
+    int BatchRenderer::prepare()
+    {
+        Commands.clear();
+        Draws.clear();
+        for (int i = 0; i < NumBatches; ++i)
+        {
+            const Batch& b = Batches[i];
+            const uint32_t first = (uint32_t)Draws.size();
+            Commands.insert(Commands.end(), b.commands.begin(), b.commands.end());
+            Draws.insert(Draws.end(), b.draws.begin(), b.draws.end());
+            for (uint32_t k = 0; k < (uint32_t)b.commands.size(); ++k)
+                Commands[first + k].baseInstance = first + k; // read back as a_DrawId
+        }
+        return (int)Commands.size();
+    }
+
+    int BatchRenderer::flush()
+    {
+        const int drawCalls = submit();
+        Active = false;
+        LastStats = FrameStats;
+        return drawCalls;
+    }
+
+    int BatchRenderer::submit()
+    {
+        if (!Active || prepare() == 0)
+            return 0;
+
+        const int numDraws = (int)Commands.size();
+        if (numDraws > Arena->maxDrawIds()) // grow geometrically, this re-specifies every pool VAO
+            Arena->enableDrawIds(std::max(numDraws, Arena->maxDrawIds()*2));
+        uploadStream(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer, IndirectCapacity,
+                     Commands.data(), (int)(Commands.size()*sizeof(DrawCommand)));
+        uploadStream(GL_SHADER_STORAGE_BUFFER, StorageBuffer, StorageCapacity,
+                     Draws.data(), (int)(Draws.size()*sizeof(DrawData)));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, StorageBuffer);
+
+        GLState& state = GLState::current();
+        size_t offset = 0;
+        for (int i = 0; i < NumBatches; ++i)
+        {
+            const Batch& b = Batches[i];
+            b.shader->bind();
+            if (b.texture)
+                b.shader->bind(u_DiffuseTex, b.texture);
+            state.bindVertexArray(b.vertexArray);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (const void*)(offset * sizeof(DrawCommand)),
+                                        (GLsizei)b.commands.size(), 0);
+            offset += b.commands.size();
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        const int drawCalls = NumBatches;
+        FrameStats.draws   += (int)Commands.size();
+        FrameStats.batches += drawCalls;
+        clearBatches();
+        return drawCalls;
+    }
+
+    void BatchRenderer::destroy()
+    {
+        if (IndirectBuffer) glDeleteBuffers(1, &IndirectBuffer), IndirectBuffer = 0;
+        if (StorageBuffer)  glDeleteBuffers(1, &StorageBuffer),  StorageBuffer  = 0;
+        IndirectCapacity = StorageCapacity = 0;
+        Batches.clear();
+        NumBatches = 0;
+        LastBatch = -1;
+        Active = false;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "MeshArena.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Collects MeshArena resident meshes per shader, texture and arena pool and draws
+     * each such batch with a single glMultiDrawElementsIndirect.
+     *
+     * Per-draw model transforms and colors are written into a shader storage buffer,
+     * `baseInstance` of each indirect command is the draw index, which reaches the
+     * shader as the a_DrawId attribute. Batch shaders declare:
+     *
+     * @code
+     *     struct DrawData { mat4 Model; vec4 Color; };
+     *     layout(std430, binding = 0) readonly buffer DrawBuffer { DrawData Draws[]; };
+     *     in float drawId;
+     * @endcode
+     *
+     * Batches are drawn out of scene order, so only opaque materials may be batched.
+     * Blended draws must call submit() first, so that everything queued before them
+     * is already in the depth buffer, @see Actor::Render()
+     *
+     * Requires GL 4.3 or the equivalent extensions, @see GLCore::BatchShaders()
+     */
+    class AGL_API BatchRenderer
+    {
+    public:
+        // layout of GL_DRAW_INDIRECT_BUFFER commands
+        struct DrawCommand
+        {
+            uint32_t count;
+            uint32_t instanceCount;
+            uint32_t firstIndex;
+            int32_t  baseVertex;
+            uint32_t baseInstance;
+        };
+
+        // std430 layout of the per-draw shader storage
+        struct DrawData
+        {
+            Matrix4 Model;
+            Vector4 Color;
+        };
+
+        struct Stats
+        {
+            int draws   = 0; // meshes drawn through batches
+            int batches = 0; // glMultiDrawElementsIndirect calls
+        };
+
+        /** @brief Set FALSE to render every mesh with its own draw call */
+        bool Enabled = true;
+
+    private:
+        struct Batch
+        {
+            Shader* shader;
+            const Texture* texture;
+            uint32_t vertexArray;
+            vector<DrawCommand> commands;
+            vector<DrawData> draws;
+        };
+        vector<Batch> Batches;
+        int NumBatches = 0;  // batches in use this frame, the rest keep their memory
+        int LastBatch  = -1; // consecutive adds usually hit the same batch
+        MeshArena* Arena = nullptr;
+        bool Active = false;
+
+        uint32_t IndirectBuffer = 0;
+        uint32_t StorageBuffer  = 0;
+        int32_t  IndirectCapacity = 0;
+        int32_t  StorageCapacity  = 0;
+        vector<DrawCommand> Commands; // all batches concatenated for upload
+        vector<DrawData>    Draws;
+        Stats FrameStats; // accumulated by every submit() since begin()
+        Stats LastStats;
+
+    public:
+        BatchRenderer() = default;
+        ~BatchRenderer();
+
+        BatchRenderer(const BatchRenderer&) = delete;
+        BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+        /** @return TRUE if multi-draw-indirect and shader storage buffers are supported */
+        static bool supported();
+
+        /**
+         * Starts collecting draws of meshes in `arena`
+         * @return FALSE if batching is disabled or not supported
+         */
+        bool begin(MeshArena& arena);
+
+        /** @return TRUE between begin() and flush() */
+        bool active() const { return Active; }
+
+        /**
+         * Queues an indexed arena mesh for drawing with `shader`, the material must be opaque
+         * @return FALSE if the mesh can't be batched, it must then be drawn directly
+         */
+        bool add(const VertexBuffer& mesh, Shader& shader, const Texture* texture,
+                 const Matrix4& model, const Color& color);
+
+        /**
+         * Queues a resident arena range into the batch of its shader, texture and pool,
+         * this is add() without the mesh checks and does not touch GL
+         */
+        void queue(const MeshArena::DrawRange& range, Shader& shader, const Texture* texture,
+                   const Matrix4& model, const Color& color);
+
+        /**
+         * Concatenates the queued batches into commands() and draws() in batch order,
+         * `baseInstance` of every command is its index in draws()
+         * @return Number of queued draws
+         */
+        int prepare();
+
+        int numBatches() const { return NumBatches; }
+        const vector<DrawCommand>& commands() const { return Commands; }
+        const vector<DrawData>&    draws()    const { return Draws; }
+
+        /**
+         * Draws everything queued so far and keeps collecting, called before
+         * blended geometry is drawn directly
+         * @return Number of draw calls issued
+         */
+        int submit();
+
+        /**
+         * Draws everything queued so far and stops collecting until the next begin()
+         * @return Number of draw calls issued
+         */
+        int flush();
+
+        /** @brief Draws and batches of the last frame, from begin() to flush() */
+        const Stats& stats() const { return LastStats; }
+
+        void destroy();
+
+    private:
+        void clearBatches();
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
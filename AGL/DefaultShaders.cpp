@@ -27,6 +27,89 @@ static strview VS_PassthroughUVColor = R"END(
     }
 )END";
 
+static strview VS_Scene3D = R"END(
+    // 3D scene vertex shader with UV coordinates and color
+    // Camera and model transforms come from uniform blocks if they are supported
+#if AGL_UNIFORM_BLOCKS
+    layout(std140) uniform FrameData {
+        highp mat4 View;
+        highp mat4 Projection;
+        highp mat4 ViewProjection;
+        highp vec4 Time;
+    };
+    layout(std140) uniform ObjectData {
+        highp mat4 Model;
+    };
+#else
+    uniform   highp mat4 transform; // model-view-project matrix
+#endif
+    attribute highp vec3 position;  // in vertex position (px,py,px)
+    attribute highp vec2 coord;     // in vertex texture coordinates
+    attribute highp vec4 color;     // rgba color
+#if defined(INSTANCED) && INSTANCED
+    attribute highp vec4 instance;      // per-instance offset xyz and scale w
+    attribute highp vec4 instanceColor; // per-instance color multiplier
+#endif
+
+    varying highp vec2 vCoord;      // out vertex texture coord for frag
+    varying highp vec4 vColor;
+
+    void main(void)
+    {
+    #if defined(INSTANCED) && INSTANCED
+        highp vec3 pos = position * instance.w + instance.xyz;
+        vColor = color * instanceColor;
+    #else
+        highp vec3 pos = position;
+        vColor = color;
+    #endif
+    #if AGL_UNIFORM_BLOCKS
+        gl_Position = ViewProjection * (Model * vec4(pos, 1.0));
+    #else
+        gl_Position = transform * vec4(pos, 1.0);
+    #endif
+        vCoord = coord;
+    }
+)END";
+
+static strview VS_Batch3D = R"END(
+    #version 430
+    // 3D scene vertex shader for BatchRenderer multi-draws
+    // model transform and color of each draw come from the DrawBuffer storage
+    layout(std140) uniform FrameData {
+        highp mat4 View;
+        highp mat4 Projection;
+        highp mat4 ViewProjection;
+        highp vec4 Time;
+    };
+    struct DrawData {
+        highp mat4 Model;
+        highp vec4 Color;
+    };
+    layout(std430, binding = 0) readonly buffer DrawBuffer {
+        DrawData Draws[];
+    };
+    in highp vec3  position; // in vertex position (px,py,px)
+    in highp vec2  coord;    // in vertex texture coordinates
+    in highp vec4  color;    // rgba color
+    in highp float drawId;   // index into Draws[], from the indirect command baseInstance
+
+    out highp vec2 vCoord;   // out vertex texture coord for frag
+    out highp vec4 vColor;   // vertex color * draw color
+
+    void main(void)
+    {
+        DrawData draw = Draws[int(drawId)];
+        gl_Position = ViewProjection * (draw.Model * vec4(position, 1.0));
+        vCoord = coord;
+    #if VERTEX_COLOR
+        vColor = color * draw.Color;
+    #else
+        vColor = draw.Color;
+    #endif
+    }
+)END";
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static strview PS_PassthroughColor = R"END(
@@ -96,6 +179,62 @@ static strview PS_AlphaTextureWithColor = R"END(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static strview PS_Scene3D = R"END(
+    // Specializable 3D scene shader, @see ShaderVariants
+    #pragma agl_features HAS_TEXTURE VERTEX_COLOR ALPHA_TEST INSTANCED
+    uniform highp vec4 diffuseColor; // output color multiplier
+#if HAS_TEXTURE
+    uniform highp sampler2D diffuseTex; // diffuse texture
+    varying highp vec2 vCoord;          // vertex texture coords
+#endif
+#if VERTEX_COLOR
+    varying highp vec4 vColor;          // vertex color
+#endif
+
+    void main(void)
+    {
+        highp vec4 texel = diffuseColor;
+    #if HAS_TEXTURE
+        texel *= texture2D(diffuseTex, vCoord);
+    #endif
+    #if VERTEX_COLOR
+        texel *= vColor;
+    #endif
+    #if ALPHA_TEST
+        if (texel.a < 0.025)
+            discard;
+    #endif
+        gl_FragColor = texel;
+    }
+)END";
+
+static strview PS_Batch3D = R"END(
+    #version 430
+    // Specializable 3D scene shader for BatchRenderer, @see ShaderVariants
+    #pragma agl_features HAS_TEXTURE VERTEX_COLOR ALPHA_TEST
+#if HAS_TEXTURE
+    uniform highp sampler2D diffuseTex; // diffuse texture
+#endif
+    in highp vec2 vCoord;   // vertex texture coords
+    in highp vec4 vColor;   // vertex color * draw color
+    out highp vec4 fragColor;
+
+    void main(void)
+    {
+        highp vec4 texel = vColor;
+    #if HAS_TEXTURE
+        texel *= texture(diffuseTex, vCoord);
+    #endif
+    #if ALPHA_TEST
+        if (texel.a < 0.025)
+            discard;
+    #endif
+        fragColor = texel;
+    }
+)END";
+
+////////////////////////////////////////////////////////////////////////////////
+
 static strview PS_OutlineText = R"END(
     // Basic UI Text shader
     // diffuseColor is used to multiply main color from diffuseTexture
@@ -167,8 +306,11 @@ static strview PS_Rect = R"END(
             { PS_TextureWithColor,      VS_PassthroughUVColor }, // ES_Simple
             { PS_AlphaTextureWithColor, VS_PassthroughUVColor }, // ES_Text
             { PS_VertexColor,           VS_PassthroughUVColor }, // ES_VertexColor
-            { PS_PassthroughColor,      VS_PassthroughUVColor }, // ES_Color3d
-            { PS_TextureWithColor,      VS_PassthroughUVColor }, // ES_Simple3D
+            { PS_PassthroughColor,      VS_Scene3D            }, // ES_Color3d
+            { PS_TextureWithColor,      VS_Scene3D            }, // ES_Simple3D
+            { PS_VertexColor,           VS_Scene3D            }, // ES_VertexColor3d
+            { PS_Scene3D,               VS_Scene3D            }, // ES_Scene3d
+            { PS_Batch3D,               VS_Batch3D            }, // ES_Batch3d
         };
 
         static_assert(sizeof(sources) == ES_Max*sizeof(ShaderPair), 
@@ -191,6 +333,9 @@ static strview PS_Rect = R"END(
         else if (name == "vertexcolor") shader = ES_VertexColor;
         else if (name == "color3d")     shader = ES_Color3d;
         else if (name == "simple3d")    shader = ES_Simple3d;
+        else if (name == "vertexcolor3d") shader = ES_VertexColor3d;
+        else if (name == "scene3d")     shader = ES_Scene3d;
+        else if (name == "batch3d")     shader = ES_Batch3d;
         return GetEngineShaderSource(shader);
     }
 
@@ -21,6 +21,9 @@ namespace AGL
         ES_VertexColor, // vertexcolor.frag | vertexcolor.vert  |
         ES_Color3d,     // color3d.frag     | color3d.vert      | A simple Vertex3DUV color only shader
         ES_Simple3d,    // simple3d.frag    | simple3d.vert     | A simple Vertex3DUV texture+color shader
+        ES_VertexColor3d, // vertexcolor3d.frag | vertexcolor3d.vert | A simple Vertex3Color shader
+        ES_Scene3d,     // scene3d.frag     | scene3d.vert      | Specializable 3D shader, @see ShaderVariants
+        ES_Batch3d,     // batch3d.frag     | batch3d.vert      | GLSL 430 scene3d for BatchRenderer multi-draws
         ES_Max,
     };
 
@@ -45,6 +48,9 @@ namespace AGL
      *  "vertexcolor"
      *  "color3d"
      *  "simple3d"
+     *  "vertexcolor3d"
+     *  "scene3d"
+     *  "batch3d"
      */
     ShaderPair GetEngineShaderSource(strview sourceName);
 
@@ -0,0 +1,203 @@
+#include "FileWatcher.h"
+#include <rpp/file_io.h>
+#include <rpp/debugging.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#if __linux__
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    FileWatcher::FileWatcher()
+    {
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        stop();
+    }
+
+    static string parentFolder(const string& path)
+    {
+        rpp::strview folder = rpp::folder_path(path);
+        return folder ? folder.to_string() : string{"./"};
+    }
+
+    int FileWatcher::watch(const vector<string>& paths, Callback onChanged)
+    {
+        int id = NextId++;
+        Callbacks.emplace_back(id, move(onChanged));
+        {
+            std::lock_guard<std::mutex> lock { Mutex };
+            for (const string& path : paths)
+            {
+                Entries.push_back({ id, path, rpp::file_modified(path) });
+            #if __linux__
+                if (Notify == -1)
+                    Notify = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+                if (Notify == -1) {
+                    LogError("inotify_init1 failed: %s", strerror(errno));
+                    continue;
+                }
+                // watch the directory, so atomic rename-on-save is caught as well
+                string folder = parentFolder(path);
+                bool watched = std::any_of(Watches.begin(), Watches.end(),
+                                           [&](auto& w) { return w.second == folder; });
+                if (!watched) {
+                    int wd = inotify_add_watch(Notify, folder.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE);
+                    if (wd == -1) LogWarning("inotify_add_watch '%s' failed: %s", folder.c_str(), strerror(errno));
+                    else          Watches.emplace_back(wd, folder);
+                }
+            #endif
+            }
+        }
+        start();
+        return id;
+    }
+
+    void FileWatcher::unwatch(int id)
+    {
+        Callbacks.erase(std::remove_if(Callbacks.begin(), Callbacks.end(),
+                        [id](auto& c) { return c.first == id; }), Callbacks.end());
+
+        std::lock_guard<std::mutex> lock { Mutex };
+        Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+                      [id](const Entry& e) { return e.id == id; }), Entries.end());
+    }
+
+    int FileWatcher::dispatch()
+    {
+        vector<int> changedIds;
+        if (Overflow.exchange(false))
+        {
+            for (auto& c : Callbacks)
+                changedIds.push_back(c.first);
+            Tail.store(Head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+        else
+        {
+            int tail = Tail.load(std::memory_order_relaxed);
+            int head = Head.load(std::memory_order_acquire);
+            for (; tail != head; tail = (tail + 1) % QueueSize)
+            {
+                int id = Queue[tail];
+                if (std::find(changedIds.begin(), changedIds.end(), id) == changedIds.end())
+                    changedIds.push_back(id); // editors often write the same file several times
+            }
+            Tail.store(tail, std::memory_order_release);
+        }
+
+        int numCalled = 0;
+        for (int id : changedIds)
+        {
+            for (auto& c : Callbacks)
+            {
+                if (c.first == id) {
+                    Callback onChanged = c.second; // callback may watch() or unwatch()
+                    onChanged();
+                    ++numCalled;
+                    break;
+                }
+            }
+        }
+        return numCalled;
+    }
+
+    void FileWatcher::push(int id)
+    {
+        int head = Head.load(std::memory_order_relaxed);
+        int next = (head + 1) % QueueSize;
+        if (next == Tail.load(std::memory_order_acquire)) {
+            Overflow = true;
+            return;
+        }
+        Queue[head] = id;
+        Head.store(next, std::memory_order_release);
+    }
+
+    // called on the watcher thread with Mutex locked
+    void FileWatcher::changed(const string& path)
+    {
+        for (Entry& e : Entries)
+            if (e.path == path)
+                push(e.id);
+    }
+
+    void FileWatcher::start()
+    {
+        if (Running.exchange(true))
+            return;
+        Thread = std::thread{ [this] { run(); } };
+    }
+
+    void FileWatcher::stop()
+    {
+        if (Running.exchange(false) && Thread.joinable())
+            Thread.join();
+    #if __linux__
+        if (Notify != -1) {
+            close(Notify);
+            Notify = -1;
+        }
+    #endif
+    }
+
+    void FileWatcher::run()
+    {
+    #if __linux__
+        if (Notify == -1)
+            return;
+
+        alignas(inotify_event) char buffer[4096];
+        while (Running)
+        {
+            pollfd pfd = { Notify, POLLIN, 0 };
+            if (poll(&pfd, 1, 100/*ms*/) <= 0)
+                continue; // timeout, check Running again
+
+            ssize_t len = read(Notify, buffer, sizeof(buffer));
+            if (len <= 0)
+                continue;
+
+            std::lock_guard<std::mutex> lock { Mutex };
+            for (char* p = buffer; p < buffer + len; )
+            {
+                auto* event = (inotify_event*)p;
+                p += sizeof(inotify_event) + event->len;
+                if (!event->len) continue;
+
+                for (auto& w : Watches)
+                {
+                    if (w.first != event->wd) continue;
+                    string path = w.second + event->name;
+                    changed(path);
+                    if (w.second == "./") changed(event->name); // relative paths without folder
+                    break;
+                }
+            }
+        }
+    #else
+        while (Running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{250});
+            std::lock_guard<std::mutex> lock { Mutex };
+            for (Entry& e : Entries)
+            {
+                time_t modified = rpp::file_modified(e.path);
+                if (modified != e.modified) {
+                    e.modified = modified;
+                    push(e.id);
+                }
+            }
+        }
+    #endif
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "AGLConfig.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <ctime>
+
+namespace AGL
+{
+    using std::string;
+    using std::vector;
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Watches files for modifications on a background thread.
+     *
+     * On Linux this uses inotify on the parent directories, so editors that save by
+     * renaming a temp file are also detected. Other platforms poll modification
+     * times on the background thread. Either way the render thread never stats files:
+     * it only drains a lock-free queue of change events in dispatch().
+     */
+    class AGL_API FileWatcher
+    {
+    public:
+        using Callback = std::function<void()>;
+
+    private:
+        struct Entry
+        {
+            int    id;
+            string path;
+            time_t modified; // used by the polling fallback
+        };
+
+        // single-producer single-consumer ring of changed watch ids
+        static constexpr int QueueSize = 256;
+        int Queue[QueueSize];
+        std::atomic<int> Head { 0 }; // written by the watcher thread
+        std::atomic<int> Tail { 0 }; // written by dispatch()
+        std::atomic<bool> Overflow { false }; // queue was full, dispatch() notifies everything
+
+        std::mutex Mutex; // guards Entries and Watches between watch() and the watcher thread
+        vector<Entry> Entries;
+        vector<std::pair<int, Callback>> Callbacks; // only touched by the owner thread
+        int NextId = 1;
+
+        std::atomic<bool> Running { false };
+        std::thread Thread;
+        int Notify = -1; // inotify descriptor
+        vector<std::pair<int, string>> Watches; // inotify watch descriptor -> directory
+
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        /**
+         * Starts watching the given files, `onChanged` is called from dispatch()
+         * @return Watch id which can be passed to unwatch()
+         */
+        int watch(const vector<string>& paths, Callback onChanged);
+        int watch(const string& path, Callback onChanged) { return watch(vector<string>{path}, move(onChanged)); }
+
+        /** @brief Stops watching the files registered with this id */
+        void unwatch(int id);
+
+        /**
+         * Calls the callbacks of all files that changed since the last dispatch,
+         * on the calling thread.
+         * @return Number of callbacks invoked
+         */
+        int dispatch();
+
+    private:
+        void start();
+        void stop();
+        void run();
+        void push(int id);
+        void changed(const string& path);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
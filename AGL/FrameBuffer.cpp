@@ -1,5 +1,6 @@
 #include "FrameBuffer.h"
 #include "OpenGL.h"
+#include "GLState.h"
 #include <rpp/debugging.h>
 
 namespace AGL
@@ -17,7 +18,10 @@ namespace AGL
     {
         if (!DefaultFrameBuffer && FrameBuf)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            GLState& state = GLState::current();
+            state.bindFramebuffer(0);
+            state.onTextureDeleted(Texture);
+            state.onFramebufferDeleted(FrameBuf);
             glDeleteRenderbuffers(1, &RenderBuf), RenderBuf = 0;
             glDeleteTextures(1, &Texture),        Texture   = 0;
             glDeleteFramebuffers(1, &FrameBuf),   FrameBuf  = 0;
@@ -69,15 +73,16 @@ namespace AGL
         BytesPerPixel = 3;
         LogInfo("Updating framebuffer  %dx%d  %d channels", Width, Height, BytesPerPixel);
 
+        GLState& state = GLState::current();
         if (!Texture) glGenTextures(1, &Texture);
-        glBindTexture(GL_TEXTURE_2D, Texture);
+        state.bindTexture(0, Texture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, Format, GL_UNSIGNED_BYTE, NULL);
         // GLES requires these to enable NPOT textures:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        state.bindTexture(0, 0);
 
         if (!RenderBuf) glGenRenderbuffers(1, &RenderBuf);
         glBindRenderbuffer(GL_RENDERBUFFER, RenderBuf);
@@ -85,13 +90,13 @@ namespace AGL
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
         if (!FrameBuf) glGenFramebuffers(1, &FrameBuf);
-        glBindFramebuffer(GL_FRAMEBUFFER, FrameBuf);
+        state.bindFramebuffer(FrameBuf);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Texture, 0);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, RenderBuf);
 
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            state.bindFramebuffer(0);
         }
         else
         {
@@ -105,18 +110,18 @@ namespace AGL
         if (PushedFrameBuf)
             LogError("warning: FrameBuffer was rebound before unbinding. Do you have nested framebuffer bindings?");
 
-        unsigned currentBuf;
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, (GLint*)&currentBuf);
+        GLState& state = GLState::current();
+        unsigned currentBuf = state.frameBuffer();
         if (currentBuf != FrameBuf)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, FrameBuf);
+            state.bindFramebuffer(FrameBuf);
             PushedFrameBuf = currentBuf;
         }
     }
 
     void FrameBuffer::unbind()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, PushedFrameBuf);
+        GLState::current().bindFramebuffer(PushedFrameBuf);
         PushedFrameBuf = 0;
     }
 
@@ -11,6 +11,7 @@
 #include <vector>
 #include "FrameBuffer.h"
 #include "SceneRoot.h"
+#include "UniformBuffer.h"
 #include <rpp/debugging.h>
 
 namespace AGL
@@ -21,13 +22,31 @@ namespace AGL
     {
         static constexpr bool UseFrameBuffer = false;
         static constexpr bool UseDebugContext = true;
+        static constexpr ShaderCompileMode DefaultShaderCompileMode = CompileAsync;
+        static constexpr int MaxObjectBlocksPerFrame = 1024;
+        static constexpr int TransientBytesPerFrame = 4*1024*1024;
         GLContext    Context;
+        GLState      State;
         FrameBuffer  FrameBuf;
         VertexBuffer Triangle;
         Shader       Color3dShader;
         Shader       VertexColor3dShader;
         Shader       Simple3dShader;
+        ShaderVariants SceneShaders;
+        FileWatcher  Watcher;
+        StreamBuffer Transient;
+        MeshArena    Meshes;
+        BatchRenderer  Batches;
+        ShaderVariants BatchShaders;
         GLInput      Input;
+        TextureLibrary Textures;
+        UniformBuffer  FrameData;  // ub_FrameData
+        UniformBuffer  ObjectData; // ub_ObjectData
+        double ElapsedTime = 0.0;
+
+        ShaderUniformStats LastFrameUniforms;
+        MeshLodStats FrameLods;
+        MeshLodStats LastFrameLods;
 
         int Width         = 0;
         int Height        = 0;
@@ -38,8 +57,12 @@ namespace AGL
             // For proper debugging support, we want to target GL 4.3+
             double openglVersion = 4.3;
             Context.create(width, height, createWindow, openglVersion, UseDebugContext);
+            State.invalidate();
+            GLState::makeCurrent(&State);
             Input.Init(Context.windowHandle());
             Configure();
+            CreateUniformBuffers();
+            Transient.create(TransientBytesPerFrame);
             LoadDefaultShaders();
         }
 
@@ -47,12 +70,12 @@ namespace AGL
 
         void Configure()
         {
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glEnable(GL_BLEND); // enable alpha blending
+            State.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            State.enableBlend(true); // enable alpha blending
             if (auto err = glGetErrorStr()) LogError("GL_BLEND error: %s", err);
 
-            glEnable(GL_DEPTH_TEST);
-            glDepthFunc(GL_LEQUAL); // important to get this right!
+            State.enableDepthTest(true);
+            State.depthFunc(GL_LEQUAL); // important to get this right!
             if (auto err = glGetErrorStr()) LogError("GL_DEPTH_TEST error: %s", err);
 
             //glEnable(GL_TEXTURE_2D); // for iOS
@@ -84,20 +107,40 @@ namespace AGL
             }
         }
 
+        void CreateUniformBuffers()
+        {
+            if (!UniformBuffer::supported()) {
+                LogInfo("Uniform buffer objects not supported, falling back to per-draw transform uniforms");
+                return;
+            }
+            FrameData.create(ub_FrameData, sizeof(FrameUniforms));
+            ObjectData.create(ub_ObjectData, sizeof(ObjectUniforms), MaxObjectBlocksPerFrame);
+            if (auto err = glGetErrorStr()) LogError("UniformBuffer create error: %s", err);
+        }
+
         void LoadDefaultShaders()
         {
             // So what is this magic? Shader names are defined in EngineShaders.h
             // The shader class automagically falls back to using those shaders. This disables hotloading, obviously...
-            // TODO: this is an extremely bad way to load shaders... maybe we can think of something better?? Precompile??
-            if (!Color3dShader.loadShader("color3d")) {
+            // The scene renders through SceneShaders variants, these fixed shaders are only
+            // kept for user code, so they aren't compiled until their first bind()
+            if (!Color3dShader.loadShader("color3d", CompileLazy)) {
                 ThrowErr("Failed to load default shader 'color3d'");
             }
-            if (!VertexColor3dShader.loadShader("vertexcolor")) {
-                ThrowErr("Failed to load default shader 'vertexcolor'");
+            if (!VertexColor3dShader.loadShader("vertexcolor3d", CompileLazy)) {
+                ThrowErr("Failed to load default shader 'vertexcolor3d'");
             }
-            if (!Simple3dShader.loadShader("simple3d")) {
+            if (!Simple3dShader.loadShader("simple3d", CompileLazy)) {
                 ThrowErr("Failed to load default shader 'simple3d'");
             }
+            // variants are only compiled once an Actor needs them
+            if (!SceneShaders.load("scene3d", DefaultShaderCompileMode)) {
+                ThrowErr("Failed to load default shader 'scene3d'");
+            }
+            if (BatchRenderer::supported() && !BatchShaders.load("batch3d", DefaultShaderCompileMode)) {
+                LogWarning("Failed to load default shader 'batch3d', disabling batching");
+                Batches.Enabled = false;
+            }
         }
 
         void UpdateWindowSize()
@@ -110,9 +153,16 @@ namespace AGL
 
         void SwapBuffers()
         {
-            glFinish(); // block until all rendering completed
+            // no glFinish() here: the Transient frame fences already keep the CPU
+            // at most StreamBuffer::NumFrames frames ahead of the GPU
+            LastFrameUniforms = Shader::uniformStats();
+            Shader::resetUniformStats();
+            LastFrameLods = FrameLods;
+            FrameLods = {};
+            Transient.endFrame();
             Context.swapBuffers();
             Context.pollEvents();
+            Transient.beginFrame();
         }
 
         bool WindowShouldClose() { return Context.windowShouldClose(); }
@@ -122,7 +172,11 @@ namespace AGL
 
     GLCore::GLCore(int width, int height, bool createWindow)
         : gl(*new GLRendererCtx(width, height, createWindow)) { }
-    GLCore::~GLCore() { delete &gl; }
+    GLCore::~GLCore()
+    {
+        SceneRoot.reset(); // scene meshes must be released while the context and arena are alive
+        delete &gl;
+    }
 
 
     void GLCore::SetTitle(const string& title)
@@ -135,6 +189,60 @@ namespace AGL
         return gl.Input;
     }
 
+    GLState& GLCore::State()
+    {
+        return gl.State;
+    }
+
+    const ShaderUniformStats& GLCore::UniformStats() const
+    {
+        return gl.LastFrameUniforms;
+    }
+
+    const MeshLodStats& GLCore::LodStats() const
+    {
+        return gl.LastFrameLods;
+    }
+
+    void GLCore::CountLodTriangles(int submitted, int fullDetail)
+    {
+        MeshLodStats& stats = gl.FrameLods;
+        ++stats.actors;
+        if (submitted < fullDetail) ++stats.reducedActors;
+        stats.submittedTriangles += submitted;
+        stats.fullTriangles      += fullDetail;
+    }
+
+    TextureLibrary& GLCore::Textures()
+    {
+        return gl.Textures;
+    }
+
+    void GLCore::BindFrameUniforms(const Camera& camera)
+    {
+        if (!gl.FrameData.good())
+            return;
+
+        FrameUniforms frame;
+        frame.View           = camera.View;
+        frame.Projection     = camera.Projection;
+        frame.ViewProjection = camera.ViewProjection;
+        frame.Time = Vector4{ (float)gl.ElapsedTime, DeltaTime, 0.0f, 0.0f };
+
+        gl.ObjectData.reset(); // previous frame's object blocks are no longer needed
+        gl.FrameData.push(frame);
+    }
+
+    bool GLCore::BindObjectUniforms(const Matrix4& model)
+    {
+        if (!gl.ObjectData.good())
+            return false;
+        ObjectUniforms object;
+        object.Model = model;
+        gl.ObjectData.push(object);
+        return true;
+    }
+
     Shader& GLCore::Color3dShader()
     {
         return gl.Color3dShader;
@@ -150,6 +258,58 @@ namespace AGL
         return gl.Simple3dShader;
     }
 
+    ShaderVariants& GLCore::SceneShaders()
+    {
+        return gl.SceneShaders;
+    }
+
+    StreamBuffer& GLCore::Transient()
+    {
+        return gl.Transient;
+    }
+
+    MeshArena& GLCore::Meshes()
+    {
+        return gl.Meshes;
+    }
+
+    BatchRenderer& GLCore::Batches()
+    {
+        return gl.Batches;
+    }
+
+    ShaderVariants& GLCore::BatchShaders()
+    {
+        return gl.BatchShaders;
+    }
+
+    int GLCore::WatchShader(Shader& shader)
+    {
+        return gl.Watcher.watch({ shader.vertShader(), shader.fragShader() }, [&shader] {
+            shader.invalidateBinary();
+            shader.reload();
+        });
+    }
+
+    int GLCore::WatchShader(ShaderVariants& variants)
+    {
+        return gl.Watcher.watch({ variants.name() + ".vert", variants.name() + ".frag" }, [&variants] {
+            variants.reload();
+        });
+    }
+
+    int GLCore::WatchTexture(Texture& texture)
+    {
+        return gl.Watcher.watch(texture.name(), [&texture] {
+            texture.reload();
+        });
+    }
+
+    void GLCore::Unwatch(int watchId)
+    {
+        gl.Watcher.unwatch(watchId);
+    }
+
     int GLCore::ContextWidth() const
     {
         return gl.Width;
@@ -237,7 +397,9 @@ namespace AGL
     void GLCore::UpdateAndRender()
     {
         DeltaTime = FrameTimer.next();
+        gl.ElapsedTime += DeltaTime;
         Input().PollEvents();
+        gl.Watcher.dispatch(); // reload changed shaders and textures
         SceneRoot->Update(DeltaTime);
         SceneRoot->Render();
     }
@@ -5,6 +5,14 @@
 #include "Shader.h"
 #include "AGLConfig.h"
 #include "GLInput.h"
+#include "TextureLibrary.h"
+#include "GLState.h"
+#include "ShaderVariants.h"
+#include "FileWatcher.h"
+#include "StreamBuffer.h"
+#include "MeshArena.h"
+#include "BatchRenderer.h"
+#include "MeshOptimizer.h"
 #include <rpp/timer.h>
 
 namespace AGL
@@ -39,10 +47,76 @@ namespace AGL
         void SetTitle(const string& title);
 
         GLInput& Input();
+
+        /** @brief GL state tracker of this context, @see GLState::stats() for elided calls */
+        GLState& State();
+
+        /** @brief Shader uniform uploads issued vs skipped during the last frame */
+        const ShaderUniformStats& UniformStats() const;
+
+        /** @brief Triangles drawn by Actors during the last frame vs without their LODs */
+        const MeshLodStats& LodStats() const;
+
+        // called by Actor::Render for every drawn mesh
+        void CountLodTriangles(int submitted, int fullDetail);
+        TextureLibrary& Textures();
+
+        /**
+         * Uploads View/Projection/ViewProjection of the camera into the FrameData
+         * uniform block. Called once per frame by SceneRoot::Render
+         */
+        void BindFrameUniforms(const class Camera& camera);
+
+        /**
+         * Uploads the model matrix into the ObjectData uniform block
+         * @return FALSE if uniform blocks are not supported, bind u_Transform instead
+         */
+        bool BindObjectUniforms(const Matrix4& model);
+
         Shader& Color3dShader();
         Shader& VertexColor3dShader();
         Shader& Simple3dShader();
 
+        /**
+         * Specializable 3D scene shader, Actors without an explicit Material shader
+         * select a variant from this by their mesh and material features
+         */
+        ShaderVariants& SceneShaders();
+
+        /**
+         * Persistent-mapped ring for geometry that is rebuilt every frame,
+         * such as GLDraw3D::Submit(). Frames are advanced in SwapBuffers()
+         */
+        StreamBuffer& Transient();
+
+        /**
+         * Shared vertex and index buffers for static meshes, eg
+         * actor->Mesh.create(core.Meshes(), vertices, indices)
+         */
+        MeshArena& Meshes();
+
+        /**
+         * Multi-draw-indirect batching of Meshes() resident actors, used by SceneRoot::Render.
+         * Actors without an explicit Material shader are drawn with BatchShaders() variants
+         */
+        BatchRenderer& Batches();
+        ShaderVariants& BatchShaders();
+
+        /**
+         * Reloads the shader when its .vert or .frag file changes. Changes are detected
+         * on a background thread and applied in UpdateAndRender(), so this replaces
+         * calling Shader::hotload() every frame
+         * @return Watch id for Unwatch()
+         */
+        int WatchShader(Shader& shader);
+        int WatchShader(ShaderVariants& variants);
+
+        /** @brief Reloads the texture when the file it was loaded from changes */
+        int WatchTexture(Texture& texture);
+
+        /** @brief Stops watching, must be called before a watched object is destroyed */
+        void Unwatch(int watchId);
+
         // Width & Height of the current render target
         int ContextWidth()  const;
         int ContextHeight() const;
@@ -1,6 +1,16 @@
 #include "GLDraw.h"
+#include "MeshQuantizer.h"
 #include <rpp/debugging.h>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#if AGL_SSE
+    #include <emmintrin.h>
+#endif
 
 namespace AGL
 {
@@ -8,9 +18,8 @@ namespace AGL
 
     void GLDraw2D::CreateBuffer(VertexBuffer& outBuffer) const
     {
-        if (!vertices.empty())
-            outBuffer.create<Vertex2Alpha>(vertices, indices);
-        else outBuffer.clear(); // only clear if verts is 0, to avoid free/malloc cycle
+        // updates the existing GL buffers in place, to avoid free/malloc cycle
+        outBuffer.update<Vertex2Alpha>(vertices, indices);
     }
 
     VertexBuffer GLDraw2D::CreateBuffer() const
@@ -21,6 +30,12 @@ namespace AGL
         return buf;
     }
 
+    TransientMesh GLDraw2D::Submit(StreamBuffer& stream) const
+    {
+        return stream.submit(DrawIndexed, Vertex2Alpha::layout(), vertices.data(), (int)vertices.size(),
+                             indices.data(), (int)indices.size());
+    }
+
     void GLDraw2D::Clear()
     {
         vertices.clear();
@@ -338,9 +353,8 @@ namespace AGL
 
     void GLDraw3D::CreateBuffer(VertexBuffer& outBuffer) const
     {
-        if (!vertices.empty())
-            outBuffer.create<Vertex3Color>(vertices, indices);
-        else outBuffer.clear(); // only clear if verts is 0, to avoid free/malloc cycle
+        // updates the existing GL buffers in place, to avoid free/malloc cycle
+        outBuffer.update<Vertex3Color>(vertices, indices);
     }
 
     VertexBuffer GLDraw3D::CreateBuffer() const
@@ -351,25 +365,322 @@ namespace AGL
         return buf;
     }
 
+    void GLDraw3D::CreateBuffers(vector<VertexBuffer>& outBuffers, int maxVertices) const
+    {
+        if ((int)vertices.size() <= maxVertices)
+        {
+            outBuffers.resize(vertices.empty() ? 0 : 1);
+            if (!vertices.empty())
+                CreateBuffer(outBuffers.front());
+            return;
+        }
+
+        vector<int> remap(vertices.size(), -1); // source vertex -> chunk vertex
+        vector<index_t> sources;                // chunk vertex -> source vertex
+        vector<Vertex3Color> chunkVerts;
+        vector<index_t> chunkIndices;
+        int numChunks = 0;
+
+        auto flush = [&]()
+        {
+            if (numChunks == (int)outBuffers.size())
+                outBuffers.emplace_back();
+            outBuffers[numChunks++].update<Vertex3Color>(chunkVerts, chunkIndices);
+            for (index_t source : sources)
+                remap[source] = -1;
+            sources.clear();
+            chunkVerts.clear();
+            chunkIndices.clear();
+        };
+
+        const index_t* src = indices.data();
+        const int numIndices = (int)indices.size();
+        for (int i = 0; i + 2 < numIndices; i += 3)
+        {
+            const index_t* tri = &src[i];
+            int newVerts = 0;
+            for (int k = 0; k < 3; ++k)
+                if (remap[tri[k]] == -1 && (k == 0 || (tri[k] != tri[0] && (k == 1 || tri[k] != tri[1]))))
+                    ++newVerts;
+
+            if ((int)chunkVerts.size() + newVerts > maxVertices)
+                flush();
+
+            for (int k = 0; k < 3; ++k)
+            {
+                int& mapped = remap[tri[k]];
+                if (mapped == -1)
+                {
+                    mapped = (int)chunkVerts.size();
+                    chunkVerts.push_back(vertices[tri[k]]);
+                    sources.push_back(tri[k]);
+                }
+                chunkIndices.push_back((index_t)mapped);
+            }
+        }
+        if (!chunkIndices.empty())
+            flush();
+        outBuffers.resize(numChunks);
+    }
+
+    TransientMesh GLDraw3D::Submit(StreamBuffer& stream) const
+    {
+        return stream.submit(DrawIndexed, Vertex3Color::layout(), vertices.data(), (int)vertices.size(),
+                             indices.data(), (int)indices.size());
+    }
+
+    MeshOptimizeStats GLDraw3D::Optimize(int flags)
+    {
+        return MeshOptimizer::optimize(vertices, indices, flags);
+    }
+
+    int GLDraw3D::Weld(float epsilon)
+    {
+        const int before = (int)vertices.size();
+        return before - MeshOptimizer::weldVertices(vertices, indices, epsilon);
+    }
+
+    // Unit primitive shared by all GLDraw3D instances, positions are xyz triplets
+    struct UnitMesh
+    {
+        vector<float> positions;
+        vector<index_t> indices; // relative to the first vertex, empty for line shapes
+        int numVertices() const { return (int)positions.size() / 3; }
+    };
+
+    // Sphere() and HollowSphere() points, rings == sectors == segments
+    static UnitMesh createUnitSphere(int segments)
+    {
+        const int rings   = segments;
+        const int sectors = segments;
+
+        constexpr float PI = rpp::PIf;
+        constexpr float PI_2 = rpp::PIf / 2;
+        const float R = 1./(float)(rings-1);
+        const float S = 1./(float)(sectors-1);
+
+        UnitMesh unit;
+        unit.positions.reserve(rings * sectors * 3);
+        unit.indices.reserve((rings-1) * sectors * 6);
+        for (int r = 0; r < rings; ++r)
+        {
+            for (int s = 0; s < sectors; ++s)
+            {
+                unit.positions.push_back(cos(2*PI * s * S) * sin( PI * r * R ));
+                unit.positions.push_back(sin( -PI_2 + PI * r * R ));
+                unit.positions.push_back(sin(2*PI * s * S) * sin( PI * r * R ));
+                if (r < rings-1)
+                {
+                    const index_t curRow  = r * sectors;
+                    const index_t nextRow = (r+1) * sectors;
+                    const index_t nextS   = (s+1) % sectors;
+                    unit.indices.insert(unit.indices.end(), {
+                        curRow + s, nextRow + s, nextRow + nextS,
+                        curRow + s, nextRow + nextS, curRow + nextS,
+                    });
+                }
+            }
+        }
+        return unit;
+    }
+
+    // HollowCylinder() ring in the XY plane: (sin, cos, 0) of `segments+1` points, the last closes the ring
+    static UnitMesh createUnitCircle(int segments)
+    {
+        const float segmentArc = (2.0f * rpp::PIf) / segments;
+        UnitMesh unit;
+        unit.positions.reserve((segments + 1) * 3);
+        for (int i = 0; i <= segments; ++i)
+        {
+            const float alpha = segmentArc * i;
+            unit.positions.insert(unit.positions.end(), { sinf(alpha), cosf(alpha), 0.0f });
+        }
+        return unit;
+    }
+
+    // Builds each unit primitive once per segment count, callers can be on any thread.
+    // Common segment counts are published through atomic slots, so lookups never lock,
+    // only huge segment counts fall back to a mutex protected map
+    class UnitMeshCache
+    {
+        static constexpr int MaxSlots = 256;
+        using Slots = std::atomic<const UnitMesh*>[MaxSlots];
+        using Overflow = std::unordered_map<int, std::unique_ptr<UnitMesh>>;
+
+        Slots SphereSlots {};
+        Slots CircleSlots {};
+        std::mutex OverflowMutex;
+        Overflow SphereOverflow;
+        Overflow CircleOverflow;
+
+        template<class Create>
+        const UnitMesh& get(Slots& slots, Overflow& overflow, int segments, Create create)
+        {
+            if (segments < MaxSlots)
+            {
+                if (const UnitMesh* mesh = slots[segments].load(std::memory_order_acquire))
+                    return *mesh;
+                // racing builders create identical meshes, the first one to publish wins
+                const UnitMesh* created = new UnitMesh(create(segments));
+                const UnitMesh* published = nullptr;
+                if (slots[segments].compare_exchange_strong(published, created, std::memory_order_acq_rel,
+                                                                                 std::memory_order_acquire))
+                    return *created;
+                delete created;
+                return *published;
+            }
+            std::lock_guard<std::mutex> lock { OverflowMutex };
+            std::unique_ptr<UnitMesh>& mesh = overflow[segments];
+            if (!mesh)
+                mesh = std::make_unique<UnitMesh>(create(segments));
+            return *mesh;
+        }
+
+        UnitMeshCache() = default;
+        ~UnitMeshCache()
+        {
+            for (int i = 0; i < MaxSlots; ++i) {
+                delete SphereSlots[i].load(std::memory_order_relaxed);
+                delete CircleSlots[i].load(std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        static UnitMeshCache& instance()
+        {
+            static UnitMeshCache cache;
+            return cache;
+        }
+        const UnitMesh& sphere(int segments) { return get(SphereSlots, SphereOverflow, std::max(segments, 2), createUnitSphere); }
+        const UnitMesh& circle(int segments) { return get(CircleSlots, CircleOverflow, std::max(segments, 1), createUnitCircle); }
+    };
+
+    // out[i] = origin + axisX*unit.x + axisY*unit.y + axisZ*unit.z, `outStride` in floats
+    struct AffineTransform
+    {
+        Vector3 origin, axisX, axisY, axisZ;
+
+        static AffineTransform scale(Vector3 center, float radius)
+        {
+            return { center, { radius, 0.0f, 0.0f }, { 0.0f, radius, 0.0f }, { 0.0f, 0.0f, radius } };
+        }
+
+        void apply(float* out, int outStride, const float* unit, int count) const
+        {
+            int i = 0;
+        #if AGL_SSE
+            // the 4th lane spills into the next float of `out`, so the last point is written by the scalar loop
+            const __m128 o = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+            const __m128 x = _mm_setr_ps(axisX.x, axisX.y, axisX.z, 0.0f);
+            const __m128 y = _mm_setr_ps(axisY.x, axisY.y, axisY.z, 0.0f);
+            const __m128 z = _mm_setr_ps(axisZ.x, axisZ.y, axisZ.z, 0.0f);
+            for (; i < count - 1; ++i, unit += 3, out += outStride)
+            {
+                const __m128 p = _mm_add_ps(_mm_add_ps(o, _mm_mul_ps(x, _mm_set1_ps(unit[0]))),
+                                            _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(unit[1])),
+                                                       _mm_mul_ps(z, _mm_set1_ps(unit[2]))));
+                _mm_storeu_ps(out, p);
+            }
+        #endif
+            for (; i < count; ++i, unit += 3, out += outStride)
+            {
+                out[0] = origin.x + axisX.x*unit[0] + axisY.x*unit[1] + axisZ.x*unit[2];
+                out[1] = origin.y + axisX.y*unit[0] + axisY.y*unit[1] + axisZ.y*unit[2];
+                out[2] = origin.z + axisX.z*unit[0] + axisY.z*unit[1] + axisZ.z*unit[2];
+            }
+        }
+    };
+
+    constexpr int VertexFloats = sizeof(Vertex3Color) / sizeof(float); // Vertex3Color stride for AffineTransform
+
+    // scales and moves a white unit mesh to every offset with InstanceOffsetColor
+    static void createInstances(VertexBuffer& outBuffer, const GLDraw3D& unit,
+                                rpp::element_range<const Vector3> offsets, float scale, Color color)
+    {
+        outBuffer.update<Vertex3Color>(unit.Vertices(), unit.Indices());
+
+        InstanceOffsetColor instance;
+        instance.scale = scale;
+        instance.r = toUNorm8(color.r);
+        instance.g = toUNorm8(color.g);
+        instance.b = toUNorm8(color.b);
+        instance.a = toUNorm8(color.a);
+
+        vector<InstanceOffsetColor> instances;
+        instances.reserve(offsets.size());
+        for (const Vector3& pt : offsets)
+        {
+            instance.x = pt.x;
+            instance.y = pt.y;
+            instance.z = pt.z;
+            instances.push_back(instance);
+        }
+        outBuffer.setInstances(instances);
+    }
+
     VertexBuffer GLDraw3D::CreatePoints(rpp::element_range<const Vector3> points, float radius, Color color)
     {
-        GLDraw3D draw;
-        draw.Points(points, radius, color);
-        return draw.CreateBuffer();
+        VertexBuffer buf;
+        CreatePoints(buf, points, radius, color);
+        return buf;
     }
 
-    void GLDraw3D::Append(const GLDraw3D& draw)
+    void GLDraw3D::CreatePoints(VertexBuffer& outBuffer, rpp::element_range<const Vector3> points,
+                                float radius, Color color)
     {
-        size_t offset = vertices.size();
-        vertices.insert(vertices.end(), draw.vertices.begin(), draw.vertices.end());
+        if (!VertexBuffer::instancingSupported())
+        {
+            GLDraw3D draw;
+            draw.Points(points, radius, color);
+            draw.CreateBuffer(outBuffer);
+            return;
+        }
 
-        size_t updateStart = indices.size();
-        indices.insert(indices.end(), draw.indices.begin(), draw.indices.end());
+        GLDraw3D unit; // white unit prism, colored and scaled per instance
+        unit.Prism(Vector3::Zero(), 1.0f, Color::White());
+        createInstances(outBuffer, unit, points, radius, color);
+    }
 
-        size_t numIndices = indices.size();
-        index_t* indexPtr = indices.data();
-        for (size_t i = updateStart; i < numIndices; ++i)
-            indexPtr[i] += offset;
+    VertexBuffer GLDraw3D::CreateSpheres(rpp::element_range<const Vector3> centers, float radius, Color color)
+    {
+        VertexBuffer buf;
+        CreateSpheres(buf, centers, radius, color);
+        return buf;
+    }
+
+    void GLDraw3D::CreateSpheres(VertexBuffer& outBuffer, rpp::element_range<const Vector3> centers,
+                                 float radius, Color color)
+    {
+        if (!VertexBuffer::instancingSupported())
+        {
+            GLDraw3D draw;
+            for (const Vector3& center : centers)
+                draw.Sphere(center, radius, color);
+            draw.CreateBuffer(outBuffer);
+            return;
+        }
+
+        // unit sphere with the segment count Sphere() would pick for this radius
+        const int segments = 6 + (int(radius) / 6);
+        const UnitMesh& sphere = UnitMeshCache::instance().sphere(segments);
+        GLDraw3D unit;
+        unit.vertices.resize(sphere.numVertices());
+        AffineTransform::scale(Vector3::Zero(), 1.0f).apply(&unit.vertices[0].x, VertexFloats, sphere.positions.data(), sphere.numVertices());
+        for (Vertex3Color& v : unit.vertices) {
+            v.r = 1.0f; v.g = 1.0f; v.b = 1.0f; v.a = 1.0f;
+        }
+        unit.indices = sphere.indices;
+        createInstances(outBuffer, unit, centers, radius, color);
+    }
+
+    void GLDraw3D::Append(const GLDraw3D& draw)
+    {
+        const size_t offset = vertices.size();
+        const size_t numIndices = indices.size();
+        vertices.insert(vertices.end(), draw.vertices.begin(), draw.vertices.end());
+        indices.resize(numIndices + draw.indices.size());
+        MeshOptimizer::rebaseIndices(&indices[numIndices], draw.indices.data(),
+                                     (int)draw.indices.size(), (index_t)offset);
     }
 
     void GLDraw3D::Points(rpp::element_range<const Vector3> points, float radius, Color color)
@@ -384,10 +695,18 @@ namespace AGL
         indices .clear();
     }
 
+    // grows geometrically, an exact reserve per shape would reallocate on every call
+    template<class T> static void reserveMore(vector<T>& v, size_t count)
+    {
+        const size_t needed = v.size() + count;
+        if (needed > v.capacity())
+            v.reserve(std::max(needed, v.capacity() * 2));
+    }
+
     void GLDraw3D::Reserve(int newVertices, int newTriangles)
     {
-        vertices.reserve(vertices.size() + newVertices);
-        indices .reserve(indices.size()  + newTriangles*6);
+        reserveMore(vertices, newVertices);
+        reserveMore(indices, size_t(newTriangles)*6);
     }
 
     void GLDraw3D::ReserveLines(int numLines)
@@ -446,6 +765,140 @@ namespace AGL
         addFace(3, 5, 4); // bot cap
     }
 
+    // index pattern of a single Line(), relative to its first vertex
+    static constexpr index_t LineIndices[24] = {
+        0, 1, 2, // top cap
+        0, 3, 4,  0, 4, 1,
+        1, 4, 5,  1, 5, 2,
+        2, 5, 3,  2, 3, 0,
+        3, 5, 4, // bot cap
+    };
+
+    // Line() vertex offsets from `a` for a block of segments, in SoA form
+    struct LineFrames
+    {
+        static constexpr int Block = 16;
+        float dx[Block], dy[Block], dz[Block]; // b - a
+        float ox[3][Block], oy[3][Block], oz[3][Block];
+
+        // same math as Line(): localZ = |ab|, localX = localZ x |localZ + 1|, localY = localZ x localX
+        void compute(int m, float r)
+        {
+        #if AGL_SSE
+            for (int i = m; i < ((m + 3) & ~3); ++i) // pad the last SIMD lane
+                dx[i] = dy[i] = dz[i] = 0.0f;
+
+            const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+            const __m128 R = _mm_set1_ps(r), negR = _mm_set1_ps(-r);
+            for (int i = 0; i < m; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(dx + i), y = _mm_loadu_ps(dy + i), z = _mm_loadu_ps(dz + i);
+                const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+                const __m128 invZ = _mm_and_ps(_mm_cmpgt_ps(len2, zero), _mm_div_ps(one, _mm_sqrt_ps(len2)));
+                const __m128 zx = _mm_mul_ps(x, invZ), zy = _mm_mul_ps(y, invZ), zz = _mm_mul_ps(z, invZ);
+
+                const __m128 ux = _mm_add_ps(zx, one), uy = _mm_add_ps(zy, one), uz = _mm_add_ps(zz, one);
+                const __m128 invU = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+                                        _mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy)), _mm_mul_ps(uz, uz))));
+                const __m128 xx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(zy, uz), _mm_mul_ps(zz, uy)), invU);
+                const __m128 xy = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(zz, ux), _mm_mul_ps(zx, uz)), invU);
+                const __m128 xz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(zx, uy), _mm_mul_ps(zy, ux)), invU);
+
+                const __m128 yx = _mm_sub_ps(_mm_mul_ps(zy, xz), _mm_mul_ps(zz, xy));
+                const __m128 yy = _mm_sub_ps(_mm_mul_ps(zz, xx), _mm_mul_ps(zx, xz));
+                const __m128 yz = _mm_sub_ps(_mm_mul_ps(zx, xy), _mm_mul_ps(zy, xx));
+
+                _mm_storeu_ps(ox[0] + i, _mm_mul_ps(negR, _mm_add_ps(xx, yx)));
+                _mm_storeu_ps(oy[0] + i, _mm_mul_ps(negR, _mm_add_ps(xy, yy)));
+                _mm_storeu_ps(oz[0] + i, _mm_mul_ps(negR, _mm_add_ps(xz, yz)));
+                _mm_storeu_ps(ox[1] + i, _mm_mul_ps(R, _mm_sub_ps(xx, yx)));
+                _mm_storeu_ps(oy[1] + i, _mm_mul_ps(R, _mm_sub_ps(xy, yy)));
+                _mm_storeu_ps(oz[1] + i, _mm_mul_ps(R, _mm_sub_ps(xz, yz)));
+                _mm_storeu_ps(ox[2] + i, _mm_mul_ps(R, yx));
+                _mm_storeu_ps(oy[2] + i, _mm_mul_ps(R, yy));
+                _mm_storeu_ps(oz[2] + i, _mm_mul_ps(R, yz));
+            }
+        #else
+            for (int i = 0; i < m; ++i)
+            {
+                const float len  = sqrtf(dx[i]*dx[i] + dy[i]*dy[i] + dz[i]*dz[i]);
+                const float invZ = len > 0.0f ? 1.0f / len : 0.0f;
+                const float zx = dx[i]*invZ, zy = dy[i]*invZ, zz = dz[i]*invZ;
+
+                const float ux = zx + 1.0f, uy = zy + 1.0f, uz = zz + 1.0f;
+                const float invU = 1.0f / sqrtf(ux*ux + uy*uy + uz*uz);
+                const float xx = (zy*uz - zz*uy)*invU;
+                const float xy = (zz*ux - zx*uz)*invU;
+                const float xz = (zx*uy - zy*ux)*invU;
+
+                const float yx = zy*xz - zz*xy;
+                const float yy = zz*xx - zx*xz;
+                const float yz = zx*xy - zy*xx;
+
+                ox[0][i] = -r*(xx + yx); oy[0][i] = -r*(xy + yy); oz[0][i] = -r*(xz + yz);
+                ox[1][i] =  r*(xx - yx); oy[1][i] =  r*(xy - yy); oz[1][i] =  r*(xz - yz);
+                ox[2][i] =  r*yx;        oy[2][i] =  r*yy;        oz[2][i] =  r*yz;
+            }
+        #endif
+        }
+    };
+
+    // Writes `count` Line() segments into presized vertex and index storage
+    static void writeLines(Vertex3Color* v, index_t* idx, index_t n,
+                           const Vector3* a, const Vector3* b, int count,
+                           float lineWidth, Color colorA, Color colorB)
+    {
+        const float r = lineWidth * 0.5f;
+        LineFrames f;
+        for (int first = 0; first < count; first += LineFrames::Block)
+        {
+            const int m = std::min(LineFrames::Block, count - first);
+            for (int i = 0; i < m; ++i)
+            {
+                f.dx[i] = b[first+i].x - a[first+i].x;
+                f.dy[i] = b[first+i].y - a[first+i].y;
+                f.dz[i] = b[first+i].z - a[first+i].z;
+            }
+            f.compute(m, r);
+            for (int i = 0; i < m; ++i, v += 6)
+            {
+                const Vector3& p = a[first+i];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float x = p.x + f.ox[k][i], y = p.y + f.oy[k][i], z = p.z + f.oz[k][i];
+                    v[k].set(x, y, z, colorA);
+                    v[k+3].set(x + f.dx[i], y + f.dy[i], z + f.dz[i], colorB);
+                }
+            }
+        }
+
+        for (int i = 0; i < count; ++i, idx += 24, n += 6)
+            for (int k = 0; k < 24; ++k)
+                idx[k] = n + LineIndices[k];
+    }
+
+    void GLDraw3D::Lines(rpp::element_range<const Vector3> a, rpp::element_range<const Vector3> b,
+                         float lineWidth, Color color)
+    {
+        Lines(a, b, lineWidth, color, color);
+    }
+
+    void GLDraw3D::Lines(rpp::element_range<const Vector3> a, rpp::element_range<const Vector3> b,
+                         float lineWidth, Color colorA, Color colorB)
+    {
+        Assert(a.size() == b.size(), "Lines a(%d) and b(%d) must have the same size", a.size(), b.size());
+        const int count = std::min<int>(a.size(), b.size());
+        if (count <= 0)
+            return;
+
+        const index_t n = (index_t)vertices.size();
+        const size_t numIndices = indices.size();
+        vertices.resize(n + count*6);
+        indices.resize(numIndices + count*24);
+        writeLines(&vertices[n], &indices[numIndices], n, a.data(), b.data(), count,
+                   lineWidth, colorA, colorB);
+    }
+
     void GLDraw3D::Box(Vector3 min, Vector3 max, Color color)
     {
         //       4------7
@@ -484,6 +937,49 @@ namespace AGL
         addSide(1, 5, 6, 2);
     }
 
+    // index pattern of a single Box(), relative to its first vertex
+    static constexpr index_t BoxIndices[36] = {
+        0, 1, 2,  0, 2, 3,
+        3, 2, 6,  3, 6, 7,
+        0, 3, 7,  0, 7, 4,
+        4, 5, 1,  4, 1, 0,
+        7, 6, 5,  7, 5, 4,
+        1, 5, 6,  1, 6, 2,
+    };
+
+    void GLDraw3D::Boxes(rpp::element_range<const BoundingBox> boxes, Color color)
+    {
+        const int count = boxes.size();
+        if (count <= 0)
+            return;
+
+        index_t n = (index_t)vertices.size();
+        const size_t numIndices = indices.size();
+        vertices.resize(n + count*8);
+        indices.resize(numIndices + count*36);
+
+        Vertex3Color* v = &vertices[n];
+        for (const BoundingBox& box : boxes)
+        {
+            const Vector3& min = box.min;
+            const Vector3& max = box.max;
+            v[0].set(max.x, max.y, max.z, color);
+            v[1].set(max.x, min.y, max.z, color);
+            v[2].set(min.x, min.y, max.z, color);
+            v[3].set(min.x, max.y, max.z, color);
+            v[4].set(max.x, max.y, min.z, color);
+            v[5].set(max.x, min.y, min.z, color);
+            v[6].set(min.x, min.y, min.z, color);
+            v[7].set(min.x, max.y, min.z, color);
+            v += 8;
+        }
+
+        index_t* i = &indices[numIndices];
+        for (int box = 0; box < count; ++box, i += 36, n += 8)
+            for (int k = 0; k < 36; ++k)
+                i[k] = n + BoxIndices[k];
+    }
+
     void GLDraw3D::Cube(Vector3 center, float radius, Color color)
     {
         Vector3 offset = { radius, radius, radius };
@@ -491,6 +987,12 @@ namespace AGL
     }
 
     void GLDraw3D::HollowBox(Vector3 min, Vector3 max, float lineWidth, Color color)
+    {
+        BoundingBox box { min, max };
+        HollowBoxes({ &box, 1 }, lineWidth, color);
+    }
+
+    void GLDraw3D::HollowBoxes(rpp::element_range<const BoundingBox> boxes, float lineWidth, Color color)
     {
         //       4------7
         //      /|     /|
@@ -498,32 +1000,42 @@ namespace AGL
         //     | 5----|-6 min
         //     |/     |/
         //     1------2
-        ReserveLines(12);
-
-        Vector3 p0 = max;
-        Vector3 p1 = { max.x, min.y, max.z };
-        Vector3 p2 = { min.x, min.y, max.z };
-        Vector3 p3 = { min.x, max.y, max.z };
-        Vector3 p4 = { max.x, max.y, min.z };
-        Vector3 p5 = { max.x, min.y, min.z };
-        Vector3 p6 = min;
-        Vector3 p7 = { min.x, max.y, min.z };
-
-        Line(p0, p1, lineWidth, color);
-        Line(p0, p3, lineWidth, color);
-        Line(p0, p4, lineWidth, color);
-
-        Line(p2, p1, lineWidth, color);
-        Line(p2, p3, lineWidth, color);
-        Line(p2, p6, lineWidth, color);
-
-        Line(p5, p1, lineWidth, color);
-        Line(p5, p4, lineWidth, color);
-        Line(p5, p6, lineWidth, color);
-        
-        Line(p7, p3, lineWidth, color);
-        Line(p7, p4, lineWidth, color);
-        Line(p7, p6, lineWidth, color);
+        static constexpr int EdgeA[12] = { 0, 0, 0,  2, 2, 2,  5, 5, 5,  7, 7, 7 };
+        static constexpr int EdgeB[12] = { 1, 3, 4,  1, 3, 6,  1, 4, 6,  3, 4, 6 };
+        constexpr int BoxesPerChunk = 16;
+
+        const int count = boxes.size();
+        if (count <= 0)
+            return;
+
+        index_t n = (index_t)vertices.size();
+        size_t numIndices = indices.size();
+        vertices.resize(n + count*12*6);
+        indices.resize(numIndices + count*12*24);
+
+        Vector3 a[BoxesPerChunk*12], b[BoxesPerChunk*12];
+        for (int first = 0; first < count; first += BoxesPerChunk)
+        {
+            const int chunk = std::min(BoxesPerChunk, count - first);
+            for (int k = 0; k < chunk; ++k)
+            {
+                const Vector3& min = boxes[first + k].min;
+                const Vector3& max = boxes[first + k].max;
+                const Vector3 p[8] = {
+                    max, { max.x, min.y, max.z }, { min.x, min.y, max.z }, { min.x, max.y, max.z },
+                    { max.x, max.y, min.z }, { max.x, min.y, min.z }, min, { min.x, max.y, min.z },
+                };
+                for (int e = 0; e < 12; ++e)
+                {
+                    a[k*12 + e] = p[EdgeA[e]];
+                    b[k*12 + e] = p[EdgeB[e]];
+                }
+            }
+            const int numLines = chunk * 12;
+            writeLines(&vertices[n], &indices[numIndices], n, a, b, numLines, lineWidth, color, color);
+            n += numLines*6;
+            numIndices += numLines*24;
+        }
     }
     
     void GLDraw3D::HollowCube(Vector3 center, float radius, float lineWidth, Color color)
@@ -604,122 +1116,217 @@ namespace AGL
 
     void GLDraw3D::HollowCylinder(Vector3 a, Vector3 b, float radius, float lineWidth, int segments, Color color)
     {
-        const float segmentArc = (2.0f * rpp::PIf) / segments;
-        ReserveLines(segments*3);
+        const UnitMesh& circle = UnitMeshCache::instance().circle(segments);
+        segments = circle.numVertices() - 1;
 
         Vector3 ab = b - a;
         Vector3 localZ = ab.normalized(); // Z dir
         Vector3 localX = localZ.cross((localZ + Vector3::One()).normalized());
         Vector3 localY = localZ.cross(localX);
 
-        float alpha = segmentArc;
-        Vector3 A = a + (localY * radius);
+        // both rings of the cylinder, then 3 lines per segment
+        vector<Vector3> ring(circle.numVertices() * 2);
+        AffineTransform bottom { a, localX * radius, localY * radius, Vector3::Zero() };
+        AffineTransform top    { a + ab, localX * radius, localY * radius, Vector3::Zero() };
+        bottom.apply(&ring[0].x, 3, circle.positions.data(), circle.numVertices());
+        top.apply(&ring[circle.numVertices()].x, 3, circle.positions.data(), circle.numVertices());
+        const Vector3* ringA = &ring[0];
+        const Vector3* ringB = &ring[circle.numVertices()];
+
+        vector<Vector3> from(segments * 3), to(segments * 3);
         for (int i = 0; i < segments; ++i)
         {
-            Vector3 offsetX = localX * (sinf(alpha) * radius);
-            Vector3 offsetY = localY * (cosf(alpha) * radius);
-
-            Vector3 B = a + offsetX + offsetY;
-            Line(A, B, lineWidth, color);
-            Line(A, A+ab, lineWidth, color);
-            Line(A+ab, B+ab, lineWidth, color);
-            A = B;
-            alpha += segmentArc;
+            from[i*3 + 0] = ringA[i]; to[i*3 + 0] = ringA[i+1];
+            from[i*3 + 1] = ringA[i]; to[i*3 + 1] = ringB[i];
+            from[i*3 + 2] = ringB[i]; to[i*3 + 2] = ringB[i+1];
         }
+        Lines(from, to, lineWidth, color);
     }
 
     void GLDraw3D::Sphere(Vector3 center, float radius, Color color)
     {
         // adaptive line count
         const int segments = 6 + (int(radius) / 6);
-        const int rings   = segments;
-        const int sectors = segments;
+        const UnitMesh& unit = UnitMeshCache::instance().sphere(segments);
 
-        const int totalVerts   = rings * sectors;
-        const int totalIndices = totalVerts * 6;
-
-        size_t nVerts = vertices.size();
-        vertices.resize(nVerts + totalVerts);
-        Vertex3Color* pVerts = &vertices[nVerts];
+        const index_t n = (index_t)vertices.size();
+        const int numVerts = unit.numVertices();
+        vertices.resize(n + numVerts);
+        Vertex3Color* v = &vertices[n];
+        AffineTransform::scale(center, radius).apply(&v->x, VertexFloats, unit.positions.data(), numVerts);
+        for (int i = 0; i < numVerts; ++i) {
+            v[i].r = color.r; v[i].g = color.g; v[i].b = color.b; v[i].a = color.a;
+        }
 
-        indices.reserve(indices.size() + totalIndices);
+        const size_t numIndices = indices.size();
+        indices.resize(numIndices + unit.indices.size());
+        MeshOptimizer::rebaseIndices(&indices[numIndices], unit.indices.data(), (int)unit.indices.size(), n);
+    }
 
-        auto pushIndices = [&](int r, int s)
-        {
-            int curRow  = r * sectors;
-            int nextRow = (r+1) * sectors;
-            int nextS   = (s+1) % sectors;
+    void GLDraw3D::HollowSphere(Vector3 center, float radius, Color color, float lineWidth)
+    {
+        // adaptive line count
+        const int segments = 8 + (int(radius) / 6);
+        const UnitMesh& unit = UnitMeshCache::instance().sphere(segments);
+
+        // one polyline through all ring points
+        const int numPoints = unit.numVertices();
+        vector<Vector3> points(numPoints);
+        AffineTransform::scale(center, radius).apply(&points[0].x, 3, unit.positions.data(), numPoints);
+        Lines({ points.data(), size_t(numPoints - 1) }, { points.data() + 1, size_t(numPoints - 1) },
+              lineWidth, color);
+    }
 
-            size_t nIndices = indices.size();
-            indices.resize(nIndices + 6);
-            index_t* ind = &indices[nIndices];
-            ind[0] = curRow + s;
-            ind[1] = nextRow + s;
-            ind[2] = nextRow + nextS;
+    ////////////////////////////////////////////////////////////////////////////////
 
-            ind[3] = curRow + s;
-            ind[4] = nextRow + nextS;
-            ind[5] = curRow + nextS;
-        };
+    ParallelDraw3D::ParallelDraw3D(int numShards)
+    {
+        if (numShards <= 0)
+            numShards = (int)std::thread::hardware_concurrency();
+        shards.resize(std::max(numShards, 1));
+        workers.reserve(shards.size() - 1);
+        for (int s = 1; s < (int)shards.size(); ++s)
+            workers.emplace_back([this, s] { WorkerThread(s); });
+    }
 
-        constexpr float PI = rpp::PIf;
-        constexpr float PI_2 = rpp::PIf / 2;
-        const float R = 1./(float)(rings-1);
-        const float S = 1./(float)(sectors-1);
+    ParallelDraw3D::~ParallelDraw3D()
+    {
+        {
+            std::lock_guard<std::mutex> lock { mutex };
+            exit = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
 
-        int vertexId = 0;
-        for (int r = 0; r < rings; ++r)
+    void ParallelDraw3D::WorkerThread(int shard)
+    {
+        uint64_t seen = 0;
+        for (;;)
         {
-            for (int s = 0; s < sectors; ++s)
+            const std::function<void(int)>* func;
+            int count;
             {
-                Vector3 pos {
-                    center.x + radius * cos(2*PI * s * S) * sin( PI * r * R ),
-                    center.y + radius * sin( -PI_2 + PI * r * R ),
-                    center.z + radius * sin(2*PI * s * S) * sin( PI * r * R )
-                };
-
-                pVerts[vertexId++].set(pos, color);
-                if (r < rings-1) {
-                    pushIndices(r, s);
-                }
+                std::unique_lock<std::mutex> lock { mutex };
+                wake.wait(lock, [&] { return exit || generation != seen; });
+                if (exit)
+                    return;
+                seen  = generation;
+                func  = job;
+                count = jobCount;
+            }
+            if (shard < count)
+                (*func)(shard);
+            {
+                std::lock_guard<std::mutex> lock { mutex };
+                if (--pending == 0)
+                    done.notify_one();
             }
         }
     }
 
-    void GLDraw3D::HollowSphere(Vector3 center, float radius, Color color, float lineWidth)
+    int ParallelDraw3D::NumVertices() const
     {
-        // adaptive line count
-        const int segments = 8 + (int(radius) / 6);
-        const int rings   = segments;
-        const int sectors = segments;
+        int count = 0;
+        for (const GLDraw3D& shard : shards)
+            count += (int)shard.vertices.size();
+        return count;
+    }
 
-        const int totalVerts = rings * sectors;
-        ReserveLines(totalVerts);
+    int ParallelDraw3D::NumIndices() const
+    {
+        int count = 0;
+        for (const GLDraw3D& shard : shards)
+            count += (int)shard.indices.size();
+        return count;
+    }
 
-        constexpr float PI = rpp::PIf;
-        constexpr float PI_2 = rpp::PIf / 2;
-        const float R = 1./(float)(rings-1);
-        const float S = 1./(float)(sectors-1);
+    void ParallelDraw3D::Clear()
+    {
+        for (GLDraw3D& shard : shards)
+            shard.Clear();
+    }
+
+    void ParallelDraw3D::Run(int count, const std::function<void(int)>& func) const
+    {
+        if (count <= 1 || workers.empty())
+        {
+            for (int i = 0; i < count; ++i)
+                func(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock { mutex };
+            job      = &func;
+            jobCount = count;
+            pending  = (int)workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        func(0);
+        std::unique_lock<std::mutex> lock { mutex };
+        done.wait(lock, [this] { return pending == 0; });
+        job = nullptr;
+    }
+
+    void ParallelDraw3D::Merge(Vertex3Color* outVertices, index_t* outIndices, index_t baseVertex) const
+    {
+        // prefix sums give every shard its destination range
+        const int numShards = NumShards();
+        vector<int> firstVertex(numShards + 1, 0), firstIndex(numShards + 1, 0);
+        for (int s = 0; s < numShards; ++s)
+        {
+            firstVertex[s+1] = firstVertex[s] + (int)shards[s].vertices.size();
+            firstIndex[s+1]  = firstIndex[s]  + (int)shards[s].indices.size();
+        }
 
-        auto spherePoint = [&](int r, int s) {
-            return Vector3{
-                center.x + radius * cos(2*PI * s * S) * sin( PI * r * R ),
-                center.y + radius * sin( -PI_2 + PI * r * R ),
-                center.z + radius * sin(2*PI * s * S) * sin( PI * r * R )
-            };
+        auto copyShard = [&](int s) {
+            const GLDraw3D& shard = shards[s];
+            if (!shard.vertices.empty())
+                memcpy(outVertices + firstVertex[s], shard.vertices.data(), shard.vertices.size()*sizeof(Vertex3Color));
+            MeshOptimizer::rebaseIndices(outIndices + firstIndex[s], shard.indices.data(),
+                                         (int)shard.indices.size(), baseVertex + (index_t)firstVertex[s]);
         };
 
-        Vector3 A = spherePoint(0, 0);
+        // waking the workers costs more than copying small batches
+        constexpr int MinParallelVertices = 64 * 1024;
+        if (firstVertex[numShards] < MinParallelVertices)
+        {
+            for (int s = 0; s < numShards; ++s)
+                copyShard(s);
+        }
+        else
+        {
+            Run(numShards, copyShard);
+        }
+    }
 
-        for (int r = 0; r < rings; ++r)
+    void ParallelDraw3D::Merge(GLDraw3D& out) const
+    {
+        const size_t numVertices = out.vertices.size();
+        const size_t numIndices  = out.indices.size();
+        out.vertices.resize(numVertices + NumVertices());
+        out.indices.resize(numIndices + NumIndices());
+        Merge(out.vertices.data() + numVertices, out.indices.data() + numIndices, (index_t)numVertices);
+    }
+
+    TransientMesh ParallelDraw3D::Submit(StreamBuffer& stream) const
+    {
+        void* vertices; index_t* indices;
+        TransientMesh mesh = stream.allocate(DrawIndexed, Vertex3Color::layout(), NumVertices(), &vertices,
+                                             NumIndices(), &indices);
+        if (!mesh)
+            return mesh;
+
+        index_t baseVertex = 0;
+        if (!stream.baseVertexSupported()) // bake the stream offset into the indices
         {
-            for (int s = 0; s < sectors; ++s)
-            {
-                Vector3 B = spherePoint(r, s);
-                Line(A, B, lineWidth, color);
-                A = B;
-            }
+            baseVertex = (index_t)mesh.baseVertex;
+            mesh.baseVertex = 0;
         }
+        Merge((Vertex3Color*)vertices, indices, baseVertex);
+        return mesh;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
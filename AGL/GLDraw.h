@@ -1,6 +1,12 @@
 #pragma once
 #include "Shader.h"
+#include "StreamBuffer.h"
+#include "MeshOptimizer.h"
 #include <rpp/collections.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace AGL
 {
@@ -33,6 +39,12 @@ namespace AGL
          */
         VertexBuffer CreateBuffer() const;
 
+        /**
+         * Copies the current state into this frame's StreamBuffer region,
+         * draw the result with stream.draw(mesh) during the same frame
+         */
+        TransientMesh Submit(StreamBuffer& stream) const;
+
         /**
          * @note Clears the current drawing
          */
@@ -179,13 +191,19 @@ namespace AGL
 
     ////////////////////////////////////////////////////////////////////////////////
 
+    using rpp::BoundingBox;
+
     class GLDraw3D
     {
+        friend class ParallelDraw3D;
         vector<Vertex3Color> vertices;
         vector<index_t> indices;
 
     public:
 
+        const vector<Vertex3Color>& Vertices() const { return vertices; }
+        const vector<index_t>& Indices() const { return indices; }
+
         /**
          * @note Creates a VertexBuffer based on the current state
          */
@@ -197,12 +215,59 @@ namespace AGL
          */
         VertexBuffer CreateBuffer() const;
 
+        /**
+         * Splits the current state into buffers of at most `maxVertices` vertices,
+         * so that large batches still use 16-bit indices. Triangles are never split.
+         * Existing buffers in `outBuffers` are updated in place
+         */
+        void CreateBuffers(vector<VertexBuffer>& outBuffers,
+                           int maxVertices = VertexBuffer::MaxShortIndexVertices) const;
+
+        /**
+         * Copies the current state into this frame's StreamBuffer region,
+         * draw the result with stream.draw(mesh) during the same frame
+         */
+        TransientMesh Submit(StreamBuffer& stream) const;
+
+        /**
+         * Reorders the current state for vertex cache, overdraw and vertex fetch,
+         * call before CreateBuffer() for geometry that is drawn many times
+         * @param flags MeshOptimizeFlags
+         */
+        MeshOptimizeStats Optimize(int flags = OptimizeAll);
+
+        /**
+         * Merges duplicate vertices, eg at Sphere seams or shared corners after Append()
+         * @param epsilon Position and color quantization grid, 0 for exact matches
+         * @return Number of vertices removed
+         */
+        int Weld(float epsilon = 0.0f);
+
+        /**
+         * Creates an instanced point cloud: a single unit Prism mesh plus one
+         * InstanceOffsetColor per point, which is ~13x less memory than Points().
+         * Draw it with a sf_Instanced SceneShaders() variant, eg as an Actor Mesh.
+         * Falls back to Points() geometry if instancing is not supported
+         */
         static VertexBuffer CreatePoints(rpp::element_range<const Vector3> points, float radius, Color color);
+        static void CreatePoints(VertexBuffer& outBuffer, rpp::element_range<const Vector3> points,
+                                 float radius, Color color);
+
+        /**
+         * Creates instanced spheres: the cached unit Sphere() mesh plus one
+         * InstanceOffsetColor per center. Falls back to Sphere() geometry
+         * if instancing is not supported
+         */
+        static VertexBuffer CreateSpheres(rpp::element_range<const Vector3> centers, float radius, Color color);
+        static void CreateSpheres(VertexBuffer& outBuffer, rpp::element_range<const Vector3> centers,
+                                  float radius, Color color);
 
+        // concatenates `draw` without deduplication, call Weld() afterwards to merge shared vertices
         void Append(const GLDraw3D& draw);
 
         /**
          * Calls Point for each element in `points` with the given radius
+         * @note For large point clouds use the instanced CreatePoints() instead
          */
         void Points(rpp::element_range<const Vector3> points, float radius, Color color);
 
@@ -234,6 +299,15 @@ namespace AGL
         void Line(Vector3 a, Vector3 b, float lineWidth, Color colorA, Color colorB);
         void Line(Vector3 a, Vector3 b, float lineWidth, Color color);
 
+        /**
+         * Draws a Line() from each a[i] to b[i]. Much faster than calling Line() in a loop:
+         * storage is grown once and the line frames are computed in blocks that vectorize
+         */
+        void Lines(rpp::element_range<const Vector3> a, rpp::element_range<const Vector3> b,
+                   float lineWidth, Color colorA, Color colorB);
+        void Lines(rpp::element_range<const Vector3> a, rpp::element_range<const Vector3> b,
+                   float lineWidth, Color color);
+
         /**
          * Draws a 3D box. Good for very basic 3D visualizations
          *       4------7
@@ -244,6 +318,9 @@ namespace AGL
          *     1------2
          */
         void Box(Vector3 min, Vector3 max, Color color);
+
+        // Box() for each element, with a single storage resize
+        void Boxes(rpp::element_range<const BoundingBox> boxes, Color color);
         
         /**
          * Draws a simple cube. Good for very basic 3D visualizations
@@ -261,6 +338,9 @@ namespace AGL
          */
         void HollowBox(Vector3 min, Vector3 max, float lineWidth, Color color);
 
+        // HollowBox() for each element, drawn with the bulk Lines() path
+        void HollowBoxes(rpp::element_range<const BoundingBox> boxes, float lineWidth, Color color);
+
         /**
          * Draws a more complex hollow cube using lines
          */
@@ -294,10 +374,105 @@ namespace AGL
         void HollowCylinder(Vector3 a, Vector3 b, float radius, float lineWidth, Color color);
         void HollowCylinder(Vector3 a, Vector3 b, float radius, float lineWidth, int segments, Color color);
 
+        /**
+         * Spheres and cylinders are transformed from unit meshes which are
+         * computed once per segment count and shared by all GLDraw3D instances
+         */
         void Sphere(Vector3 center, float radius, Color color);
         void HollowSphere(Vector3 center, float radius, Color color, float lineWidth);
 
     };
 
     ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Builds GLDraw3D geometry on several threads. Every worker draws into its own
+     * GLDraw3D shard. The shards are then merged using a prefix sum over their vertex
+     * counts: each shard is copied on its own thread straight into the destination,
+     * eg a StreamBuffer mapping, and its indices are rebased during the copy.
+     *
+     * @code
+     *     ParallelDraw3D draw;
+     *     draw.Build((int)paths.size(), [&](GLDraw3D& shard, int i) {
+     *         shard.Lines(paths[i].from, paths[i].to, 0.05f, Color::Green());
+     *     });
+     *     stream.draw(draw.Submit(stream));
+     * @endcode
+     */
+    class AGL_API ParallelDraw3D
+    {
+        vector<GLDraw3D> shards;
+
+        // persistent workers, worker w runs shard w+1 and the calling thread runs shard 0
+        vector<std::thread> workers;
+        mutable std::mutex mutex;
+        mutable std::condition_variable wake; // a new job was posted
+        mutable std::condition_variable done; // all workers finished the job
+        mutable const std::function<void(int)>* job = nullptr;
+        mutable int jobCount = 0;
+        mutable int pending = 0;          // workers still running the current job
+        mutable uint64_t generation = 0;  // incremented for every posted job
+        bool exit = false;
+
+    public:
+        /**
+         * Starts numShards-1 worker threads which are kept until destruction,
+         * Build() and Merge() must not be called concurrently on the same object
+         * @param numShards Number of worker threads, 0 for std::thread::hardware_concurrency()
+         */
+        explicit ParallelDraw3D(int numShards = 0);
+        ~ParallelDraw3D();
+
+        ParallelDraw3D(const ParallelDraw3D&) = delete; // NO COPY
+        ParallelDraw3D& operator=(const ParallelDraw3D&) = delete;
+
+        int NumShards() const { return (int)shards.size(); }
+        GLDraw3D& Shard(int i) { return shards[i]; }
+        const GLDraw3D& Shard(int i) const { return shards[i]; }
+
+        int NumVertices() const;
+        int NumIndices() const;
+
+        /**
+         * Clears all shards, their storage is kept for the next frame
+         */
+        void Clear();
+
+        /**
+         * Calls draw(shard, i) for every i in [0, count). Each shard draws a contiguous
+         * range of i on its own thread, so the merged result keeps the order of i
+         */
+        template<class Func> void Build(int count, const Func& draw)
+        {
+            const int numShards = NumShards();
+            Run(numShards, [&](int s) {
+                GLDraw3D& shard = shards[s];
+                const int last = int(int64_t(count) * (s + 1) / numShards);
+                for (int i = int(int64_t(count) * s / numShards); i < last; ++i)
+                    draw(shard, i);
+            });
+        }
+
+        /**
+         * Merges all shards into preallocated storage of NumVertices() and NumIndices()
+         * @param baseVertex Added to every index, eg the first vertex of outVertices in its buffer
+         */
+        void Merge(Vertex3Color* outVertices, index_t* outIndices, index_t baseVertex = 0) const;
+
+        // appends all shards to `out`
+        void Merge(GLDraw3D& out) const;
+
+        /**
+         * Merges all shards directly into this frame's StreamBuffer region,
+         * draw the result with stream.draw(mesh) during the same frame
+         */
+        TransientMesh Submit(StreamBuffer& stream) const;
+
+    private:
+        // calls func(i) for i in [0, count) on the workers, count <= NumShards()
+        void Run(int count, const std::function<void(int)>& func) const;
+        void WorkerThread(int shard);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
 }
@@ -0,0 +1,180 @@
+#include "GLState.h"
+#include "OpenGL.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static GLState* CurrentState = nullptr;
+
+    GLState::~GLState()
+    {
+        if (CurrentState == this)
+            CurrentState = nullptr;
+    }
+
+    GLState& GLState::current()
+    {
+        if (CurrentState)
+            return *CurrentState;
+        static GLState defaultState; // a fresh context has everything unbound
+        return defaultState;
+    }
+
+    void GLState::makeCurrent(GLState* state)
+    {
+        CurrentState = state;
+    }
+
+    static uint32_t glGetUInt(GLenum name)
+    {
+        GLint value = 0; glGetIntegerv(name, &value); return uint32_t(value);
+    }
+
+    void GLState::invalidate()
+    {
+        Program     = glGetUInt(GL_CURRENT_PROGRAM);
+        VertexArray = glGetUInt(GL_VERTEX_ARRAY_BINDING);
+        FrameBuffer = glGetUInt(GL_FRAMEBUFFER_BINDING);
+        ActiveUnit  = int(glGetUInt(GL_ACTIVE_TEXTURE) - GL_TEXTURE0);
+        for (int unit = 0; unit < MaxTextureUnits; ++unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            Textures[unit] = glGetUInt(GL_TEXTURE_BINDING_2D);
+        }
+        glActiveTexture(GL_TEXTURE0 + ActiveUnit);
+        Blend     = glIsEnabled(GL_BLEND) ? 1 : 0;
+        DepthTest = glIsEnabled(GL_DEPTH_TEST) ? 1 : 0;
+        BlendSrc  = glGetUInt(GL_BLEND_SRC_RGB);
+        BlendDst  = glGetUInt(GL_BLEND_DST_RGB);
+        DepthFunc = glGetUInt(GL_DEPTH_FUNC);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void GLState::useProgram(uint32_t program)
+    {
+        if (Program == program) {
+            ++Stats.program.elided;
+            return;
+        }
+        glUseProgram(program);
+        Program = program;
+        ++Stats.program.issued;
+    }
+
+    void GLState::bindVertexArray(uint32_t vertexArray)
+    {
+        if (VertexArray == vertexArray) {
+            ++Stats.vertexArray.elided;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        VertexArray = vertexArray;
+        ++Stats.vertexArray.issued;
+    }
+
+    void GLState::bindTexture(int unit, uint32_t texture)
+    {
+        // callers rely on `unit` being active afterwards, eg for glTexParameter
+        if (ActiveUnit != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            ActiveUnit = unit;
+        }
+        if (Textures[unit] == texture) {
+            ++Stats.texture.elided;
+            return;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        Textures[unit] = texture;
+        ++Stats.texture.issued;
+    }
+
+    void GLState::bindFramebuffer(uint32_t frameBuffer)
+    {
+        if (FrameBuffer == frameBuffer) {
+            ++Stats.framebuffer.elided;
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        FrameBuffer = frameBuffer;
+        ++Stats.framebuffer.issued;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static void setCapability(GLenum cap, int& state, bool enable, GLStateCounter& counter)
+    {
+        if (state == int(enable)) {
+            ++counter.elided;
+            return;
+        }
+        if (enable) glEnable(cap);
+        else        glDisable(cap);
+        state = int(enable);
+        ++counter.issued;
+    }
+
+    void GLState::enableBlend(bool enable)
+    {
+        setCapability(GL_BLEND, Blend, enable, Stats.capability);
+    }
+
+    void GLState::blendFunc(uint32_t src, uint32_t dst)
+    {
+        if (BlendSrc == src && BlendDst == dst) {
+            ++Stats.capability.elided;
+            return;
+        }
+        glBlendFunc(src, dst);
+        BlendSrc = src, BlendDst = dst;
+        ++Stats.capability.issued;
+    }
+
+    void GLState::enableDepthTest(bool enable)
+    {
+        setCapability(GL_DEPTH_TEST, DepthTest, enable, Stats.capability);
+    }
+
+    void GLState::depthFunc(uint32_t func)
+    {
+        if (DepthFunc == func) {
+            ++Stats.capability.elided;
+            return;
+        }
+        glDepthFunc(func);
+        DepthFunc = func;
+        ++Stats.capability.issued;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void GLState::onProgramDeleted(uint32_t program)
+    {
+        // deleting the active program only flags it for deletion, it stays bound
+        // until another program is used, so we must unbind it explicitly
+        if (program && Program == program)
+            useProgram(0);
+    }
+
+    void GLState::onVertexArrayDeleted(uint32_t vertexArray)
+    {
+        if (vertexArray && VertexArray == vertexArray)
+            VertexArray = 0;
+    }
+
+    void GLState::onTextureDeleted(uint32_t texture)
+    {
+        if (!texture) return;
+        for (uint32_t& bound : Textures)
+            if (bound == texture) bound = 0;
+    }
+
+    void GLState::onFramebufferDeleted(uint32_t frameBuffer)
+    {
+        if (frameBuffer && FrameBuffer == frameBuffer)
+            FrameBuffer = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
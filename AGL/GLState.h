@@ -0,0 +1,108 @@
+#pragma once
+#include "AGLConfig.h"
+#include <cstdint>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /** @brief Issued vs elided GL state calls */
+    struct GLStateCounter
+    {
+        int issued = 0; // calls that reached the driver
+        int elided = 0; // redundant calls that were skipped
+    };
+
+    struct GLStateStats
+    {
+        GLStateCounter program;     // glUseProgram
+        GLStateCounter vertexArray; // glBindVertexArray
+        GLStateCounter texture;     // glActiveTexture + glBindTexture
+        GLStateCounter framebuffer; // glBindFramebuffer
+        GLStateCounter capability;  // glEnable/glDisable, glBlendFunc, glDepthFunc
+
+        int totalIssued() const {
+            return program.issued + vertexArray.issued + texture.issued + framebuffer.issued + capability.issued;
+        }
+        int totalElided() const {
+            return program.elided + vertexArray.elided + texture.elided + framebuffer.elided + capability.elided;
+        }
+    };
+
+
+    /**
+     * Shadows the GL binding state of a single context and skips redundant
+     * state changes. This also removes the need for synchronous glGet* queries
+     * such as GL_CURRENT_PROGRAM or GL_FRAMEBUFFER_BINDING.
+     *
+     * @note All AGL code binds programs, VAOs, textures and framebuffers through
+     *       the current GLState. If you issue raw GL binding calls yourself,
+     *       call GLState::current().invalidate() afterwards.
+     */
+    class AGL_API GLState
+    {
+    public:
+        static constexpr int MaxTextureUnits = 16;
+
+    private:
+        uint32_t Program     = 0;
+        uint32_t VertexArray = 0;
+        uint32_t FrameBuffer = 0;
+        int      ActiveUnit  = 0;
+        uint32_t Textures[MaxTextureUnits] = {};
+
+        // -1: unknown, forces the next call through to the driver
+        int Blend     = -1;
+        int DepthTest = -1;
+        uint32_t BlendSrc  = 0;
+        uint32_t BlendDst  = 0;
+        uint32_t DepthFunc = 0;
+
+        GLStateStats Stats;
+
+    public:
+
+        GLState() = default;
+        ~GLState();
+        GLState(const GLState&) = delete; // NOCOPY
+        GLState& operator=(const GLState&) = delete;
+
+        /**
+         * @return State tracker of the current GL context. If no context has
+         *         been made current, a default state tracker is returned.
+         */
+        static GLState& current();
+
+        /** @brief Sets the state tracker for the current GL context (can be null) */
+        static void makeCurrent(GLState* state);
+
+        /** @brief Re-reads all tracked state from the driver */
+        void invalidate();
+
+        void useProgram(uint32_t program);
+        void bindVertexArray(uint32_t vertexArray);
+        void bindTexture(int unit, uint32_t texture);
+        void bindFramebuffer(uint32_t frameBuffer);
+
+        void enableBlend(bool enable);
+        void blendFunc(uint32_t src, uint32_t dst);
+        void enableDepthTest(bool enable);
+        void depthFunc(uint32_t func);
+
+        uint32_t program()     const { return Program; }
+        uint32_t vertexArray() const { return VertexArray; }
+        uint32_t frameBuffer() const { return FrameBuffer; }
+        uint32_t texture(int unit) const { return Textures[unit]; }
+
+        // GL resets bindings of deleted objects to 0, these keep the shadow state in sync
+        void onProgramDeleted(uint32_t program);
+        void onVertexArrayDeleted(uint32_t vertexArray);
+        void onTextureDeleted(uint32_t texture);
+        void onFramebufferDeleted(uint32_t frameBuffer);
+
+        const GLStateStats& stats() const { return Stats; }
+        void resetStats() { Stats = GLStateStats{}; }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
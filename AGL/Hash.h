@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * 64-bit FNV-1a hash, used for content-addressed caching of assets.
+     * @param seed Previous hash result if hashing in multiple parts
+     */
+    inline uint64_t fnv1a64(const void* data, size_t len, uint64_t seed = 14695981039346656037ULL)
+    {
+        uint64_t hash = seed;
+        auto* p = (const uint8_t*)data;
+        for (size_t i = 0; i < len; ++i)
+            hash = (hash ^ p[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    /**
+     * 32-bit FNV-1a hash of a null terminated string, can be evaluated at compile time
+     */
+    constexpr uint32_t fnv1a32(const char* str, uint32_t hash = 2166136261u)
+    {
+        return *str ? fnv1a32(str + 1, (hash ^ uint8_t(*str)) * 16777619u) : hash;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
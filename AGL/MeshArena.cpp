@@ -0,0 +1,421 @@
+#include "MeshArena.h"
+#include "OpenGL.h"
+#include "GLState.h"
+#include <algorithm>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    int RangeAllocator::allocate(int count)
+    {
+        int best = -1;
+        for (int i = 0; i < (int)FreeRanges.size(); ++i)
+        {
+            const int size = FreeRanges[i].count;
+            if (size >= count && (best == -1 || size < FreeRanges[best].count))
+            {
+                best = i;
+                if (size == count) break; // exact fit
+            }
+        }
+        if (best == -1)
+            return -1;
+
+        Range& range = FreeRanges[best];
+        const int offset = range.offset;
+        range.offset += count;
+        range.count  -= count;
+        if (range.count == 0)
+            FreeRanges.erase(FreeRanges.begin() + best);
+        Used += count;
+        return offset;
+    }
+
+    void RangeAllocator::release(int offset, int count)
+    {
+        if (count <= 0)
+            return;
+        auto it = std::lower_bound(FreeRanges.begin(), FreeRanges.end(), offset,
+                                   [](const Range& r, int off) { return r.offset < off; });
+        it = FreeRanges.insert(it, Range{ offset, count });
+        Used -= count;
+
+        // merge with the next and previous free ranges
+        auto next = it + 1;
+        if (next != FreeRanges.end() && it->offset + it->count == next->offset)
+        {
+            it->count += next->count;
+            FreeRanges.erase(next);
+        }
+        if (it != FreeRanges.begin())
+        {
+            auto prev = it - 1;
+            if (prev->offset + prev->count == it->offset)
+            {
+                prev->count += it->count;
+                FreeRanges.erase(it);
+            }
+        }
+    }
+
+    void RangeAllocator::grow(int newCapacity)
+    {
+        if (newCapacity <= Capacity)
+            return;
+        const int oldCapacity = Capacity;
+        Capacity = newCapacity;
+        Used += newCapacity - oldCapacity; // release() subtracts it again
+        release(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    void RangeAllocator::reset(int capacity, int used)
+    {
+        Capacity = capacity;
+        Used = used;
+        FreeRanges.clear();
+        if (used < capacity)
+            FreeRanges.push_back(Range{ used, capacity - used });
+    }
+
+    void RangeAllocator::compact(const int* counts, int numRanges, int* outOffsets)
+    {
+        int next = 0;
+        for (int i = 0; i < numRanges; ++i)
+        {
+            outOffsets[i] = next;
+            next += counts[i];
+        }
+        reset(Capacity, next);
+    }
+
+    int RangeAllocator::largestFree() const
+    {
+        int largest = 0;
+        for (const Range& r : FreeRanges)
+            largest = std::max(largest, r.count);
+        return largest;
+    }
+
+    bool RangeAllocator::fragmented() const
+    {
+        return FreeRanges.size() > 1
+            || (FreeRanges.size() == 1 && FreeRanges[0].offset + FreeRanges[0].count != Capacity);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    struct MeshArena::Pool
+    {
+        VertexDescr layout;
+        uint32_t vertexArray  = 0;
+        uint32_t vertexBuffer = 0;
+        uint32_t indexBuffer  = 0;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        int allocations = 0;
+    };
+
+    MeshArena::MeshArena()
+    {
+    }
+
+    MeshArena::~MeshArena()
+    {
+        clear();
+    }
+
+    bool MeshArena::supported()
+    {
+        return (GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex)
+            && (GLEW_VERSION_3_1 || GLEW_ARB_copy_buffer);
+    }
+
+    // @return New buffer of `newBytes` with the first `oldBytes` copied from `oldBuffer`
+    static uint32_t reallocBuffer(uint32_t oldBuffer, int oldBytes, int newBytes)
+    {
+        uint32_t buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        if (oldBuffer)
+        {
+            if (oldBytes > 0)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &oldBuffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    int MeshArena::findPool(const VertexDescr& layout)
+    {
+        for (int i = 0; i < (int)Pools.size(); ++i)
+            if (Pools[i]->layout == layout) return i;
+
+        Pools.emplace_back(new Pool{});
+        Pool& pool = *Pools.back();
+        pool.layout = layout;
+        glGenVertexArrays(1, &pool.vertexArray);
+        return (int)Pools.size() - 1;
+    }
+
+    void MeshArena::setupVertexArray(Pool& pool)
+    {
+        GLState& state = GLState::current();
+        state.bindVertexArray(pool.vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+        pool.layout.enableAttribs(); // attrib pointers capture the new buffer
+        if (DrawIdBuffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, DrawIdBuffer);
+            VertexDescr drawId { sizeof(float), a_DrawId,1 };
+            drawId.enableAttribs(0, 1);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+        state.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void MeshArena::reserve(Pool& pool, int numVerts, int numIndices)
+    {
+        bool changed = false;
+        if (pool.vertices.largestFree() < numVerts)
+        {
+            const int capacity = pool.vertices.capacity();
+            const int newCapacity = std::max({ capacity*2, capacity + numVerts, InitialVertices });
+            const int sizeOf = pool.layout.sizeOf;
+            pool.vertexBuffer = reallocBuffer(pool.vertexBuffer, capacity*sizeOf, newCapacity*sizeOf);
+            pool.vertices.grow(newCapacity);
+            changed = true;
+        }
+        if (numIndices > 0 && pool.indices.largestFree() < numIndices)
+        {
+            const int capacity = pool.indices.capacity();
+            const int newCapacity = std::max({ capacity*2, capacity + numIndices, InitialIndices });
+            pool.indexBuffer = reallocBuffer(pool.indexBuffer, capacity*sizeof(index_t), newCapacity*sizeof(index_t));
+            pool.indices.grow(newCapacity);
+            changed = true;
+        }
+        if (changed)
+            setupVertexArray(pool);
+    }
+
+    int MeshArena::allocate(const void* verts, int numVerts, const index_t* indices, int numIndices,
+                            const VertexDescr& layout)
+    {
+        if (numVerts <= 0) {
+            LogError("MeshArena::allocate failed: mesh has no vertices");
+            return -1;
+        }
+
+        Slot s;
+        s.pool = findPool(layout);
+        Pool& pool = *Pools[s.pool];
+        reserve(pool, numVerts, numIndices);
+
+        s.numVertices = numVerts;
+        s.numIndices  = numIndices;
+        s.baseVertex  = pool.vertices.allocate(numVerts);
+        s.firstIndex  = numIndices > 0 ? pool.indices.allocate(numIndices) : 0;
+        ++pool.allocations;
+
+        int slot;
+        if (!FreeSlots.empty()) {
+            slot = FreeSlots.back();
+            FreeSlots.pop_back();
+            Slots[slot] = s;
+        }
+        else {
+            slot = (int)Slots.size();
+            Slots.push_back(s);
+        }
+        write(slot, verts, indices);
+        return slot;
+    }
+
+    void MeshArena::write(int slot, const void* verts, const index_t* indices)
+    {
+        const Slot& s = Slots[slot];
+        const Pool& pool = *Pools[s.pool];
+        const int sizeOf = pool.layout.sizeOf;
+
+        // COPY_WRITE target doesn't disturb the element buffer binding of the current VAO
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, s.baseVertex*sizeOf, s.numVertices*sizeOf, verts);
+        if (s.numIndices > 0)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, s.firstIndex*sizeof(index_t),
+                            s.numIndices*sizeof(index_t), indices);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void MeshArena::free(int slot)
+    {
+        if (slot < 0 || slot >= (int)Slots.size() || Slots[slot].pool == -1)
+            return;
+        Slot& s = Slots[slot];
+        Pool& pool = *Pools[s.pool];
+        pool.vertices.release(s.baseVertex, s.numVertices);
+        if (s.numIndices > 0)
+            pool.indices.release(s.firstIndex, s.numIndices);
+        --pool.allocations;
+        s = Slot{};
+        FreeSlots.push_back(slot);
+    }
+
+    void MeshArena::draw(int slot, DrawMode mode) const
+    {
+        const Slot& s = Slots[slot];
+        const Pool& pool = *Pools[s.pool];
+
+        // all meshes of this layout share the VAO, so the state tracker skips rebinding it
+        GLState::current().bindVertexArray(pool.vertexArray);
+        if (mode == DrawIndexed)
+        {
+            const void* indices = (const void*)(uintptr_t(s.firstIndex) * sizeof(index_t));
+            glDrawElementsBaseVertex(GL_TRIANGLES, s.numIndices, GL_UNSIGNED_INT, (void*)indices, s.baseVertex);
+        }
+        else if (mode != DrawNone)
+        {
+            static constexpr GLenum modeMap[] = {
+                GL_NONE, GL_NONE, GL_TRIANGLES, GL_TRIANGLE_STRIP,
+                GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_POINTS,
+            };
+            glDrawArrays(modeMap[mode], s.baseVertex, s.numVertices);
+        }
+    }
+
+    MeshArena::DrawRange MeshArena::range(int slot) const
+    {
+        const Slot& s = Slots[slot];
+        DrawRange r;
+        r.vertexArray = Pools[s.pool]->vertexArray;
+        r.baseVertex  = s.baseVertex;
+        r.firstIndex  = s.firstIndex;
+        r.numIndices  = s.numIndices;
+        return r;
+    }
+
+    void MeshArena::enableDrawIds(int maxDraws)
+    {
+        if (maxDraws <= MaxDrawIds)
+            return;
+        vector<float> ids(maxDraws);
+        for (int i = 0; i < maxDraws; ++i)
+            ids[i] = (float)i; // exact up to 2^24
+
+        if (!DrawIdBuffer) glGenBuffers(1, &DrawIdBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, DrawIdBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, maxDraws*sizeof(float), ids.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        MaxDrawIds = maxDraws;
+
+        for (auto& pool : Pools)
+            if (pool->vertexBuffer) setupVertexArray(*pool);
+    }
+
+    void MeshArena::defragment()
+    {
+        vector<int> live, vertexCounts, indexCounts, vertexOffsets, indexOffsets;
+        for (int p = 0; p < (int)Pools.size(); ++p)
+        {
+            Pool& pool = *Pools[p];
+            if (!pool.vertices.fragmented() && !pool.indices.fragmented())
+                continue;
+
+            live.clear();
+            for (int i = 0; i < (int)Slots.size(); ++i)
+                if (Slots[i].pool == p) live.push_back(i);
+            std::sort(live.begin(), live.end(), [this](int a, int b) {
+                return Slots[a].baseVertex < Slots[b].baseVertex;
+            });
+
+            const int numLive = (int)live.size();
+            vertexCounts.resize(numLive); indexCounts.resize(numLive);
+            vertexOffsets.resize(numLive); indexOffsets.resize(numLive);
+            for (int i = 0; i < numLive; ++i)
+            {
+                vertexCounts[i] = Slots[live[i]].numVertices;
+                indexCounts[i]  = Slots[live[i]].numIndices;
+            }
+            pool.vertices.compact(vertexCounts.data(), numLive, vertexOffsets.data());
+            pool.indices.compact(indexCounts.data(), numLive, indexOffsets.data());
+
+            // copy every allocation to the front of new buffers, offsets relative to the pool stay valid
+            const int sizeOf = pool.layout.sizeOf;
+            uint32_t vertexBuffer = reallocBuffer(0, 0, pool.vertices.capacity()*sizeOf);
+            uint32_t indexBuffer  = pool.indexBuffer ? reallocBuffer(0, 0, pool.indices.capacity()*sizeof(index_t)) : 0;
+            for (int i = 0; i < numLive; ++i)
+            {
+                Slot& s = Slots[live[i]];
+                glBindBuffer(GL_COPY_READ_BUFFER,  pool.vertexBuffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                    s.baseVertex*sizeOf, vertexOffsets[i]*sizeOf, s.numVertices*sizeOf);
+                s.baseVertex = vertexOffsets[i];
+                if (s.numIndices > 0)
+                {
+                    glBindBuffer(GL_COPY_READ_BUFFER,  pool.indexBuffer);
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                        s.firstIndex*sizeof(index_t), indexOffsets[i]*sizeof(index_t),
+                                        s.numIndices*sizeof(index_t));
+                    s.firstIndex = indexOffsets[i];
+                }
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER,  0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            glDeleteBuffers(1, &pool.vertexBuffer);
+            if (pool.indexBuffer) glDeleteBuffers(1, &pool.indexBuffer);
+            pool.vertexBuffer = vertexBuffer;
+            pool.indexBuffer  = indexBuffer;
+            setupVertexArray(pool);
+        }
+    }
+
+    void MeshArena::clear()
+    {
+        GLState& state = GLState::current();
+        for (auto& pool : Pools)
+        {
+            if (pool->allocations > 0)
+                LogWarning("MeshArena::clear: %d meshes still allocated", pool->allocations);
+            state.onVertexArrayDeleted(pool->vertexArray);
+            glDeleteVertexArrays(1, &pool->vertexArray);
+            if (pool->vertexBuffer) glDeleteBuffers(1, &pool->vertexBuffer);
+            if (pool->indexBuffer)  glDeleteBuffers(1, &pool->indexBuffer);
+        }
+        Pools.clear();
+        Slots.clear();
+        FreeSlots.clear();
+        if (DrawIdBuffer) glDeleteBuffers(1, &DrawIdBuffer), DrawIdBuffer = 0;
+        MaxDrawIds = 0;
+    }
+
+    MeshArena::Stats MeshArena::stats() const
+    {
+        Stats st;
+        st.pools = (int)Pools.size();
+        for (auto& pool : Pools)
+        {
+            const int sizeOf = pool->layout.sizeOf;
+            st.allocations += pool->allocations;
+            st.vertexBytesUsed     += int64_t(pool->vertices.used()) * sizeOf;
+            st.vertexBytesCapacity += int64_t(pool->vertices.capacity()) * sizeOf;
+            st.indexBytesUsed      += int64_t(pool->indices.used()) * sizeof(index_t);
+            st.indexBytesCapacity  += int64_t(pool->indices.capacity()) * sizeof(index_t);
+            st.freeRanges += pool->vertices.freeRanges() + pool->indices.freeRanges();
+        }
+        return st;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
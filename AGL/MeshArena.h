@@ -0,0 +1,152 @@
+#pragma once
+#include "Shader.h"
+#include <memory>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Free-list range allocator with best-fit allocation and coalescing of freed ranges.
+     * Offsets and counts are in elements, eg vertices or indices
+     */
+    class AGL_API RangeAllocator
+    {
+        struct Range { int offset, count; };
+        vector<Range> FreeRanges; // sorted by offset, adjacent ranges are always merged
+        int Capacity = 0;
+        int Used = 0;
+
+    public:
+        /** @return Offset of the allocated range, or -1 if no free range is large enough */
+        int allocate(int count);
+        void release(int offset, int count);
+
+        /** @brief Adds free space to the end */
+        void grow(int newCapacity);
+
+        /** @brief Marks [0, used) as allocated and everything after it as free */
+        void reset(int capacity, int used);
+
+        /**
+         * Packs `numRanges` live allocations to the front in the given order and frees
+         * everything after them. Only the bookkeeping, the caller moves the data
+         * @param outOffsets Receives the new offset of every range
+         */
+        void compact(const int* counts, int numRanges, int* outOffsets);
+
+        int capacity()   const { return Capacity; }
+        int used()       const { return Used; }
+        int freeRanges() const { return (int)FreeRanges.size(); }
+        int largestFree() const;
+
+        /** @return TRUE if the free space is split by allocations */
+        bool fragmented() const;
+    };
+
+
+    /**
+     * Shares a few large VBO/IBO pairs between many small meshes.
+     *
+     * Each VertexDescr layout gets its own pool with one VAO, and meshes are
+     * sub-allocated vertex and index ranges from it. Indices stay relative to the mesh
+     * and are drawn with glDrawElementsBaseVertex, so meshes of the same layout don't
+     * rebind the VAO between draws. Pools grow by copying into a larger buffer and
+     * defragment() compacts them after many meshes have been freed.
+     *
+     * Use through VertexBuffer::create(MeshArena&, ...), or GLCore::Meshes()
+     */
+    class AGL_API MeshArena
+    {
+    public:
+        static constexpr int InitialVertices = 64*1024; // initial vertex capacity per pool
+        static constexpr int InitialIndices  = 256*1024; // initial index capacity per pool
+
+        /** @brief Location of an allocation for indirect draws */
+        struct DrawRange
+        {
+            uint32_t vertexArray = 0; // shared VAO of the pool
+            int baseVertex = 0;
+            int firstIndex = 0;
+            int numIndices = 0;
+        };
+
+        struct Stats
+        {
+            int pools       = 0;
+            int allocations = 0;
+            int64_t vertexBytesUsed     = 0;
+            int64_t vertexBytesCapacity = 0;
+            int64_t indexBytesUsed      = 0;
+            int64_t indexBytesCapacity  = 0;
+            int freeRanges = 0; // number of free holes, a measure of fragmentation
+        };
+
+    private:
+        struct Pool;
+        struct Slot
+        {
+            int pool = -1; // -1 if this slot is free
+            int baseVertex = 0, numVertices = 0;
+            int firstIndex = 0, numIndices  = 0;
+        };
+        vector<std::unique_ptr<Pool>> Pools;
+        vector<Slot> Slots;
+        vector<int>  FreeSlots;
+        uint32_t DrawIdBuffer = 0; // a_DrawId = 0..MaxDrawIds-1, advanced per instance
+        int MaxDrawIds = 0;
+
+    public:
+        MeshArena();
+        ~MeshArena();
+
+        MeshArena(const MeshArena&) = delete;
+        MeshArena& operator=(const MeshArena&) = delete;
+
+        /** @return TRUE if base vertex draws and buffer copies are supported */
+        static bool supported();
+
+        /**
+         * Copies the mesh into the pool of its layout
+         * @return Allocation slot for draw() and free(), or -1 on failure
+         */
+        int allocate(const void* verts, int numVerts, const index_t* indices, int numIndices,
+                     const VertexDescr& layout);
+
+        /** @brief Overwrites an allocation with a mesh of the same size and layout */
+        void write(int slot, const void* verts, const index_t* indices);
+
+        void free(int slot);
+
+        // draws an allocation, DrawIndexed uses the indices, other modes draw the vertices in order
+        void draw(int slot, DrawMode mode) const;
+
+        DrawRange range(int slot) const;
+
+        /**
+         * Adds the a_DrawId attribute to every pool, which reads `baseInstance`
+         * of indirect draw commands as a per-draw index, @see BatchRenderer
+         * @param maxDraws Number of distinct draw ids
+         */
+        void enableDrawIds(int maxDraws);
+        int maxDrawIds() const { return MaxDrawIds; }
+
+        /**
+         * Compacts every pool so all free space is at the end. Allocation slots stay
+         * valid, only their offsets inside the pool change
+         */
+        void defragment();
+
+        /** @brief Destroys all pools, arena backed VertexBuffers must be cleared first */
+        void clear();
+
+        Stats stats() const;
+
+    private:
+        int findPool(const VertexDescr& layout);
+        void reserve(Pool& pool, int numVerts, int numIndices);
+        void setupVertexArray(Pool& pool);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,313 @@
+#include "MeshFile.h"
+#include <rpp/file_io.h>
+#include <rpp/debugging.h>
+#if _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& f) noexcept : Data{f.Data}, Size{f.Size}, Handle{f.Handle}
+    {
+        f.Data   = nullptr;
+        f.Size   = 0;
+        f.Handle = nullptr;
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& f) noexcept
+    {
+        std::swap(Data,   f.Data);
+        std::swap(Size,   f.Size);
+        std::swap(Handle, f.Handle);
+        return *this;
+    }
+
+    bool MappedFile::open(const string& path)
+    {
+        close();
+    #if _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            LogWarning("MappedFile %s: failed to open", path.c_str());
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            LogWarning("MappedFile %s: empty file", path.c_str());
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file); // the mapping keeps the file open
+        if (!mapping) {
+            LogWarning("MappedFile %s: CreateFileMapping failed", path.c_str());
+            return false;
+        }
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            CloseHandle(mapping);
+            LogWarning("MappedFile %s: MapViewOfFile failed", path.c_str());
+            return false;
+        }
+        Handle = mapping;
+        Size   = (size_t)size.QuadPart;
+    #else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            LogWarning("MappedFile %s: failed to open", path.c_str());
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            LogWarning("MappedFile %s: empty file", path.c_str());
+            return false;
+        }
+        void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file open
+        if (data == MAP_FAILED) {
+            LogWarning("MappedFile %s: mmap failed", path.c_str());
+            return false;
+        }
+        madvise(data, (size_t)st.st_size, MADV_WILLNEED); // we're going to read all of it
+        Size = (size_t)st.st_size;
+    #endif
+        Data = (const uint8_t*)data;
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (!Data)
+            return;
+    #if _WIN32
+        UnmapViewOfFile(Data);
+        CloseHandle((HANDLE)Handle);
+    #else
+        munmap((void*)Data, Size);
+    #endif
+        Data   = nullptr;
+        Size   = 0;
+        Handle = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    // the on-disk format stores these values raw, changing them breaks existing files
+    static_assert(a_Position == 0 && a_Normal == 1 && a_Coord == 2 && a_Coord2 == 3 && a_Vertex == 4 &&
+                  a_Color == 5 && a_Instance == 6 && a_InstanceColor == 7 && a_DrawId == 8,
+                  "ShaderAttr values are stored in .aglmesh files");
+    static_assert(vt_Float == 0 && vt_Half == 1 && vt_UByte == 2 && vt_Short == 3 && vt_UShort == 4 &&
+                  vt_Int1010102 == 5, "VertexType values are stored in .aglmesh files");
+    static_assert(DrawNone == 0 && DrawIndexed == 1 && DrawTriangles == 2 && DrawTriangleStrip == 3 &&
+                  DrawLines == 4 && DrawLineStrip == 5 && DrawLineLoop == 6 && DrawPoints == 7,
+                  "DrawMode values are stored in .aglmesh files");
+    static_assert(sizeof(MeshFileAttribute) == 4 && sizeof(MeshLod) == 12 && sizeof(MeshFileHeader) == 192,
+                  ".aglmesh header layout changed, bump MeshFileHeader::Version");
+
+    MeshFile::MeshFile(const string& path)
+    {
+        open(path);
+    }
+
+    static bool validHeader(const string& path, const uint8_t* data, size_t size)
+    {
+        if (size < sizeof(MeshFileHeader)) {
+            LogWarning("MeshFile %s: file too small", path.c_str());
+            return false;
+        }
+        const MeshFileHeader& h = *(const MeshFileHeader*)data;
+        if (h.magic != MeshFileHeader::Magic || h.version != MeshFileHeader::Version) {
+            LogWarning("MeshFile %s: not an .aglmesh v%d file", path.c_str(), MeshFileHeader::Version);
+            return false;
+        }
+        if (h.vertexSize <= 0 || (h.indexSize != 0 && h.indexSize != 2 && h.indexSize != 4)
+            || h.drawMode > DrawPoints || h.numLods > (uint32_t)MeshFileHeader::MaxLods) {
+            LogWarning("MeshFile %s: corrupted header", path.c_str());
+            return false;
+        }
+        int attributeBytes = 0;
+        for (const MeshFileAttribute& a : h.attributes)
+        {
+            if (a.size == 0) break;
+            if (a.attr >= a_MaxAttributes || a.size > 4 || a.type > vt_Int1010102) {
+                LogWarning("MeshFile %s: invalid vertex attribute", path.c_str());
+                return false;
+            }
+            attributeBytes += VertexDescrElem{ a.attr, a.size, a.type, a.norm }.bytes();
+        }
+        if (attributeBytes > h.vertexSize) {
+            LogWarning("MeshFile %s: vertex attributes exceed vertexSize", path.c_str());
+            return false;
+        }
+        // blobs must lie completely inside the file, written so that nothing can overflow
+        const uint64_t vertexBytes = uint64_t(h.numVertices) * uint32_t(h.vertexSize);
+        const uint64_t indexBytes  = uint64_t(h.numIndices)  * h.indexSize;
+        if (h.vertexOffset < sizeof(MeshFileHeader) || h.vertexOffset > size || vertexBytes > size - h.vertexOffset
+            || h.indexOffset < sizeof(MeshFileHeader) || h.indexOffset > size || indexBytes > size - h.indexOffset) {
+            LogWarning("MeshFile %s: vertex or index data out of file bounds", path.c_str());
+            return false;
+        }
+        for (uint32_t i = 0; i < h.numLods; ++i) {
+            if (uint64_t(h.lods[i].firstIndex) + h.lods[i].numIndices > h.numIndices) {
+                LogWarning("MeshFile %s: LOD %u out of range", path.c_str(), i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool MeshFile::open(const string& path)
+    {
+        if (!Map.open(path))
+            return false;
+        if (!validHeader(path, Map.data(), Map.size())) {
+            Map.close();
+            return false;
+        }
+        return true;
+    }
+
+    VertexDescr MeshFile::layout() const
+    {
+        VertexDescr vd;
+        vd.clear();
+        vd.sizeOf = header().vertexSize;
+        for (int i = 0; i < 4; ++i)
+        {
+            const MeshFileAttribute& a = header().attributes[i];
+            vd.items[i] = { a.attr, a.size, a.type, a.norm };
+        }
+        return vd;
+    }
+
+    MeshLod MeshFile::lod(int lod) const
+    {
+        const MeshFileHeader& h = header();
+        if (h.numLods == 0 || lod < 0 || lod >= (int)h.numLods)
+        {
+            MeshLod all;
+            all.numIndices = h.numIndices;
+            return all;
+        }
+        return h.lods[lod];
+    }
+
+    bool MeshFile::create(VertexBuffer& outBuffer, int lodIndex) const
+    {
+        if (!good())
+            return false;
+        const MeshFileHeader& h = header();
+        if (h.indexSize == 0)
+        {
+            outBuffer.create(mode(), vertices(), (int)h.numVertices, layout());
+            return true;
+        }
+        const MeshLod l = lod(lodIndex);
+        const uint8_t* first = (const uint8_t*)indices() + size_t(l.firstIndex) * h.indexSize;
+        outBuffer.create(vertices(), (int)h.numVertices, first, (int)l.numIndices, (int)h.indexSize, layout());
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static uint64_t alignUp(uint64_t offset)
+    {
+        return (offset + MeshFileAlignment - 1) & ~uint64_t(MeshFileAlignment - 1);
+    }
+
+    // bounding box of float a_Position attributes, empty if positions are not floats
+    static void computeBounds(MeshFileHeader& h, const void* verts, int numVerts, const VertexDescr& layout)
+    {
+        int offset = 0;
+        for (int i = 0; i < 4 && layout.items[i].size; ++i)
+        {
+            const VertexDescrElem& e = layout.items[i];
+            if (e.attr == a_Position && e.type == vt_Float && numVerts > 0)
+            {
+                const int dims = e.size < 3 ? e.size : 3;
+                for (int d = 0; d < 3; ++d) {
+                    h.boundsMin[d] = d < dims ? +1e30f : 0.0f;
+                    h.boundsMax[d] = d < dims ? -1e30f : 0.0f;
+                }
+                for (int v = 0; v < numVerts; ++v)
+                {
+                    const float* p = (const float*)((const uint8_t*)verts + size_t(v) * layout.sizeOf + offset);
+                    for (int d = 0; d < dims; ++d) {
+                        if (p[d] < h.boundsMin[d]) h.boundsMin[d] = p[d];
+                        if (p[d] > h.boundsMax[d]) h.boundsMax[d] = p[d];
+                    }
+                }
+                return;
+            }
+            offset += e.bytes();
+        }
+    }
+
+    bool MeshFile::save(const string& path, const void* verts, int numVerts,
+                        const index_t* indices, int numIndices, const VertexDescr& layout,
+                        DrawMode mode, const MeshLod* lods, int numLods)
+    {
+        if (numLods > MeshFileHeader::MaxLods) {
+            LogWarning("MeshFile::save %s: at most %d LODs are supported", path.c_str(), MeshFileHeader::MaxLods);
+            return false;
+        }
+
+        MeshFileHeader h {};
+        h.magic      = MeshFileHeader::Magic;
+        h.version    = MeshFileHeader::Version;
+        h.vertexSize = layout.sizeOf;
+        for (int i = 0; i < 4; ++i)
+        {
+            const VertexDescrElem& e = layout.items[i];
+            h.attributes[i] = { e.attr, e.size, e.type, e.norm };
+        }
+        h.drawMode    = (uint32_t)mode;
+        h.indexSize   = numIndices == 0 ? 0 : numVerts <= VertexBuffer::MaxShortIndexVertices ? 2 : 4;
+        h.numVertices = (uint32_t)numVerts;
+        h.numIndices  = (uint32_t)numIndices;
+        h.vertexOffset = alignUp(sizeof(MeshFileHeader));
+        h.indexOffset  = alignUp(h.vertexOffset + uint64_t(numVerts) * layout.sizeOf);
+        h.numLods = (uint32_t)numLods;
+        for (int i = 0; i < numLods; ++i)
+            h.lods[i] = lods[i];
+        computeBounds(h, verts, numVerts, layout);
+
+        vector<uint8_t> data(h.indexOffset + uint64_t(numIndices) * h.indexSize, 0);
+        memcpy(data.data(), &h, sizeof(h));
+        memcpy(data.data() + h.vertexOffset, verts, size_t(numVerts) * layout.sizeOf);
+        if (h.indexSize == 2)
+        {
+            uint16_t* dst = (uint16_t*)(data.data() + h.indexOffset);
+            for (int i = 0; i < numIndices; ++i)
+                dst[i] = (uint16_t)indices[i];
+        }
+        else if (h.indexSize == 4)
+        {
+            memcpy(data.data() + h.indexOffset, indices, size_t(numIndices) * sizeof(index_t));
+        }
+
+        rpp::file f { path, rpp::CREATENEW };
+        if (!f) {
+            LogWarning("MeshFile::save %s: failed to create file", path.c_str());
+            return false;
+        }
+        return f.write(data.data(), (int)data.size()) == (int)data.size();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
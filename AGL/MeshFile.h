@@ -0,0 +1,146 @@
+#pragma once
+#include "MeshOptimizer.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * On-disk copy of a VertexDescrElem. The enum values stored here are part
+     * of the file format, MeshFile.cpp asserts that they never change
+     */
+    struct MeshFileAttribute
+    {
+        uint8_t attr; // ShaderAttr
+        uint8_t size; // components per attribute
+        uint8_t type; // VertexType
+        uint8_t norm; // Normalized
+    };
+
+
+    /**
+     * Header of an .aglmesh file, followed by the vertex and index blobs.
+     * All data is little-endian and in the exact format glBufferData expects,
+     * blobs are aligned to MeshFileAlignment bytes.
+     */
+    struct MeshFileHeader
+    {
+        static constexpr uint32_t Magic   = 0x534D4741; // "AGMS"
+        static constexpr uint32_t Version = 1;
+        static constexpr int MaxLods = 8;
+
+        uint32_t magic;
+        uint32_t version;
+        int32_t  vertexSize;          // VertexDescr::sizeOf
+        MeshFileAttribute attributes[4]; // VertexDescr::items
+        uint32_t drawMode;            // DrawMode
+        uint32_t indexSize;           // 2 or 4 bytes per index, 0 if not indexed
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint32_t numVertices;
+        uint32_t numIndices;
+        uint64_t vertexOffset;        // byte offset of the vertex blob from the start of the file
+        uint64_t indexOffset;         // byte offset of the index blob
+        uint32_t numLods;             // 0 if the whole index buffer is the only LOD
+        uint32_t reserved;
+        MeshLod  lods[MaxLods];
+    };
+
+    static constexpr int MeshFileAlignment = 64;
+
+
+    /** @brief Read-only memory mapping of a whole file */
+    class AGL_API MappedFile
+    {
+        const uint8_t* Data = nullptr;
+        size_t Size = 0;
+        void* Handle = nullptr; // OS file mapping handle
+
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile&& f) noexcept;
+        MappedFile& operator=(MappedFile&& f) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /** @return FALSE if the file doesn't exist, is empty or can't be mapped */
+        bool open(const string& path);
+        void close();
+
+        const uint8_t* data() const { return Data; }
+        size_t size() const { return Size; }
+        const uint8_t* end() const { return Data + Size; }
+        bool good() const { return Data != nullptr; }
+    };
+
+
+    /**
+     * Memory mapped .aglmesh file. Vertex and index data point directly into the mapping,
+     * so loading is just mmap + glBufferData, without any parsing or copying:
+     *
+     * @code
+     *     MeshFile file { "models/rock.aglmesh" };
+     *     if (file) file.create(actor->Mesh);
+     * @endcode
+     */
+    class AGL_API MeshFile
+    {
+        MappedFile Map;
+
+    public:
+        MeshFile() = default;
+        explicit MeshFile(const string& path);
+
+        /**
+         * Maps the file and validates its header
+         * @return FALSE if the file can't be mapped or is not a valid .aglmesh
+         */
+        bool open(const string& path);
+        void close() { Map.close(); }
+
+        bool good() const { return Map.good(); }
+        explicit operator bool() const { return Map.good(); }
+        bool     operator!    () const { return !Map.good(); }
+
+        const MeshFileHeader& header() const { return *(const MeshFileHeader*)Map.data(); }
+        VertexDescr layout() const;
+        DrawMode    mode()   const { return (DrawMode)header().drawMode; }
+
+        int numVertices() const { return (int)header().numVertices; }
+        int numIndices()  const { return (int)header().numIndices; }
+        int indexSize()   const { return (int)header().indexSize; }
+        int numLods()     const { return header().numLods ? (int)header().numLods : 1; }
+
+        /** @return LOD `lod`, the whole index buffer if the file has no LOD table */
+        MeshLod lod(int lod) const;
+
+        const void* vertices() const { return Map.data() + header().vertexOffset; }
+        const void* indices()  const { return Map.data() + header().indexOffset; }
+
+        /**
+         * Uploads the vertices and the indices of `lod` straight from the mapping
+         */
+        bool create(VertexBuffer& outBuffer, int lod = 0) const;
+
+        /**
+         * Writes an .aglmesh file from the same data that is passed to VertexBuffer::create().
+         * Indices are stored as 16-bit if the mesh has at most 65535 vertices
+         * @param lods Optional LOD table, ranges of `indices`
+         */
+        static bool save(const string& path, const void* verts, int numVerts,
+                         const index_t* indices, int numIndices, const VertexDescr& layout,
+                         DrawMode mode = DrawIndexed, const MeshLod* lods = nullptr, int numLods = 0);
+
+        template<class VERTEX>
+        static bool save(const string& path, const vector<VERTEX>& verts, const vector<index_t>& indices,
+                         const vector<MeshLod>& lods = {})
+        {
+            return save(path, verts.data(), (int)verts.size(), indices.data(), (int)indices.size(),
+                        VERTEX::layout(), DrawIndexed, lods.data(), (int)lods.size());
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
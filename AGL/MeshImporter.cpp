@@ -0,0 +1,945 @@
+#include "MeshImporter.h"
+#include <rpp/debugging.h>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <cmath>
+#include <cctype>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void ImportedMesh::clear()
+    {
+        vertices.clear();
+        colorVertices.clear();
+        indices.clear();
+        hasColors  = false;
+        hasCoords  = false;
+        hasNormals = false;
+    }
+
+    void ImportedMesh::create(VertexBuffer& outBuffer) const
+    {
+        if (hasColors)
+        {
+            if (indices.empty()) outBuffer.create(DrawPoints, colorVertices);
+            else                 outBuffer.create(colorVertices, indices);
+        }
+        else
+        {
+            if (indices.empty()) outBuffer.create(DrawPoints, vertices);
+            else                 outBuffer.create(vertices, indices);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    // chunks smaller than this are not worth a thread
+    static constexpr size_t MinChunkSize = 256 * 1024;
+
+    static int numWorkers(size_t size, int numThreads)
+    {
+        if (numThreads <= 0)
+            numThreads = (int)std::thread::hardware_concurrency();
+        const int maxChunks = (int)(size / MinChunkSize) + 1;
+        return std::max(1, std::min(numThreads, maxChunks));
+    }
+
+    // runs func(i) for i in [0, count), the calling thread takes i = 0
+    template<class Func> static void parallelFor(int count, const Func& func)
+    {
+        vector<std::thread> workers;
+        workers.reserve(count > 1 ? count - 1 : 0);
+        for (int i = 1; i < count; ++i)
+            workers.emplace_back([&func, i] { func(i); });
+        if (count > 0)
+            func(0);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    struct TextChunk
+    {
+        const char* begin;
+        const char* end;
+    };
+
+    // splits [begin, end) into at most `count` chunks which all start at the beginning of a line
+    static vector<TextChunk> splitLines(const char* begin, const char* end, int count)
+    {
+        vector<TextChunk> chunks;
+        const size_t step = size_t(end - begin) / count;
+        const char* start = begin;
+        for (int i = 0; i < count && start < end; ++i)
+        {
+            const char* stop = end;
+            if (i < count - 1)
+            {
+                stop = std::max(start, begin + step*(i + 1));
+                stop = (const char*)memchr(stop, '\n', size_t(end - stop));
+                stop = stop ? stop + 1 : end;
+            }
+            chunks.push_back({ start, stop });
+            start = stop;
+        }
+        return chunks;
+    }
+
+    static const char* lineEnd(const char* s, const char* end)
+    {
+        const char* eol = (const char*)memchr(s, '\n', size_t(end - s));
+        return eol ? eol : end;
+    }
+
+    static bool isDigit(char c) { return unsigned(c - '0') < 10; }
+    static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static const double Pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    float MeshImporter::parseFloat(const char*& s, const char* end)
+    {
+        const char* p = s;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        // up to 19 significant digits fit into the mantissa, the rest only shift the exponent
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        bool any = false;
+        for (; p < end && isDigit(*p); ++p, any = true)
+        {
+            if (digits < 19) {
+                mantissa = mantissa*10 + (*p - '0');
+                if (mantissa) ++digits;
+            }
+            else ++exponent;
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && isDigit(*p); ++p, any = true)
+            {
+                if (digits < 19) {
+                    mantissa = mantissa*10 + (*p - '0');
+                    if (mantissa) ++digits;
+                    --exponent;
+                }
+            }
+        }
+        if (!any)
+            return 0.0f;
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* e = p + 1;
+            bool negativeExp = false;
+            if (e < end && (*e == '-' || *e == '+'))
+                negativeExp = *e++ == '-';
+            if (e < end && isDigit(*e))
+            {
+                int exp = 0;
+                for (; e < end && isDigit(*e); ++e)
+                    if (exp < 10000) exp = exp*10 + (*e - '0');
+                exponent += negativeExp ? -exp : exp;
+                p = e;
+            }
+        }
+
+        double value = (double)mantissa;
+        if      (exponent < 0) value = exponent >= -22 ? value / Pow10[-exponent] : value * std::pow(10.0, exponent);
+        else if (exponent > 0) value = exponent <=  22 ? value * Pow10[exponent]  : value * std::pow(10.0, exponent);
+        s = p;
+        return float(negative ? -value : value);
+    }
+
+    static bool parseInt(const char*& s, const char* end, int& out)
+    {
+        const char* p = s;
+        while (p < end && isBlank(*p))
+            ++p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        if (p >= end || !isDigit(*p))
+            return false;
+        int64_t value = 0;
+        for (; p < end && isDigit(*p); ++p)
+            if (value < INT32_MAX) value = value*10 + (*p - '0');
+        out = (int)(negative ? -std::min<int64_t>(value, INT32_MAX) : std::min<int64_t>(value, INT32_MAX));
+        s = p;
+        return true;
+    }
+
+    // smooth area-weighted normals for triangle meshes that don't have any
+    static void computeNormals(vector<Vertex3UVNorm>& verts, const vector<index_t>& indices)
+    {
+        for (Vertex3UVNorm& v : verts)
+            v.nx = v.ny = v.nz = 0.0f;
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            Vertex3UVNorm& a = verts[indices[i]];
+            Vertex3UVNorm& b = verts[indices[i+1]];
+            Vertex3UVNorm& c = verts[indices[i+2]];
+            const float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+            const float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+            const float nx = e1y*e2z - e1z*e2y;
+            const float ny = e1z*e2x - e1x*e2z;
+            const float nz = e1x*e2y - e1y*e2x;
+            for (Vertex3UVNorm* v : { &a, &b, &c }) {
+                v->nx += nx; v->ny += ny; v->nz += nz;
+            }
+        }
+
+        for (Vertex3UVNorm& v : verts)
+        {
+            const float len = sqrtf(v.nx*v.nx + v.ny*v.ny + v.nz*v.nz);
+            if (len > 0.0f) {
+                v.nx /= len; v.ny /= len; v.nz /= len;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    // OBJ negative indices are relative to the vertices parsed so far. A chunk doesn't know
+    // how many vertices the previous chunks have, so they're stored as chunk-relative with this bias
+    static constexpr int RelativeBias = 1 << 30;
+
+    struct ObjChunk
+    {
+        vector<float> positions; // x,y,z
+        vector<float> colors;    // r,g,b, empty until the first colored vertex
+        vector<float> coords;    // u,v
+        vector<float> normals;   // x,y,z
+        vector<int>   corners;   // v,vt,vn of each triangle corner, 1-based, 0 if missing
+    };
+
+    static void parseObjFace(const char* s, const char* eol, ObjChunk& c)
+    {
+        const int counts[3] = { (int)c.positions.size()/3, (int)c.coords.size()/2, (int)c.normals.size()/3 };
+        int first[3], prev[3];
+        for (int n = 0; ; ++n)
+        {
+            int idx[3] = { 0, 0, 0 };
+            if (!parseInt(s, eol, idx[0]))
+                break;
+            if (s < eol && *s == '/')
+            {
+                ++s;
+                parseInt(s, eol, idx[1]);
+                if (s < eol && *s == '/') {
+                    ++s;
+                    parseInt(s, eol, idx[2]);
+                }
+            }
+            for (int k = 0; k < 3; ++k)
+                if (idx[k] < 0) idx[k] = counts[k] + idx[k] + 1 - RelativeBias;
+
+            if (n == 0) {
+                memcpy(first, idx, sizeof(idx));
+            }
+            else if (n >= 2) { // triangle fan
+                c.corners.insert(c.corners.end(), first, first + 3);
+                c.corners.insert(c.corners.end(), prev, prev + 3);
+                c.corners.insert(c.corners.end(), idx, idx + 3);
+            }
+            memcpy(prev, idx, sizeof(idx));
+        }
+    }
+
+    static void parseObjChunk(const char* p, const char* end, ObjChunk& c)
+    {
+        while (p < end)
+        {
+            while (p < end && (*p == ' ' || *p == '\t'))
+                ++p;
+            const char* eol = lineEnd(p, end);
+            if (eol - p >= 2 && p[0] == 'v')
+            {
+                const char* s = p + 2;
+                if (isBlank(p[1]))
+                {
+                    float xyz[3];
+                    for (float& f : xyz) f = MeshImporter::parseFloat(s, eol);
+                    c.positions.insert(c.positions.end(), xyz, xyz + 3);
+
+                    // `v x y z r g b` is the common vertex color extension, `v x y z w` is not a color
+                    float rgb[3];
+                    int numColors = 0;
+                    for (; numColors < 3; ++numColors)
+                    {
+                        const char* before = s;
+                        rgb[numColors] = MeshImporter::parseFloat(s, eol);
+                        if (s == before) break;
+                    }
+                    if (numColors == 3)
+                    {
+                        if (c.colors.empty())
+                            c.colors.assign(c.positions.size() - 3, 1.0f);
+                        c.colors.insert(c.colors.end(), rgb, rgb + 3);
+                    }
+                    else if (!c.colors.empty())
+                    {
+                        c.colors.insert(c.colors.end(), 3, 1.0f);
+                    }
+                }
+                else if (p[1] == 't' && eol - p >= 3 && isBlank(p[2]))
+                {
+                    c.coords.push_back(MeshImporter::parseFloat(s, eol));
+                    c.coords.push_back(MeshImporter::parseFloat(s, eol));
+                }
+                else if (p[1] == 'n' && eol - p >= 3 && isBlank(p[2]))
+                {
+                    for (int k = 0; k < 3; ++k)
+                        c.normals.push_back(MeshImporter::parseFloat(s, eol));
+                }
+            }
+            else if (eol - p >= 2 && p[0] == 'f' && isBlank(p[1]))
+            {
+                parseObjFace(p + 2, eol, c);
+            }
+            p = eol + 1;
+        }
+    }
+
+    struct ObjIndexKey
+    {
+        int v, vt, vn;
+        bool operator==(const ObjIndexKey& k) const { return v == k.v && vt == k.vt && vn == k.vn; }
+    };
+
+    struct ObjIndexKeyHash
+    {
+        size_t operator()(const ObjIndexKey& k) const
+        {
+            return size_t(k.v) * 73856093u ^ size_t(k.vt) * 19349663u ^ size_t(k.vn) * 83492791u;
+        }
+    };
+
+    bool MeshImporter::loadObj(const char* data, size_t size, ImportedMesh& out, int numThreads)
+    {
+        out.clear();
+        const vector<TextChunk> ranges = splitLines(data, data + size, numWorkers(size, numThreads));
+        const int numChunks = (int)ranges.size();
+        vector<ObjChunk> chunks(numChunks);
+        parallelFor(numChunks, [&](int i) {
+            parseObjChunk(ranges[i].begin, ranges[i].end, chunks[i]);
+        });
+
+        // prefix sums of the per-chunk element counts
+        struct Counts { int v = 0, vt = 0, vn = 0, corners = 0; };
+        vector<Counts> base(numChunks + 1);
+        for (int i = 0; i < numChunks; ++i)
+        {
+            base[i+1].v  = base[i].v  + (int)chunks[i].positions.size()/3;
+            base[i+1].vt = base[i].vt + (int)chunks[i].coords.size()/2;
+            base[i+1].vn = base[i].vn + (int)chunks[i].normals.size()/3;
+            base[i+1].corners = base[i].corners + (int)chunks[i].corners.size();
+            out.hasColors |= !chunks[i].colors.empty();
+        }
+        const Counts total = base[numChunks];
+        if (total.v == 0) {
+            LogWarning("MeshImporter: OBJ has no vertices");
+            return false;
+        }
+        vector<float> positions(size_t(total.v) * 3);
+        vector<float> colors(out.hasColors ? size_t(total.v) * 3 : 0);
+        vector<float> coords(size_t(total.vt) * 2);
+        vector<float> normals(size_t(total.vn) * 3);
+        vector<int> corners(total.corners); // 0-based v,vt,vn, -1 if missing
+        std::atomic<bool> invalid { false };
+        std::atomic<bool> split   { false }; // some corner has vt or vn different from v
+        // which corners reference vt/vn: [0] some do, [1] some don't
+        std::atomic<bool> coordRefs[2]  = { { false }, { false } };
+        std::atomic<bool> normalRefs[2] = { { false }, { false } };
+
+        parallelFor(numChunks, [&](int i) {
+            const ObjChunk& c = chunks[i];
+            const Counts& b = base[i];
+            std::copy(c.positions.begin(), c.positions.end(), positions.begin() + size_t(b.v)*3);
+            std::copy(c.coords.begin(),    c.coords.end(),    coords.begin()    + size_t(b.vt)*2);
+            std::copy(c.normals.begin(),   c.normals.end(),   normals.begin()   + size_t(b.vn)*3);
+            if (out.hasColors)
+            {
+                if (c.colors.empty()) std::fill_n(colors.begin() + size_t(b.v)*3, c.positions.size(), 1.0f);
+                else std::copy(c.colors.begin(), c.colors.end(), colors.begin() + size_t(b.v)*3);
+            }
+
+            const int bases[3]  = { b.v, b.vt, b.vn };
+            const int totals[3] = { total.v, total.vt, total.vn };
+            int* dst = corners.data() + b.corners;
+            bool bad = false, diff = false;
+            bool coords[2] = { false, false }, normals[2] = { false, false };
+            for (size_t k = 0; k < c.corners.size(); k += 3)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    const int idx = c.corners[k+j];
+                    const int r = idx == 0 ? -1 : idx > 0 ? idx - 1 : bases[j] + (idx + RelativeBias) - 1;
+                    // 0 means absent for vt/vn, but every corner needs a position
+                    if ((idx != 0 || j == 0) && (r < 0 || r >= totals[j]))
+                        bad = true;
+                    dst[k+j] = r;
+                }
+                if ((dst[k+1] >= 0 && dst[k+1] != dst[k]) || (dst[k+2] >= 0 && dst[k+2] != dst[k]))
+                    diff = true;
+                coords[dst[k+1] < 0]  = true;
+                normals[dst[k+2] < 0] = true;
+            }
+            if (bad)  invalid = true;
+            if (diff) split = true;
+            for (int j = 0; j < 2; ++j)
+            {
+                if (coords[j])  coordRefs[j]  = true;
+                if (normals[j]) normalRefs[j] = true;
+            }
+        });
+        chunks.clear();
+
+        if (invalid) {
+            LogWarning("MeshImporter: OBJ face index out of range");
+            return false;
+        }
+
+        // only attach vt/vn that faces actually reference, and give corners
+        // with and without them separate vertices
+        out.hasCoords  = coordRefs[0];
+        out.hasNormals = normalRefs[0];
+        if ((coordRefs[0] && coordRefs[1]) || (normalRefs[0] && normalRefs[1]))
+            split = true;
+
+        const int numCorners = total.corners / 3;
+        out.indices.resize(numCorners);
+
+        if (out.hasColors)
+        {
+            // Vertex3Color has no UVs or normals, so only position indices matter
+            out.colorVertices.resize(total.v);
+            parallelFor(numChunks, [&](int i) {
+                for (int v = base[i].v; v < base[i+1].v; ++v)
+                {
+                    const float* p = &positions[size_t(v)*3];
+                    const float* c = &colors[size_t(v)*3];
+                    out.colorVertices[v] = { p[0], p[1], p[2], c[0], c[1], c[2], 1.0f };
+                }
+                for (int k = base[i].corners / 3; k < base[i+1].corners / 3; ++k)
+                    out.indices[k] = (index_t)corners[size_t(k)*3];
+            });
+            return true;
+        }
+
+        auto makeVertex = [&](int v, int vt, int vn) -> Vertex3UVNorm
+        {
+            Vertex3UVNorm vert {};
+            memcpy(&vert.x, &positions[size_t(v)*3], sizeof(float)*3);
+            if (vt >= 0 && vt < total.vt) memcpy(&vert.u,  &coords[size_t(vt)*2],  sizeof(float)*2);
+            if (vn >= 0 && vn < total.vn) memcpy(&vert.nx, &normals[size_t(vn)*3], sizeof(float)*3);
+            return vert;
+        };
+
+        if (!split)
+        {
+            // every corner uses the same index for v/vt/vn, or none at all: one vertex per position
+            out.vertices.resize(total.v);
+            parallelFor(numChunks, [&](int i) {
+                for (int v = base[i].v; v < base[i+1].v; ++v)
+                    out.vertices[v] = makeVertex(v, out.hasCoords ? v : -1, out.hasNormals ? v : -1);
+                for (int k = base[i].corners / 3; k < base[i+1].corners / 3; ++k)
+                    out.indices[k] = (index_t)corners[size_t(k)*3];
+            });
+        }
+        else
+        {
+            std::unordered_map<ObjIndexKey, index_t, ObjIndexKeyHash> unique;
+            unique.reserve(total.v);
+            out.vertices.reserve(total.v);
+            for (int k = 0; k < numCorners; ++k)
+            {
+                const ObjIndexKey key { corners[size_t(k)*3], corners[size_t(k)*3+1], corners[size_t(k)*3+2] };
+                auto it = unique.find(key);
+                if (it == unique.end())
+                {
+                    it = unique.emplace(key, (index_t)out.vertices.size()).first;
+                    out.vertices.push_back(makeVertex(key.v, key.vt, key.vn));
+                }
+                out.indices[k] = it->second;
+            }
+        }
+
+        if (!out.hasNormals && !out.indices.empty())
+            computeNormals(out.vertices, out.indices);
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    enum PlyType { ply_None, ply_Int8, ply_UInt8, ply_Int16, ply_UInt16, ply_Int32, ply_UInt32, ply_Float32, ply_Float64 };
+    static const int PlyTypeSize[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+    // output vertex field a PLY vertex property maps to
+    enum PlyField { pf_X, pf_Y, pf_Z, pf_U, pf_V, pf_NX, pf_NY, pf_NZ, pf_R, pf_G, pf_B, pf_A, pf_Count, pf_Ignore = -1 };
+
+    struct PlyProperty
+    {
+        string name;
+        PlyType type = ply_None;
+        PlyType countType = ply_None; // list property if not ply_None
+        int offset = 0;               // byte offset in a binary record
+        int field = pf_Ignore;
+        float scale = 1.0f;           // normalizes integer colors to [0, 1]
+    };
+
+    struct PlyElement
+    {
+        string name;
+        size_t count = 0;
+        vector<PlyProperty> props;
+        int stride = 0;       // bytes per binary record if there are no list properties
+        bool fixed = true;    // no list properties
+    };
+
+    static PlyType plyType(const string& name)
+    {
+        if (name == "char"   || name == "int8")    return ply_Int8;
+        if (name == "uchar"  || name == "uint8")   return ply_UInt8;
+        if (name == "short"  || name == "int16")   return ply_Int16;
+        if (name == "ushort" || name == "uint16")  return ply_UInt16;
+        if (name == "int"    || name == "int32")   return ply_Int32;
+        if (name == "uint"   || name == "uint32")  return ply_UInt32;
+        if (name == "float"  || name == "float32") return ply_Float32;
+        if (name == "double" || name == "float64") return ply_Float64;
+        return ply_None;
+    }
+
+    static int plyField(const string& name)
+    {
+        static const char* names[][4] = {
+            { "x" }, { "y" }, { "z" },
+            { "u", "s", "texture_u", "texture_s" },
+            { "v", "t", "texture_v", "texture_t" },
+            { "nx" }, { "ny" }, { "nz" },
+            { "red",   "r", "diffuse_red" },
+            { "green", "g", "diffuse_green" },
+            { "blue",  "b", "diffuse_blue" },
+            { "alpha", "a", "diffuse_alpha" },
+        };
+        for (int f = 0; f < pf_Count; ++f)
+            for (const char* n : names[f])
+                if (n && name == n) return f;
+        return pf_Ignore;
+    }
+
+    static double readPly(const uint8_t* p, PlyType type)
+    {
+        switch (type)
+        {
+            case ply_Int8:    { int8_t   v; memcpy(&v, p, 1); return v; }
+            case ply_UInt8:   { uint8_t  v; memcpy(&v, p, 1); return v; }
+            case ply_Int16:   { int16_t  v; memcpy(&v, p, 2); return v; }
+            case ply_UInt16:  { uint16_t v; memcpy(&v, p, 2); return v; }
+            case ply_Int32:   { int32_t  v; memcpy(&v, p, 4); return v; }
+            case ply_UInt32:  { uint32_t v; memcpy(&v, p, 4); return v; }
+            case ply_Float32: { float    v; memcpy(&v, p, 4); return v; }
+            case ply_Float64: { double   v; memcpy(&v, p, 8); return v; }
+            default: return 0.0;
+        }
+    }
+
+    static vector<string> splitWords(const char* s, const char* eol)
+    {
+        vector<string> words;
+        while (s < eol)
+        {
+            while (s < eol && isBlank(*s)) ++s;
+            const char* word = s;
+            while (s < eol && !isBlank(*s)) ++s;
+            if (s > word) words.emplace_back(word, s);
+        }
+        return words;
+    }
+
+    enum PlyFormat { ply_Ascii, ply_BinaryLE };
+
+    static bool parsePlyHeader(const char* data, size_t size, PlyFormat& format,
+                               vector<PlyElement>& elements, const char*& body)
+    {
+        const char* end = data + size;
+        if (size < 4 || memcmp(data, "ply", 3) != 0) {
+            LogWarning("MeshImporter: not a PLY file");
+            return false;
+        }
+        bool hasFormat = false;
+        for (const char* s = lineEnd(data, end) + 1; s < end; )
+        {
+            const char* eol = lineEnd(s, end);
+            vector<string> w = splitWords(s, eol);
+            s = eol + 1;
+            if (w.empty() || w[0] == "comment" || w[0] == "obj_info")
+                continue;
+
+            if (w[0] == "end_header")
+            {
+                body = s;
+                if (!hasFormat) LogWarning("MeshImporter: PLY format is missing");
+                return hasFormat;
+            }
+            if (w[0] == "format" && w.size() >= 2)
+            {
+                if      (w[1] == "ascii")                format = ply_Ascii;
+                else if (w[1] == "binary_little_endian") format = ply_BinaryLE;
+                else {
+                    LogWarning("MeshImporter: unsupported PLY format %s", w[1].c_str());
+                    return false;
+                }
+                hasFormat = true;
+            }
+            else if (w[0] == "element" && w.size() >= 3)
+            {
+                PlyElement e;
+                e.name  = w[1];
+                e.count = (size_t)strtoull(w[2].c_str(), nullptr, 10);
+                elements.push_back(std::move(e));
+            }
+            else if (w[0] == "property" && !elements.empty())
+            {
+                PlyElement& e = elements.back();
+                PlyProperty p;
+                if (w.size() >= 5 && w[1] == "list") {
+                    p.countType = plyType(w[2]);
+                    p.type = plyType(w[3]);
+                    p.name = w[4];
+                    e.fixed = false;
+                    if (p.countType == ply_None) p.type = ply_None;
+                }
+                else if (w.size() >= 3) {
+                    p.type = plyType(w[1]);
+                    p.name = w[2];
+                }
+                if (p.type == ply_None) {
+                    LogWarning("MeshImporter: unsupported PLY property %s", p.name.c_str());
+                    return false;
+                }
+                p.offset = e.stride;
+                e.stride += PlyTypeSize[p.type];
+                if (e.name == "vertex" && p.countType == ply_None)
+                {
+                    p.field = plyField(p.name);
+                    if (p.field >= pf_R && p.type == ply_UInt8)  p.scale = 1.0f / 255.0f;
+                    if (p.field >= pf_R && p.type == ply_UInt16) p.scale = 1.0f / 65535.0f;
+                }
+                e.props.push_back(std::move(p));
+            }
+        }
+        LogWarning("MeshImporter: PLY end_header not found");
+        return false;
+    }
+
+    static void initVertexFields(float (&f)[pf_Count])
+    {
+        for (int i = 0; i < pf_Count; ++i)
+            f[i] = i >= pf_R ? 1.0f : 0.0f;
+    }
+
+    static void writeVertex(ImportedMesh& out, size_t i, const float (&f)[pf_Count])
+    {
+        if (out.hasColors)
+            out.colorVertices[i] = { f[pf_X], f[pf_Y], f[pf_Z], f[pf_R], f[pf_G], f[pf_B], f[pf_A] };
+        else
+            out.vertices[i] = { f[pf_X], f[pf_Y], f[pf_Z], f[pf_U], f[pf_V], f[pf_NX], f[pf_NY], f[pf_NZ] };
+    }
+
+    // TRUE if every vertex record is exactly `fields` as floats, so it can be copied as is
+    static bool matchesLayout(const PlyElement& vertex, std::initializer_list<int> fields)
+    {
+        if (!vertex.fixed || vertex.props.size() != fields.size())
+            return false;
+        const int* field = fields.begin();
+        for (const PlyProperty& p : vertex.props)
+            if (p.type != ply_Float32 || p.field != *field++) return false;
+        return true;
+    }
+
+    static void fanTriangulate(vector<index_t>& indices, const index_t* poly, int n)
+    {
+        for (int k = 2; k < n; ++k)
+            indices.insert(indices.end(), { poly[0], poly[k-1], poly[k] });
+    }
+
+    static bool loadPlyBinary(const uint8_t* p, const uint8_t* end, const vector<PlyElement>& elements,
+                              ImportedMesh& out, int workers)
+    {
+        vector<index_t> poly;
+        for (const PlyElement& e : elements)
+        {
+            if (e.name == "vertex")
+            {
+                if (!e.fixed || e.stride <= 0) {
+                    LogWarning("MeshImporter: PLY vertex element has no fixed size properties");
+                    return false;
+                }
+                if (size_t(end - p) / e.stride < e.count) {
+                    LogWarning("MeshImporter: PLY vertex data is truncated");
+                    return false;
+                }
+                const size_t n = e.count;
+                auto ranges = [&](int i, size_t& first, size_t& last) {
+                    first = n * i / workers;
+                    last  = n * (i + 1) / workers;
+                };
+                if (out.hasColors && matchesLayout(e, { pf_X, pf_Y, pf_Z, pf_R, pf_G, pf_B, pf_A }))
+                {
+                    parallelFor(workers, [&](int i) {
+                        size_t first, last; ranges(i, first, last);
+                        memcpy(out.colorVertices.data() + first, p + first*e.stride, (last - first)*e.stride);
+                    });
+                }
+                else if (!out.hasColors && matchesLayout(e, { pf_X, pf_Y, pf_Z, pf_U, pf_V, pf_NX, pf_NY, pf_NZ }))
+                {
+                    parallelFor(workers, [&](int i) {
+                        size_t first, last; ranges(i, first, last);
+                        memcpy(out.vertices.data() + first, p + first*e.stride, (last - first)*e.stride);
+                    });
+                }
+                else
+                {
+                    parallelFor(workers, [&](int i) {
+                        size_t first, last; ranges(i, first, last);
+                        float f[pf_Count];
+                        for (size_t v = first; v < last; ++v)
+                        {
+                            const uint8_t* record = p + v*e.stride;
+                            initVertexFields(f);
+                            for (const PlyProperty& prop : e.props)
+                                if (prop.field != pf_Ignore)
+                                    f[prop.field] = float(readPly(record + prop.offset, prop.type)) * prop.scale;
+                            writeVertex(out, v, f);
+                        }
+                    });
+                }
+                p += n * e.stride;
+                continue;
+            }
+
+            if (e.fixed) // skip elements we don't use
+            {
+                if (size_t(end - p) / std::max(e.stride, 1) < e.count) {
+                    LogWarning("MeshImporter: PLY element %s is truncated", e.name.c_str());
+                    return false;
+                }
+                p += e.count * e.stride;
+                continue;
+            }
+
+            // list records are variable length, so they're scanned serially
+            const bool faces = e.name == "face";
+            if (faces)
+                out.indices.reserve(e.count * 3);
+            for (size_t i = 0; i < e.count; ++i)
+            {
+                for (const PlyProperty& prop : e.props)
+                {
+                    if (prop.countType == ply_None) {
+                        p += PlyTypeSize[prop.type];
+                        continue;
+                    }
+                    if (p + PlyTypeSize[prop.countType] > end) {
+                        LogWarning("MeshImporter: PLY element %s is truncated", e.name.c_str());
+                        return false;
+                    }
+                    const int count = (int)readPly(p, prop.countType);
+                    p += PlyTypeSize[prop.countType];
+                    if (count < 0 || size_t(end - p) < size_t(count) * PlyTypeSize[prop.type]) {
+                        LogWarning("MeshImporter: PLY element %s is truncated", e.name.c_str());
+                        return false;
+                    }
+                    if (faces && (prop.name == "vertex_indices" || prop.name == "vertex_index"))
+                    {
+                        poly.resize(count);
+                        for (int k = 0; k < count; ++k)
+                            poly[k] = (index_t)readPly(p + k*PlyTypeSize[prop.type], prop.type);
+                        fanTriangulate(out.indices, poly.data(), count);
+                    }
+                    p += size_t(count) * PlyTypeSize[prop.type];
+                }
+            }
+        }
+        return true;
+    }
+
+    static bool loadPlyAscii(const char* body, const char* end, const vector<PlyElement>& elements,
+                             ImportedMesh& out, int workers)
+    {
+        // every element record is one line, so a chunk needs its first line number to know what it parses
+        const vector<TextChunk> ranges = splitLines(body, end, workers);
+        const int numChunks = (int)ranges.size();
+        vector<size_t> firstLine(numChunks + 1, 0);
+        parallelFor(numChunks, [&](int i) {
+            size_t lines = 0;
+            for (const char* s = ranges[i].begin; s < ranges[i].end; ++lines)
+                s = lineEnd(s, ranges[i].end) + 1;
+            firstLine[i+1] = lines;
+        });
+        for (int i = 0; i < numChunks; ++i)
+            firstLine[i+1] += firstLine[i];
+
+        size_t numLines = 0;
+        for (const PlyElement& e : elements)
+            numLines += e.count;
+        if (firstLine[numChunks] < numLines) {
+            LogWarning("MeshImporter: PLY data is truncated");
+            return false;
+        }
+
+        vector<vector<index_t>> faces(numChunks);
+        parallelFor(numChunks, [&](int i) {
+            size_t line = firstLine[i];
+            size_t elementEnd = 0;
+            int element = -1;
+            vector<index_t> poly;
+            float f[pf_Count];
+            for (const char* s = ranges[i].begin; s < ranges[i].end && line < numLines; ++line)
+            {
+                const char* eol = lineEnd(s, ranges[i].end);
+                while (line >= elementEnd) // this also skips empty elements
+                    elementEnd += elements[++element].count;
+                const PlyElement& e = elements[element];
+
+                if (e.name == "vertex")
+                {
+                    initVertexFields(f);
+                    for (const PlyProperty& prop : e.props)
+                    {
+                        const float value = MeshImporter::parseFloat(s, eol);
+                        if (prop.field != pf_Ignore)
+                            f[prop.field] = value * prop.scale;
+                    }
+                    writeVertex(out, line - (elementEnd - e.count), f);
+                }
+                else if (e.name == "face")
+                {
+                    for (const PlyProperty& prop : e.props)
+                    {
+                        int count = 1;
+                        if (prop.countType != ply_None && !parseInt(s, eol, count))
+                            break;
+                        const bool indices = prop.name == "vertex_indices" || prop.name == "vertex_index";
+                        poly.clear();
+                        for (int k = 0; k < count; ++k)
+                        {
+                            int index = 0;
+                            if (prop.type == ply_Float32 || prop.type == ply_Float64) MeshImporter::parseFloat(s, eol);
+                            else if (parseInt(s, eol, index) && indices) poly.push_back((index_t)index);
+                        }
+                        if (indices)
+                            fanTriangulate(faces[i], poly.data(), (int)poly.size());
+                    }
+                }
+                s = eol + 1;
+            }
+        });
+
+        size_t numIndices = 0;
+        for (const vector<index_t>& chunk : faces)
+            numIndices += chunk.size();
+        out.indices.reserve(numIndices);
+        for (const vector<index_t>& chunk : faces)
+            out.indices.insert(out.indices.end(), chunk.begin(), chunk.end());
+        return true;
+    }
+
+    bool MeshImporter::loadPly(const char* data, size_t size, ImportedMesh& out, int numThreads)
+    {
+        out.clear();
+        PlyFormat format = ply_Ascii;
+        vector<PlyElement> elements;
+        const char* body = nullptr;
+        if (!parsePlyHeader(data, size, format, elements, body))
+            return false;
+
+        const PlyElement* vertex = nullptr;
+        for (const PlyElement& e : elements)
+            if (e.name == "vertex") vertex = &e;
+        if (!vertex || vertex->count == 0) {
+            LogWarning("MeshImporter: PLY has no vertices");
+            return false;
+        }
+        for (const PlyProperty& p : vertex->props)
+        {
+            out.hasColors  |= p.field >= pf_R;
+            out.hasCoords  |= p.field == pf_U || p.field == pf_V;
+            out.hasNormals |= p.field >= pf_NX && p.field <= pf_NZ;
+        }
+        // reject impossible counts before allocating: a binary record is `stride` bytes,
+        // an ASCII value is at least one character plus a separator
+        const size_t bodySize = size_t(data + size - body);
+        const size_t minRecord = format == ply_Ascii ? std::max<size_t>(vertex->props.size(), 1) * 2
+                                                     : (size_t)std::max(vertex->stride, 0);
+        if (minRecord == 0 || bodySize / minRecord < vertex->count) {
+            LogWarning("MeshImporter: PLY vertex count %zu exceeds the file size", (size_t)vertex->count);
+            return false;
+        }
+        if (out.hasColors) out.colorVertices.resize(vertex->count);
+        else               out.vertices.resize(vertex->count);
+
+        const int workers = numWorkers(size, numThreads);
+        const bool ok = format == ply_Ascii
+            ? loadPlyAscii(body, data + size, elements, out, workers)
+            : loadPlyBinary((const uint8_t*)body, (const uint8_t*)data + size, elements, out, workers);
+        if (!ok)
+            return false;
+
+        const index_t numVertices = (index_t)out.numVertices();
+        for (index_t i : out.indices)
+        {
+            if (i >= numVertices) {
+                LogWarning("MeshImporter: PLY face index %u out of range", i);
+                return false;
+            }
+        }
+        if (!out.hasColors && !out.hasNormals && !out.indices.empty())
+            computeNormals(out.vertices, out.indices);
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static bool hasExtension(const string& path, const char* ext)
+    {
+        const size_t len = strlen(ext);
+        if (path.size() < len)
+            return false;
+        for (size_t i = 0; i < len; ++i)
+            if (tolower((unsigned char)path[path.size() - len + i]) != ext[i]) return false;
+        return true;
+    }
+
+    bool MeshImporter::load(const string& path, ImportedMesh& out, int numThreads)
+    {
+        MappedFile file;
+        if (!file.open(path))
+            return false;
+
+        const char* data = (const char*)file.data();
+        bool ok;
+        if      (hasExtension(path, ".obj")) ok = loadObj(data, file.size(), out, numThreads);
+        else if (hasExtension(path, ".ply")) ok = loadPly(data, file.size(), out, numThreads);
+        else {
+            LogWarning("MeshImporter: unsupported file type %s", path.c_str());
+            return false;
+        }
+        if (!ok)
+            LogWarning("MeshImporter: failed to load %s", path.c_str());
+        return ok;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "MeshFile.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Geometry parsed by MeshImporter, ready for VertexBuffer::create().
+     * Files with vertex colors are imported as Vertex3Color, everything else as Vertex3UVNorm.
+     * Triangle meshes without normals get smooth area-weighted normals.
+     */
+    struct AGL_API ImportedMesh
+    {
+        vector<Vertex3UVNorm> vertices;      // used if !hasColors
+        vector<Vertex3Color>  colorVertices; // used if hasColors
+        vector<index_t> indices;             // empty for point clouds
+
+        bool hasColors  = false;
+        bool hasCoords  = false;
+        bool hasNormals = false; // normals were present in the file
+
+        int numVertices()  const { return hasColors ? (int)colorVertices.size() : (int)vertices.size(); }
+        int numTriangles() const { return (int)indices.size() / 3; }
+        DrawMode mode() const { return indices.empty() ? DrawPoints : DrawIndexed; }
+
+        void clear();
+
+        // uploads as DrawIndexed, or as DrawPoints if there are no faces
+        void create(VertexBuffer& outBuffer) const;
+    };
+
+
+    /**
+     * Streaming importer for Wavefront OBJ and ASCII/binary little-endian PLY files.
+     * The file is memory mapped and split into chunks at line boundaries which are parsed
+     * on `numThreads` worker threads, the per-chunk results are then merged with prefix sums.
+     * Binary PLY vertices are bulk copied if the record layout already matches the output vertex.
+     *
+     * @code
+     *     ImportedMesh mesh;
+     *     if (MeshImporter::load("scans/statue.ply", mesh))
+     *         mesh.create(actor->Mesh);
+     * @endcode
+     */
+    class AGL_API MeshImporter
+    {
+    public:
+        /**
+         * Loads an .obj or .ply file, selected by the file extension
+         * @param numThreads Number of parser threads, 0 for std::thread::hardware_concurrency()
+         * @return FALSE if the file can't be opened or is malformed
+         */
+        static bool load(const string& path, ImportedMesh& out, int numThreads = 0);
+
+        static bool loadObj(const char* data, size_t size, ImportedMesh& out, int numThreads = 0);
+        static bool loadPly(const char* data, size_t size, ImportedMesh& out, int numThreads = 0);
+
+        /**
+         * Locale independent decimal float parser, skips leading spaces and tabs.
+         * Advances `s` past the number, leaves it untouched if there is no number
+         */
+        static float parseFloat(const char*& s, const char* end);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
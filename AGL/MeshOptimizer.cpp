@@ -0,0 +1,693 @@
+#include "MeshOptimizer.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#if AGL_SSE
+    #include <emmintrin.h>
+#endif
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * FIFO post-transform cache simulation using timestamps:
+     * a vertex is cached if it was transformed less than `size` misses ago
+     */
+    struct VertexCacheSim
+    {
+        vector<int> cacheTime;
+        int timestamp;
+        int size;
+
+        VertexCacheSim(int numVertices, int cacheSize)
+            : cacheTime(numVertices, 0), timestamp(cacheSize + 1), size(cacheSize)
+        {
+        }
+
+        // @return Number of cache misses of this triangle
+        int triangle(const index_t* tri)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (timestamp - cacheTime[tri[k]] > size)
+                {
+                    cacheTime[tri[k]] = timestamp++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+        // evicts everything from the cache
+        void reset() { timestamp += size + 1; }
+    };
+
+    VertexCacheStats MeshOptimizer::analyzeVertexCache(const index_t* indices, int numIndices,
+                                                       int numVertices, int cacheSize)
+    {
+        VertexCacheStats stats;
+        const int numTriangles = numIndices / 3;
+        if (numTriangles == 0 || numVertices == 0)
+            return stats;
+
+        VertexCacheSim cache { numVertices, cacheSize };
+        for (int t = 0; t < numTriangles; ++t)
+            stats.transformed += cache.triangle(&indices[t*3]);
+
+        int referenced = 0;
+        for (int time : cache.cacheTime)
+            if (time != 0) ++referenced;
+
+        stats.acmr = float(stats.transformed) / numTriangles;
+        stats.atvr = float(stats.transformed) / referenced;
+        return stats;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void MeshOptimizer::optimizeVertexCache(index_t* indices, int numIndices,
+                                            int numVertices, int cacheSize)
+    {
+        const int numTriangles = numIndices / 3;
+        if (numTriangles == 0)
+            return;
+
+        // vertex -> triangles adjacency, live = number of triangles not yet emitted
+        vector<int> live(numVertices, 0);
+        for (int i = 0; i < numTriangles*3; ++i)
+            ++live[indices[i]];
+
+        vector<int> offsets(numVertices + 1, 0);
+        for (int v = 0; v < numVertices; ++v)
+            offsets[v + 1] = offsets[v] + live[v];
+
+        vector<int> adjacency(numTriangles*3);
+        {
+            vector<int> fill(offsets.begin(), offsets.end() - 1);
+            for (int i = 0; i < numTriangles*3; ++i)
+                adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        vector<int> cacheTime(numVertices, 0);
+        vector<char> emitted(numTriangles, 0);
+        vector<index_t> deadEnd;    deadEnd.reserve(numTriangles*3);
+        vector<index_t> candidates; candidates.reserve(64);
+        vector<index_t> result;     result.reserve(numTriangles*3);
+        int timestamp = cacheSize + 1;
+        int cursor = 0;
+
+        int fanning = (int)indices[0];
+        while (fanning >= 0)
+        {
+            // emit all remaining triangles around the fanning vertex
+            candidates.clear();
+            for (int j = offsets[fanning]; j < offsets[fanning + 1]; ++j)
+            {
+                const int t = adjacency[j];
+                if (emitted[t])
+                    continue;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const index_t v = indices[t*3 + k];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (timestamp - cacheTime[v] > cacheSize)
+                        cacheTime[v] = timestamp++;
+                }
+                emitted[t] = 1;
+            }
+
+            // next fanning vertex: the oldest candidate which stays in cache while its fan is emitted
+            int best = -1, bestPriority = -1;
+            for (index_t v : candidates)
+            {
+                if (live[v] <= 0)
+                    continue;
+                int priority = 0;
+                if (timestamp - cacheTime[v] + 2*live[v] <= cacheSize)
+                    priority = timestamp - cacheTime[v];
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    best = (int)v;
+                }
+            }
+
+            if (best == -1) // dead end: most recently referenced vertex with live triangles
+            {
+                while (!deadEnd.empty())
+                {
+                    const index_t v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (live[v] > 0) { best = (int)v; break; }
+                }
+            }
+            if (best == -1) // disconnected: continue from the next vertex in input order
+            {
+                for (; cursor < numVertices; ++cursor)
+                    if (live[cursor] > 0) { best = cursor; break; }
+            }
+            fanning = best;
+        }
+
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void MeshOptimizer::optimizeOverdraw(index_t* indices, int numIndices,
+                                         const float* positions, int stride, int numVertices,
+                                         float threshold, int cacheSize)
+    {
+        const int numTriangles = numIndices / 3;
+        if (numTriangles < 2)
+            return;
+
+        // hard boundaries: triangles where all 3 vertices missed the cache, ie a new Tipsify fan
+        vector<int> clusters;
+        {
+            VertexCacheSim cache { numVertices, cacheSize };
+            for (int t = 0; t < numTriangles; ++t)
+                if (cache.triangle(&indices[t*3]) == 3)
+                    clusters.push_back(t);
+        }
+        if (clusters.empty() || clusters.front() != 0)
+            clusters.insert(clusters.begin(), 0);
+        clusters.push_back(numTriangles);
+
+        // soft boundaries: split hard clusters while their ACMR stays within threshold
+        vector<int> bounds;
+        {
+            VertexCacheSim cache { numVertices, cacheSize };
+            for (size_t c = 0; c + 1 < clusters.size(); ++c)
+            {
+                const int start = clusters[c], end = clusters[c + 1];
+                cache.reset();
+                int misses = 0;
+                for (int t = start; t < end; ++t)
+                    misses += cache.triangle(&indices[t*3]);
+                const float clusterThreshold = threshold * float(misses) / float(end - start);
+
+                cache.reset();
+                bounds.push_back(start);
+                int runningMisses = 0, runningTriangles = 0;
+                for (int t = start; t < end; ++t)
+                {
+                    runningMisses += cache.triangle(&indices[t*3]);
+                    ++runningTriangles;
+                    if (t + 1 < end && float(runningMisses) / runningTriangles <= clusterThreshold)
+                    {
+                        bounds.push_back(t + 1);
+                        runningMisses = runningTriangles = 0;
+                        cache.reset();
+                    }
+                }
+            }
+            bounds.push_back(numTriangles);
+        }
+
+        auto position = [&](index_t v) -> Vector3
+        {
+            const float* p = (const float*)((const char*)positions + (size_t)v*stride);
+            return Vector3{ p[0], p[1], p[2] };
+        };
+
+        // area weighted centroid and normal of each cluster
+        struct Cluster { int start, end; Vector3 centroid, normal; float area, sortKey; };
+        const int numClusters = (int)bounds.size() - 1;
+        vector<Cluster> infos(numClusters);
+        Vector3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+        float meshArea = 0.0f;
+
+        for (int c = 0; c < numClusters; ++c)
+        {
+            Cluster& cl = infos[c];
+            cl.start = bounds[c];
+            cl.end   = bounds[c + 1];
+            cl.centroid = { 0.0f, 0.0f, 0.0f };
+            cl.normal   = { 0.0f, 0.0f, 0.0f };
+            cl.area = 0.0f;
+            for (int t = cl.start; t < cl.end; ++t)
+            {
+                const Vector3 a = position(indices[t*3 + 0]);
+                const Vector3 b = position(indices[t*3 + 1]);
+                const Vector3 c3 = position(indices[t*3 + 2]);
+                const Vector3 e1 = { b.x - a.x, b.y - a.y, b.z - a.z };
+                const Vector3 e2 = { c3.x - a.x, c3.y - a.y, c3.z - a.z };
+                const Vector3 n = { e1.y*e2.z - e1.z*e2.y, e1.z*e2.x - e1.x*e2.z, e1.x*e2.y - e1.y*e2.x };
+                const float area = std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+                const float w = area / 3.0f;
+                cl.centroid.x += (a.x + b.x + c3.x) * w;
+                cl.centroid.y += (a.y + b.y + c3.y) * w;
+                cl.centroid.z += (a.z + b.z + c3.z) * w;
+                cl.normal.x += n.x;
+                cl.normal.y += n.y;
+                cl.normal.z += n.z;
+                cl.area += area;
+            }
+            meshCentroid.x += cl.centroid.x;
+            meshCentroid.y += cl.centroid.y;
+            meshCentroid.z += cl.centroid.z;
+            meshArea += cl.area;
+            if (cl.area > 0.0f)
+            {
+                cl.centroid.x /= cl.area;
+                cl.centroid.y /= cl.area;
+                cl.centroid.z /= cl.area;
+            }
+        }
+        if (meshArea > 0.0f)
+        {
+            meshCentroid.x /= meshArea;
+            meshCentroid.y /= meshArea;
+            meshCentroid.z /= meshArea;
+        }
+
+        // clusters facing outward from the mesh center occlude the rest, so draw them first
+        for (Cluster& cl : infos)
+        {
+            const float len = std::sqrt(cl.normal.x*cl.normal.x + cl.normal.y*cl.normal.y + cl.normal.z*cl.normal.z);
+            const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            cl.sortKey = ((cl.centroid.x - meshCentroid.x) * cl.normal.x
+                        + (cl.centroid.y - meshCentroid.y) * cl.normal.y
+                        + (cl.centroid.z - meshCentroid.z) * cl.normal.z) * inv;
+        }
+        std::stable_sort(infos.begin(), infos.end(), [](const Cluster& a, const Cluster& b) {
+            return a.sortKey > b.sortKey;
+        });
+
+        vector<index_t> result;
+        result.reserve(numTriangles*3);
+        for (const Cluster& cl : infos)
+            result.insert(result.end(), &indices[cl.start*3], &indices[cl.end*3]);
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    int MeshOptimizer::weldVertices(void* vertices, int numVertices, const VertexDescr& layout,
+                                    index_t* indices, int numIndices, float epsilon)
+    {
+        if (numVertices <= 1)
+            return numVertices;
+
+        // comparison key of each vertex: float components quantized to the epsilon grid,
+        // everything else as raw bytes
+        const bool quantize = epsilon > 0.0f;
+        const float invEpsilon = quantize ? 1.0f / epsilon : 0.0f;
+        int keySize = 0;
+        for (int i = 0; i < 4 && layout.items[i].size; ++i)
+            keySize += layout.items[i].bytes();
+
+        char* data = (char*)vertices;
+        const int stride = layout.sizeOf;
+        vector<char> keys((size_t)numVertices * keySize);
+        for (int v = 0; v < numVertices; ++v)
+        {
+            const char* src = data + (size_t)v * stride;
+            char* key = &keys[(size_t)v * keySize];
+            for (int i = 0; i < 4 && layout.items[i].size; ++i)
+            {
+                const VertexDescrElem& e = layout.items[i];
+                const int bytes = e.bytes();
+                if (quantize && e.type == vt_Float)
+                {
+                    for (int c = 0; c < e.size; ++c)
+                    {
+                        float f; memcpy(&f, src + c*sizeof(float), sizeof(f));
+                        int32_t q = (int32_t)std::floor(f * invEpsilon + 0.5f);
+                        memcpy(key + c*sizeof(q), &q, sizeof(q));
+                    }
+                }
+                else
+                {
+                    memcpy(key, src, bytes);
+                    if (e.type == vt_Float) // +0.0 and -0.0 are the same vertex
+                        for (int c = 0; c < e.size; ++c)
+                        {
+                            float f; memcpy(&f, key + c*sizeof(float), sizeof(f));
+                            if (f == 0.0f) memset(key + c*sizeof(float), 0, sizeof(float));
+                        }
+                }
+                src += bytes;
+                key += bytes;
+            }
+        }
+
+        // open addressing hash table of vertex ids
+        int tableSize = 16;
+        while (tableSize < numVertices * 2) tableSize *= 2;
+        vector<int> table(tableSize, -1);
+        vector<int> remap(numVertices);
+        int numUnique = 0;
+
+        for (int v = 0; v < numVertices; ++v)
+        {
+            const char* key = &keys[(size_t)v * keySize];
+            int slot = (int)(fnv1a64(key, keySize) & (tableSize - 1));
+            for (;;)
+            {
+                const int existing = table[slot];
+                if (existing == -1)
+                {
+                    table[slot] = v;
+                    if (numUnique != v) // compact in place, first occurrence order is kept
+                    {
+                        memmove(data + (size_t)numUnique * stride, data + (size_t)v * stride, stride);
+                        memcpy(&keys[(size_t)numUnique * keySize], key, keySize);
+                        table[slot] = numUnique;
+                    }
+                    remap[v] = numUnique++;
+                    break;
+                }
+                if (memcmp(&keys[(size_t)existing * keySize], key, keySize) == 0)
+                {
+                    remap[v] = existing;
+                    break;
+                }
+                slot = (slot + 1) & (tableSize - 1);
+            }
+        }
+
+        for (int i = 0; i < numIndices; ++i)
+            indices[i] = (index_t)remap[indices[i]];
+        return numUnique;
+    }
+
+    int MeshOptimizer::optimizeVertexFetch(void* vertices, int numVertices, int vertexSize,
+                                           index_t* indices, int numIndices)
+    {
+        vector<int> remap(numVertices, -1);
+        int numUsed = 0;
+        for (int i = 0; i < numIndices; ++i)
+        {
+            int& mapped = remap[indices[i]];
+            if (mapped == -1)
+                mapped = numUsed++;
+            indices[i] = (index_t)mapped;
+        }
+
+        vector<char> reordered((size_t)numUsed * vertexSize);
+        const char* src = (const char*)vertices;
+        for (int v = 0; v < numVertices; ++v)
+            if (remap[v] != -1)
+                memcpy(&reordered[(size_t)remap[v] * vertexSize], &src[(size_t)v * vertexSize], vertexSize);
+        memcpy(vertices, reordered.data(), reordered.size());
+        return numUsed;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    // symmetric 4x4 error quadric [Garland & Heckbert 1997], weighted by triangle area
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0;
+        double w = 0; // total area, error() is the area weighted mean squared distance
+
+        void addPlane(double nx, double ny, double nz, double d, double weight)
+        {
+            a00 += weight*nx*nx; a01 += weight*nx*ny; a02 += weight*nx*nz;
+            a11 += weight*ny*ny; a12 += weight*ny*nz; a22 += weight*nz*nz;
+            b0  += weight*nx*d;  b1  += weight*ny*d;  b2  += weight*nz*d;
+            c   += weight*d*d;
+            w   += weight;
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+            return *this;
+        }
+
+        double error(const float* p) const
+        {
+            const double x = p[0], y = p[1], z = p[2];
+            const double e = x*(a00*x + 2*a01*y + 2*a02*z) + y*(a11*y + 2*a12*z) + a22*z*z
+                           + 2*(b0*x + b1*y + b2*z) + c;
+            return w > 0 ? std::max(e / w, 0.0) : 0.0;
+        }
+    };
+
+    static Quadric operator+(Quadric a, const Quadric& b) { return a += b; }
+
+    static void triangleNormal(const float* a, const float* b, const float* c, double (&n)[3])
+    {
+        const double e1[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        const double e2[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+        n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+        n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+    }
+
+    // open addressing table of unique keys, @return id of `key` and whether it was inserted
+    template<class Key> static int findOrInsert(vector<int>& table, vector<Key>& keys, const Key& key)
+    {
+        const int mask = (int)table.size() - 1;
+        for (int slot = (int)(fnv1a64(&key, sizeof(key)) & mask); ; slot = (slot + 1) & mask)
+        {
+            const int existing = table[slot];
+            if (existing == -1) {
+                table[slot] = (int)keys.size();
+                keys.push_back(key);
+                return table[slot];
+            }
+            if (memcmp(&keys[existing], &key, sizeof(key)) == 0)
+                return existing;
+        }
+    }
+
+    float MeshOptimizer::simplify(const index_t* indices, int numIndices,
+                                  const float* positions, int stride, int numVertices,
+                                  int targetIndexCount, float targetError, vector<index_t>& outIndices)
+    {
+        auto position = [&](int v) { return (const float*)((const char*)positions + (size_t)v * stride); };
+        int tableSize = 16;
+        while (tableSize < numVertices * 2) tableSize *= 2;
+
+        // collapses work on unique positions, so UV and normal seams stay closed
+        struct PositionKey { float x, y, z; };
+        vector<int> table(tableSize, -1);
+        vector<PositionKey> uniquePositions;
+        vector<int> canonical(numVertices), representative;
+        for (int v = 0; v < numVertices; ++v)
+        {
+            const float* p = position(v);
+            PositionKey key { p[0] == 0.0f ? 0.0f : p[0], p[1] == 0.0f ? 0.0f : p[1], p[2] == 0.0f ? 0.0f : p[2] };
+            canonical[v] = findOrInsert(table, uniquePositions, key);
+            if (canonical[v] == (int)representative.size())
+                representative.push_back(v);
+        }
+        const int numUnique = (int)uniquePositions.size();
+        auto uniquePosition = [&](int u) { return &uniquePositions[u].x; };
+
+        // triangles as unique position ids, plus the original vertex of every corner
+        vector<int> tris, corners;
+        tris.reserve(numIndices);
+        corners.reserve(numIndices);
+        for (int i = 0; i + 2 < numIndices; i += 3)
+        {
+            const int a = canonical[indices[i]], b = canonical[indices[i+1]], c = canonical[indices[i+2]];
+            if (a == b || b == c || c == a)
+                continue;
+            tris.insert(tris.end(), { a, b, c });
+            corners.insert(corners.end(), { (int)indices[i], (int)indices[i+1], (int)indices[i+2] });
+        }
+
+        vector<Quadric> quadrics(numUnique);
+        for (size_t t = 0; t < tris.size(); t += 3)
+        {
+            double n[3];
+            const float* p0 = uniquePosition(tris[t]);
+            triangleNormal(p0, uniquePosition(tris[t+1]), uniquePosition(tris[t+2]), n);
+            const double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            if (len <= 0.0) continue;
+            const double nx = n[0]/len, ny = n[1]/len, nz = n[2]/len;
+            const double d = -(nx*p0[0] + ny*p0[1] + nz*p0[2]);
+            for (int k = 0; k < 3; ++k)
+                quadrics[tris[t+k]].addPlane(nx, ny, nz, d, len * 0.5);
+        }
+
+        // vertices on open borders are locked, collapsing them would shrink the outline
+        vector<char> locked(numUnique, 0);
+        {
+            struct EdgeKey { int a, b; };
+            int edgeTableSize = 16;
+            while (edgeTableSize < (int)tris.size() * 2) edgeTableSize *= 2;
+            vector<int> edgeTable(edgeTableSize, -1);
+            vector<EdgeKey> edges;
+            vector<int> edgeUses;
+            for (size_t t = 0; t < tris.size(); t += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    const int a = tris[t+k], b = tris[t + (k+1)%3];
+                    const int id = findOrInsert(edgeTable, edges, EdgeKey{ std::min(a, b), std::max(a, b) });
+                    if (id == (int)edgeUses.size()) edgeUses.push_back(0);
+                    ++edgeUses[id];
+                }
+            }
+            for (size_t e = 0; e < edges.size(); ++e)
+                if (edgeUses[e] == 1) locked[edges[e].a] = locked[edges[e].b] = 1;
+        }
+
+        struct Collapse
+        {
+            int from, to;
+            double cost;
+            bool operator<(const Collapse& c) const { return cost < c.cost; }
+        };
+        const double maxCost = targetError < FLT_MAX ? double(targetError) * targetError : DBL_MAX;
+        double resultCost = 0.0;
+        vector<int> adjacencyOffsets, adjacency, remap(numUnique);
+        vector<char> touched;
+        vector<Collapse> collapses;
+
+        // each pass collapses a set of independent edges in order of increasing error
+        while ((int)tris.size() > targetIndexCount)
+        {
+            adjacencyOffsets.assign(numUnique + 1, 0);
+            for (int v : tris) ++adjacencyOffsets[v + 1];
+            for (int v = 0; v < numUnique; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+            adjacency.resize(tris.size());
+            {
+                vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < tris.size(); ++i)
+                    adjacency[fill[tris[i]]++] = (int)(i / 3);
+            }
+
+            collapses.clear();
+            for (size_t t = 0; t < tris.size(); t += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    const int a = tris[t+k], b = tris[t + (k+1)%3];
+                    if (a > b) continue; // every interior edge is seen from both of its triangles
+                    const Quadric q = quadrics[a] + quadrics[b];
+                    const double ab = locked[a] ? DBL_MAX : q.error(uniquePosition(b));
+                    const double ba = locked[b] ? DBL_MAX : q.error(uniquePosition(a));
+                    if (ab == DBL_MAX && ba == DBL_MAX) continue;
+                    collapses.push_back(ab <= ba ? Collapse{ a, b, ab } : Collapse{ b, a, ba });
+                }
+            }
+            std::sort(collapses.begin(), collapses.end());
+
+            for (int v = 0; v < numUnique; ++v) remap[v] = v;
+            touched.assign(numUnique, 0);
+            const int trianglesToRemove = ((int)tris.size() - targetIndexCount) / 3;
+            int removed = 0, numCollapsed = 0;
+
+            for (const Collapse& c : collapses)
+            {
+                if (c.cost > maxCost || removed >= trianglesToRemove)
+                    break;
+                if (touched[c.from] || touched[c.to])
+                    continue;
+
+                // reject collapses that flip any remaining triangle around `from`
+                int shared = 0;
+                bool flips = false;
+                for (int i = adjacencyOffsets[c.from]; i < adjacencyOffsets[c.from + 1] && !flips; ++i)
+                {
+                    const int* tri = &tris[adjacency[i] * 3];
+                    if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                        ++shared;
+                        continue;
+                    }
+                    const float* p[3];
+                    for (int k = 0; k < 3; ++k) p[k] = uniquePosition(tri[k]);
+                    double before[3], after[3];
+                    triangleNormal(p[0], p[1], p[2], before);
+                    for (int k = 0; k < 3; ++k) if (tri[k] == c.from) p[k] = uniquePosition(c.to);
+                    triangleNormal(p[0], p[1], p[2], after);
+                    flips = before[0]*after[0] + before[1]*after[1] + before[2]*after[2] <= 0.0;
+                }
+                if (flips)
+                    continue;
+
+                remap[c.from] = c.to;
+                quadrics[c.to] += quadrics[c.from];
+                resultCost = std::max(resultCost, c.cost);
+                for (int i = adjacencyOffsets[c.from]; i < adjacencyOffsets[c.from + 1]; ++i)
+                    for (int k = 0; k < 3; ++k) touched[tris[adjacency[i]*3 + k]] = 1;
+                removed += shared;
+                ++numCollapsed;
+            }
+            if (numCollapsed == 0)
+                break;
+
+            size_t kept = 0;
+            for (size_t t = 0; t < tris.size(); t += 3)
+            {
+                const int a = remap[tris[t]], b = remap[tris[t+1]], c = remap[tris[t+2]];
+                if (a == b || b == c || c == a)
+                    continue;
+                tris[kept] = a; tris[kept+1] = b; tris[kept+2] = c;
+                memmove(&corners[kept], &corners[t], sizeof(int)*3);
+                kept += 3;
+            }
+            tris.resize(kept);
+            corners.resize(kept);
+        }
+
+        // corners keep their own vertex if it still has the right position, so attributes are preserved
+        outIndices.resize(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i)
+            outIndices[i] = (index_t)(canonical[corners[i]] == tris[i] ? corners[i] : representative[tris[i]]);
+        return (float)sqrt(resultCost);
+    }
+
+    vector<MeshLod> MeshOptimizer::generateLods(vector<index_t>& indices, const float* positions, int stride,
+                                                int numVertices, int maxLods, float ratio, float maxError)
+    {
+        vector<MeshLod> lods;
+        lods.push_back({ 0u, (uint32_t)indices.size(), 0.0f });
+
+        vector<index_t> current { indices }, simplified;
+        float error = 0.0f;
+        for (int i = 1; i < maxLods && error < maxError; ++i)
+        {
+            const int target = (int)(current.size() * ratio) / 3 * 3;
+            const float allowed = maxError < FLT_MAX ? maxError - error : FLT_MAX;
+            error += simplify(current.data(), (int)current.size(), positions, stride, numVertices,
+                              target, allowed, simplified);
+            if (simplified.empty() || simplified.size() > current.size() * 0.95f)
+                break; // nothing left to simplify within maxError
+            lods.push_back({ (uint32_t)indices.size(), (uint32_t)simplified.size(), error });
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+            current.swap(simplified);
+        }
+        return lods;
+    }
+
+    void MeshOptimizer::rebaseIndices(index_t* dst, const index_t* src, int count, index_t offset)
+    {
+        int i = 0;
+    #if AGL_SSE
+        const __m128i base = _mm_set1_epi32((int)offset);
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+            const __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 8));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 12));
+            _mm_storeu_si128((__m128i*)(dst + i),      _mm_add_epi32(a, base));
+            _mm_storeu_si128((__m128i*)(dst + i + 4),  _mm_add_epi32(b, base));
+            _mm_storeu_si128((__m128i*)(dst + i + 8),  _mm_add_epi32(c, base));
+            _mm_storeu_si128((__m128i*)(dst + i + 12), _mm_add_epi32(d, base));
+        }
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(src + i)), base));
+    #endif
+        for (; i < count; ++i)
+            dst[i] = src[i] + offset;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include "Shader.h"
+#include <cfloat>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /** @brief Post-transform vertex cache efficiency of an index buffer */
+    struct VertexCacheStats
+    {
+        float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle, 0.5 is ideal
+        float atvr = 0.0f; // average transform to vertex ratio: transformed vertices per vertex, 1.0 is ideal
+        int transformed = 0; // number of vertex shader invocations
+    };
+
+    /** @brief Vertex cache stats before and after MeshOptimizer::optimize() */
+    struct MeshOptimizeStats
+    {
+        VertexCacheStats before;
+        VertexCacheStats after;
+        int verticesBefore = 0;
+        int verticesAfter  = 0; // unreferenced vertices are dropped by OptimizeVertexFetch
+    };
+
+    /** @brief A level of detail: a range of the shared index buffer */
+    struct MeshLod
+    {
+        uint32_t firstIndex = 0;
+        uint32_t numIndices = 0;
+        float    error = 0.0f; // object space simplification error of this LOD, 0 for the full mesh
+    };
+
+    /** @brief Actor triangles drawn in a frame, with selected LODs vs at full detail */
+    struct MeshLodStats
+    {
+        int actors = 0;
+        int reducedActors = 0; // actors drawn with a lower LOD than Mesh
+        int64_t submittedTriangles = 0;
+        int64_t fullTriangles = 0;
+    };
+
+    enum MeshOptimizeFlags
+    {
+        OptimizeVertexCache = 1, // reorder triangles for the post-transform vertex cache (Tipsify)
+        OptimizeOverdraw    = 2, // reorder triangle clusters front to back, requires OptimizeVertexCache
+        OptimizeVertexFetch = 4, // reorder vertices in first-use order and remap the indices
+        OptimizeAll         = 7,
+    };
+
+
+    /**
+     * Post-processing of indexed triangle meshes, run before VertexBuffer::create():
+     *
+     * @code
+     *     MeshOptimizeStats stats = MeshOptimizer::optimize(vertices, indices);
+     *     LogInfo("ACMR %.3f -> %.3f", stats.before.acmr, stats.after.acmr);
+     *     mesh.create(vertices, indices);
+     * @endcode
+     */
+    class AGL_API MeshOptimizer
+    {
+    public:
+        // FIFO cache size for simulation and optimization, typical for modern GPUs
+        static constexpr int DefaultCacheSize = 16;
+
+        /**
+         * Simulates a FIFO post-transform vertex cache
+         */
+        static VertexCacheStats analyzeVertexCache(const index_t* indices, int numIndices,
+                                                   int numVertices, int cacheSize = DefaultCacheSize);
+
+        /**
+         * Reorders triangles for vertex cache locality with Tipsify [Sander et al. 2007]
+         */
+        static void optimizeVertexCache(index_t* indices, int numIndices,
+                                        int numVertices, int cacheSize = DefaultCacheSize);
+
+        /**
+         * Reorders vertex cache optimized triangles into clusters sorted front to back
+         * from the mesh center outward, which reduces overdraw from any view direction
+         * @param positions First vertex position xyz
+         * @param stride Bytes between consecutive vertex positions
+         * @param threshold Allowed ACMR degradation, eg 1.05 allows 5% more cache misses
+         */
+        static void optimizeOverdraw(index_t* indices, int numIndices,
+                                     const float* positions, int stride, int numVertices,
+                                     float threshold = 1.05f, int cacheSize = DefaultCacheSize);
+
+        /**
+         * Reorders vertices in the order they are first referenced and remaps the indices,
+         * unreferenced vertices are removed
+         * @param vertices Vertex data, `vertexSize` bytes each, reordered in place
+         * @return New number of vertices
+         */
+        static int optimizeVertexFetch(void* vertices, int numVertices, int vertexSize,
+                                       index_t* indices, int numIndices);
+
+        /**
+         * Merges duplicate vertices and rebuilds the index buffer. Vertices are compared
+         * by the attributes of `layout`, struct padding is ignored.
+         * @param vertices Vertex data, layout.sizeOf bytes each, compacted in place
+         * @param epsilon If > 0, float components are quantized to this grid before comparing,
+         *                which also merges seam vertices with rounding differences
+         * @return New number of vertices, the first occurrence of each vertex is kept
+         */
+        static int weldVertices(void* vertices, int numVertices, const VertexDescr& layout,
+                                index_t* indices, int numIndices, float epsilon = 0.0f);
+
+        // automatic template wrapper, requires static layout() provider
+        template<class VERTEX>
+        static int weldVertices(vector<VERTEX>& vertices, vector<index_t>& indices, float epsilon = 0.0f)
+        {
+            vertices.resize(weldVertices(vertices.data(), (int)vertices.size(), VERTEX::layout(),
+                                         indices.data(), (int)indices.size(), epsilon));
+            return (int)vertices.size();
+        }
+
+        /**
+         * Copies `count` indices adding `offset` to each, 4 at a time with SSE2.
+         * `dst` may equal `src` for rebasing in place
+         */
+        static void rebaseIndices(index_t* dst, const index_t* src, int count, index_t offset);
+
+        /**
+         * Simplifies a triangle mesh with quadric error metric edge collapses [Garland & Heckbert 1997].
+         * Only the index buffer is rebuilt, the result references the original vertices, so LODs can
+         * share one vertex buffer. Vertices with equal positions collapse together, which keeps UV and
+         * normal seams closed, and vertices on open borders are never moved.
+         * @param positions First vertex position xyz
+         * @param stride Bytes between consecutive vertex positions
+         * @param targetIndexCount Stop once the result has at most this many indices
+         * @param targetError Max object space distance error, FLT_MAX for no limit
+         * @param outIndices Simplified triangles
+         * @return Object space error of the result
+         */
+        static float simplify(const index_t* indices, int numIndices,
+                              const float* positions, int stride, int numVertices,
+                              int targetIndexCount, float targetError, vector<index_t>& outIndices);
+
+        /**
+         * Builds a LOD chain by repeatedly simplifying the previous LOD by `ratio`.
+         * The LOD indices are appended to `indices`, which then holds the whole chain,
+         * eg for MeshFile::save() or one VertexBuffer per LOD range
+         * @param maxError Stop once the accumulated error would exceed this
+         * @return LOD ranges of `indices`, the first one is the original mesh
+         */
+        static vector<MeshLod> generateLods(vector<index_t>& indices, const float* positions, int stride,
+                                            int numVertices, int maxLods = 4, float ratio = 0.5f,
+                                            float maxError = FLT_MAX);
+
+        /**
+         * Runs the selected optimization passes in the correct order
+         * @note VERTEX must start with float x, y, z if OptimizeOverdraw is used
+         */
+        template<class VERTEX>
+        static MeshOptimizeStats optimize(vector<VERTEX>& vertices, vector<index_t>& indices,
+                                          int flags = OptimizeAll, float overdrawThreshold = 1.05f)
+        {
+            MeshOptimizeStats stats;
+            const int numIndices = (int)indices.size();
+            stats.verticesBefore = (int)vertices.size();
+            stats.before = analyzeVertexCache(indices.data(), numIndices, stats.verticesBefore);
+            if (vertices.empty()) // nothing to reorder, and there is no vertex to take the address of
+            {
+                stats.after = stats.before;
+                return stats;
+            }
+
+            if (flags & OptimizeVertexCache)
+            {
+                optimizeVertexCache(indices.data(), numIndices, stats.verticesBefore);
+                if (flags & OptimizeOverdraw)
+                    optimizeOverdraw(indices.data(), numIndices, &vertices.data()->x, sizeof(VERTEX),
+                                     stats.verticesBefore, overdrawThreshold);
+            }
+            if (flags & OptimizeVertexFetch)
+                vertices.resize(optimizeVertexFetch(vertices.data(), stats.verticesBefore,
+                                                    sizeof(VERTEX), indices.data(), numIndices));
+
+            stats.verticesAfter = (int)vertices.size();
+            stats.after = analyzeVertexCache(indices.data(), numIndices, stats.verticesAfter);
+            return stats;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
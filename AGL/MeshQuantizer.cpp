@@ -0,0 +1,192 @@
+#include "MeshQuantizer.h"
+#include <cmath>
+#include <algorithm>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    uint16_t toHalf(float value)
+    {
+        uint32_t f; memcpy(&f, &value, sizeof(f));
+        const uint32_t sign = (f >> 16) & 0x8000;
+        const int32_t  exp  = int32_t((f >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa   = f & 0x7FFFFF;
+
+        if (((f >> 23) & 0xFF) == 0xFF) // Inf or NaN
+            return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+        if (exp >= 31) // overflow to Inf
+            return uint16_t(sign | 0x7C00);
+        if (exp <= 0) // denormal or zero
+        {
+            if (exp < -10) return uint16_t(sign);
+            mantissa |= 0x800000; // implicit leading 1
+            const int shift = 14 - exp;
+            uint32_t half = mantissa >> shift;
+            const uint32_t rem = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (rem > halfway || (rem == halfway && (half & 1))) ++half;
+            return uint16_t(sign | half);
+        }
+        uint32_t half = sign | (uint32_t(exp) << 10) | (mantissa >> 13);
+        const uint32_t rem = mantissa & 0x1FFF;
+        if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+            ++half; // may carry into the exponent, which rounds correctly up to Inf
+        return uint16_t(half);
+    }
+
+    float fromHalf(uint16_t half)
+    {
+        const uint32_t sign = uint32_t(half & 0x8000) << 16;
+        uint32_t exp        = (half >> 10) & 0x1F;
+        uint32_t mantissa   = half & 0x3FF;
+        uint32_t f;
+        if (exp == 0x1F) {
+            f = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else if (exp == 0) {
+            if (mantissa == 0) {
+                f = sign;
+            }
+            else { // denormal: normalize it
+                exp = 127 - 15 + 1;
+                while (!(mantissa & 0x400)) { mantissa <<= 1; --exp; }
+                f = sign | (exp << 23) | ((mantissa & 0x3FF) << 13);
+            }
+        }
+        else {
+            f = sign | ((exp - 15 + 127) << 23) | (mantissa << 13);
+        }
+        float value; memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+
+    static uint32_t toSNorm10(float value)
+    {
+        value = value < -1.0f ? -1.0f : value > 1.0f ? 1.0f : value;
+        return uint32_t(int32_t(std::round(value * 511.0f))) & 0x3FF;
+    }
+
+    static float fromSNorm10(uint32_t bits)
+    {
+        int32_t value = int32_t(bits << 22) >> 22; // sign extend 10 bits
+        float f = value / 511.0f;
+        return f < -1.0f ? -1.0f : f;
+    }
+
+    uint32_t packNormal(Vector3 n)
+    {
+        return toSNorm10(n.x) | (toSNorm10(n.y) << 10) | (toSNorm10(n.z) << 20);
+    }
+
+    Vector3 unpackNormal(uint32_t packed)
+    {
+        return Vector3{ fromSNorm10(packed), fromSNorm10(packed >> 10), fromSNorm10(packed >> 20) };
+    }
+
+    Matrix4 QuantizedPositions::transform() const
+    {
+        Matrix4 m = Matrix4::Identity();
+        m.m[0]  = Scale.x;
+        m.m[5]  = Scale.y;
+        m.m[10] = Scale.z;
+        m.m[12] = Offset.x;
+        m.m[13] = Offset.y;
+        m.m[14] = Offset.z;
+        return m;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    void MeshQuantizer::pack(const Vertex3Color* verts, int numVerts, Vertex3ColorPacked* out)
+    {
+        for (int i = 0; i < numVerts; ++i)
+        {
+            const Vertex3Color& v = verts[i];
+            Vertex3ColorPacked& o = out[i];
+            o.x = v.x; o.y = v.y; o.z = v.z;
+            o.r = toUNorm8(v.r);
+            o.g = toUNorm8(v.g);
+            o.b = toUNorm8(v.b);
+            o.a = toUNorm8(v.a);
+        }
+    }
+
+    void MeshQuantizer::pack(const Vertex3UVNorm* verts, int numVerts, Vertex3UVNormPacked* out)
+    {
+        for (int i = 0; i < numVerts; ++i)
+        {
+            const Vertex3UVNorm& v = verts[i];
+            Vertex3UVNormPacked& o = out[i];
+            o.x = v.x; o.y = v.y; o.z = v.z;
+            o.u = toHalf(v.u);
+            o.v = toHalf(v.v);
+            o.normal = packNormal({ v.nx, v.ny, v.nz });
+        }
+    }
+
+    QuantizedPositions MeshQuantizer::quantize(const Vertex3UVNorm* verts, int numVerts,
+                                               Vertex3UVNormQuantized* out)
+    {
+        QuantizedPositions q;
+        if (numVerts <= 0)
+            return q;
+
+        Vector3 min = { verts[0].x, verts[0].y, verts[0].z };
+        Vector3 max = min;
+        for (int i = 1; i < numVerts; ++i)
+        {
+            const Vertex3UVNorm& v = verts[i];
+            min.x = std::min(min.x, v.x); max.x = std::max(max.x, v.x);
+            min.y = std::min(min.y, v.y); max.y = std::max(max.y, v.y);
+            min.z = std::min(min.z, v.z); max.z = std::max(max.z, v.z);
+        }
+
+        // map [min,max] to [-1,1]: position = quantized * Scale + Offset
+        q.Offset = { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+        q.Scale  = { (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f };
+        const Vector3 inv = {
+            q.Scale.x > 0.0f ? 1.0f / q.Scale.x : 0.0f,
+            q.Scale.y > 0.0f ? 1.0f / q.Scale.y : 0.0f,
+            q.Scale.z > 0.0f ? 1.0f / q.Scale.z : 0.0f,
+        };
+
+        for (int i = 0; i < numVerts; ++i)
+        {
+            const Vertex3UVNorm& v = verts[i];
+            Vertex3UVNormQuantized& o = out[i];
+            o.x = toSNorm16((v.x - q.Offset.x) * inv.x);
+            o.y = toSNorm16((v.y - q.Offset.y) * inv.y);
+            o.z = toSNorm16((v.z - q.Offset.z) * inv.z);
+            o.w = 0;
+            o.u = toHalf(v.u);
+            o.v = toHalf(v.v);
+            o.normal = packNormal({ v.nx, v.ny, v.nz });
+        }
+        return q;
+    }
+
+    vector<Vertex3ColorPacked> MeshQuantizer::pack(const vector<Vertex3Color>& verts)
+    {
+        vector<Vertex3ColorPacked> out(verts.size());
+        pack(verts.data(), (int)verts.size(), out.data());
+        return out;
+    }
+
+    vector<Vertex3UVNormPacked> MeshQuantizer::pack(const vector<Vertex3UVNorm>& verts)
+    {
+        vector<Vertex3UVNormPacked> out(verts.size());
+        pack(verts.data(), (int)verts.size(), out.data());
+        return out;
+    }
+
+    vector<Vertex3UVNormQuantized> MeshQuantizer::quantize(const vector<Vertex3UVNorm>& verts,
+                                                           QuantizedPositions& outDequantize)
+    {
+        vector<Vertex3UVNormQuantized> out(verts.size());
+        outDequantize = quantize(verts.data(), (int)verts.size(), out.data());
+        return out;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
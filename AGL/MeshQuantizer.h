@@ -0,0 +1,71 @@
+#pragma once
+#include "Shader.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /** @return IEEE 754 half-float, rounded to nearest even */
+    AGL_API uint16_t toHalf(float value);
+    AGL_API float fromHalf(uint16_t half);
+
+    /** @return Normal packed as SNORM GL_INT_2_10_10_10_REV with w=0 */
+    AGL_API uint32_t packNormal(Vector3 normal);
+    AGL_API Vector3 unpackNormal(uint32_t packed);
+
+    /** @return Color packed as 4x UNORM8 */
+    inline uint8_t toUNorm8(float value)
+    {
+        value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+        return uint8_t(value * 255.0f + 0.5f);
+    }
+
+    /** @return [-1,1] value as SNORM16 */
+    inline int16_t toSNorm16(float value)
+    {
+        value = value < -1.0f ? -1.0f : value > 1.0f ? 1.0f : value;
+        return int16_t(value * 32767.0f + (value < 0.0f ? -0.5f : 0.5f));
+    }
+
+
+    /**
+     * Dequantization of SNORM16 positions: position = quantized * Scale + Offset
+     */
+    struct QuantizedPositions
+    {
+        Vector3 Scale  = { 1.0f, 1.0f, 1.0f };
+        Vector3 Offset = { 0.0f, 0.0f, 0.0f };
+
+        /** @return Transform to prepend to the model transform, eg Actor::MeshTransform */
+        Matrix4 transform() const;
+    };
+
+
+    /**
+     * Converts float meshes into packed vertex formats:
+     *     Vertex3Color  -> Vertex3ColorPacked      28 -> 16 bytes
+     *     Vertex3UVNorm -> Vertex3UVNormPacked     32 -> 20 bytes
+     *     Vertex3UVNorm -> Vertex3UVNormQuantized  32 -> 16 bytes
+     * Index buffers are unchanged, so they can be reused as they are.
+     */
+    class AGL_API MeshQuantizer
+    {
+    public:
+        static void pack(const Vertex3Color* verts, int numVerts, Vertex3ColorPacked* out);
+        static void pack(const Vertex3UVNorm* verts, int numVerts, Vertex3UVNormPacked* out);
+
+        /**
+         * Quantizes positions to SNORM16 relative to the mesh bounding box
+         * @return Dequantization which must be applied to the model transform
+         */
+        static QuantizedPositions quantize(const Vertex3UVNorm* verts, int numVerts,
+                                           Vertex3UVNormQuantized* out);
+
+        static vector<Vertex3ColorPacked> pack(const vector<Vertex3Color>& verts);
+        static vector<Vertex3UVNormPacked> pack(const vector<Vertex3UVNorm>& verts);
+        static vector<Vertex3UVNormQuantized> quantize(const vector<Vertex3UVNorm>& verts,
+                                                       QuantizedPositions& outDequantize);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
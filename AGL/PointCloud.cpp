@@ -0,0 +1,453 @@
+#include "PointCloud.h"
+#include "OpenGL.h"
+#include <rpp/debugging.h>
+#include <rpp/file_io.h>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static constexpr uint32_t MaxOctreeLevels = 24;
+
+    // recursive octree partitioning of a shuffled point array, every node's own points
+    // are the first `numPoints` of its subtree range, so they're a uniform subsample
+    struct OctreeBuilder
+    {
+        vector<Vertex3ColorPacked>& points;
+        vector<Vertex3ColorPacked> scratch;
+        vector<PointCloudNode> nodes;
+        uint32_t maxNodePoints;
+
+        uint32_t build(size_t first, size_t count, const float (&center)[3], float half, uint32_t level)
+        {
+            const uint32_t index = (uint32_t)nodes.size();
+            PointCloudNode n;
+            memset(&n, 0, sizeof(n));
+            memcpy(n.center, center, sizeof(n.center));
+            n.halfSize   = half;
+            n.level      = level;
+            n.firstPoint = first;
+            const bool leaf = count <= maxNodePoints || level + 1 >= MaxOctreeLevels;
+            n.numPoints = leaf ? (uint32_t)count : maxNodePoints;
+            n.spacing   = 2.0f * half / sqrtf((float)maxNodePoints); // scans are mostly surfaces
+            nodes.push_back(n);
+            if (leaf)
+                return index;
+
+            // stable counting sort of the remaining points into octants keeps them shuffled
+            const size_t rest = first + n.numPoints;
+            const size_t restCount = count - n.numPoints;
+            auto octant = [&](const Vertex3ColorPacked& p) {
+                return (p.x >= center[0] ? 1 : 0) | (p.y >= center[1] ? 2 : 0) | (p.z >= center[2] ? 4 : 0);
+            };
+            size_t counts[8] = {}, offsets[8];
+            for (size_t i = rest; i < rest + restCount; ++i)
+                ++counts[octant(points[i])];
+            offsets[0] = 0;
+            for (int o = 1; o < 8; ++o)
+                offsets[o] = offsets[o-1] + counts[o-1];
+            for (size_t i = rest; i < rest + restCount; ++i)
+                scratch[offsets[octant(points[i])]++] = points[i];
+            std::copy(scratch.begin(), scratch.begin() + restCount, points.begin() + rest);
+
+            size_t childFirst = rest;
+            for (int o = 0; o < 8; ++o)
+            {
+                if (counts[o] == 0)
+                    continue;
+                const float q = half * 0.5f;
+                const float childCenter[3] = {
+                    center[0] + (o & 1 ? q : -q),
+                    center[1] + (o & 2 ? q : -q),
+                    center[2] + (o & 4 ? q : -q),
+                };
+                const uint32_t child = build(childFirst, counts[o], childCenter, q, level + 1);
+                nodes[index].children[o] = child;
+                childFirst += counts[o];
+            }
+            return index;
+        }
+    };
+
+    static uint64_t alignUp(uint64_t offset)
+    {
+        return (offset + MeshFileAlignment - 1) & ~uint64_t(MeshFileAlignment - 1);
+    }
+
+    // rpp::file::write takes an int length, so large blobs are written in pieces
+    static bool writeAll(rpp::file& f, const void* data, uint64_t size)
+    {
+        constexpr uint64_t maxWrite = 64 * 1024 * 1024;
+        for (const uint8_t* p = (const uint8_t*)data; size > 0; )
+        {
+            const int n = (int)std::min(size, maxWrite);
+            if (f.write(p, n) != n)
+                return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool PointCloudFile::build(const string& path, const Vertex3ColorPacked* points, size_t numPoints,
+                               int maxNodePoints)
+    {
+        if (numPoints == 0 || maxNodePoints <= 0) {
+            LogWarning("PointCloudFile::build %s: no points", path.c_str());
+            return false;
+        }
+
+        vector<Vertex3ColorPacked> shuffled { points, points + numPoints };
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64{ 0x5EED });
+
+        PointCloudHeader h;
+        memset(&h, 0, sizeof(h));
+        for (int d = 0; d < 3; ++d) {
+            h.boundsMin[d] = +1e30f;
+            h.boundsMax[d] = -1e30f;
+        }
+        for (const Vertex3ColorPacked& p : shuffled)
+        {
+            const float* xyz = &p.x;
+            for (int d = 0; d < 3; ++d) {
+                if (xyz[d] < h.boundsMin[d]) h.boundsMin[d] = xyz[d];
+                if (xyz[d] > h.boundsMax[d]) h.boundsMax[d] = xyz[d];
+            }
+        }
+
+        // the octree root is a cube around the bounds
+        float center[3], half = 0.0f;
+        for (int d = 0; d < 3; ++d) {
+            center[d] = (h.boundsMin[d] + h.boundsMax[d]) * 0.5f;
+            half = std::max(half, (h.boundsMax[d] - h.boundsMin[d]) * 0.5f);
+        }
+        half = half * 1.001f + 1e-6f;
+
+        OctreeBuilder builder { shuffled, {}, {}, (uint32_t)maxNodePoints };
+        builder.scratch.resize(numPoints);
+        builder.build(0, numPoints, center, half, 0);
+        builder.scratch = {};
+
+        h.magic         = PointCloudHeader::Magic;
+        h.version       = PointCloudHeader::Version;
+        h.numNodes      = (uint32_t)builder.nodes.size();
+        h.maxNodePoints = (uint32_t)maxNodePoints;
+        h.numPoints     = numPoints;
+        h.nodesOffset   = alignUp(sizeof(PointCloudHeader));
+        h.pointsOffset  = alignUp(h.nodesOffset + builder.nodes.size() * sizeof(PointCloudNode));
+
+        rpp::file f { path, rpp::CREATENEW };
+        if (!f) {
+            LogWarning("PointCloudFile::build %s: failed to create file", path.c_str());
+            return false;
+        }
+        static const uint8_t zeros[MeshFileAlignment] = {};
+        const uint64_t nodesEnd = h.nodesOffset + builder.nodes.size() * sizeof(PointCloudNode);
+        return writeAll(f, &h, sizeof(h))
+            && writeAll(f, zeros, h.nodesOffset - sizeof(h))
+            && writeAll(f, builder.nodes.data(), builder.nodes.size() * sizeof(PointCloudNode))
+            && writeAll(f, zeros, h.pointsOffset - nodesEnd)
+            && writeAll(f, shuffled.data(), numPoints * sizeof(Vertex3ColorPacked));
+    }
+
+    bool PointCloudFile::open(const string& path)
+    {
+        if (!Map.open(path))
+            return false;
+
+        const PointCloudHeader& h = header();
+        bool valid = Map.size() >= sizeof(PointCloudHeader)
+            && h.magic == PointCloudHeader::Magic && h.version == PointCloudHeader::Version
+            && h.numNodes > 0
+            && h.nodesOffset <= Map.size() && h.pointsOffset <= Map.size()
+            && uint64_t(h.numNodes) * sizeof(PointCloudNode) <= Map.size() - h.nodesOffset
+            && h.numPoints <= (Map.size() - h.pointsOffset) / sizeof(Vertex3ColorPacked);
+        for (uint32_t i = 0; valid && i < h.numNodes; ++i)
+        {
+            const PointCloudNode& n = node(i);
+            valid = n.firstPoint <= h.numPoints && n.numPoints <= h.numPoints - n.firstPoint;
+            // build() writes nodes depth first, so children always come after their parent,
+            // which also rules out cycles that would hang the traversal
+            for (uint32_t child : n.children)
+                if (child != 0 && (child <= i || child >= h.numNodes)) valid = false;
+        }
+        if (!valid) {
+            LogWarning("PointCloudFile %s: not a valid .aglpoints v%d file", path.c_str(), PointCloudHeader::Version);
+            Map.close();
+        }
+        return valid;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    PointCloud::PointCloud(GLCore& core, SceneNode* parent, string name, int typeFlags)
+        : SceneNode(core, parent, move(name), typeFlags|NodeType)
+    {
+    }
+
+    PointCloud::~PointCloud()
+    {
+        Close();
+    }
+
+    bool PointCloud::Open(const string& path)
+    {
+        Close();
+        if (!Cloud.open(path))
+            return false;
+        Nodes.reset(new NodeState[Cloud.numNodes()]);
+        Exit = false;
+        Loader = std::thread{ [this] { LoaderThread(); } };
+        return true;
+    }
+
+    void PointCloud::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock { Mutex };
+            Exit = true;
+            LoadQueue.clear();
+        }
+        Wake.notify_all();
+        if (Loader.joinable())
+            Loader.join();
+
+        Loaded.clear();
+        Loading = -1;
+        Nodes.reset();
+        Cloud.close();
+        ResidentPoints = 0;
+        ResidentNodes  = 0;
+        FrameStats = {};
+    }
+
+    void PointCloud::LoaderThread()
+    {
+        for (;;)
+        {
+            int node;
+            {
+                std::unique_lock<std::mutex> lock { Mutex };
+                Wake.wait(lock, [this] { return Exit || !LoadQueue.empty(); });
+                if (Exit)
+                    return;
+                node = Loading = LoadQueue.back();
+                LoadQueue.pop_back();
+            }
+
+            // page faults of the mapping happen here instead of on the render thread
+            const PointCloudNode& n = Cloud.node(node);
+            const Vertex3ColorPacked* points = Cloud.points(n);
+            LoadedChunk chunk { node, { points, points + n.numPoints } };
+
+            std::lock_guard<std::mutex> lock { Mutex };
+            Loaded.push_back(std::move(chunk));
+            Loading = -1;
+        }
+    }
+
+    void PointCloud::UploadLoaded()
+    {
+        vector<LoadedChunk> chunks;
+        {
+            std::lock_guard<std::mutex> lock { Mutex };
+            const int count = std::min((int)Loaded.size(), MaxUploadsPerFrame);
+            std::move(Loaded.begin(), Loaded.begin() + count, std::back_inserter(chunks));
+            Loaded.erase(Loaded.begin(), Loaded.begin() + count);
+        }
+        for (LoadedChunk& chunk : chunks)
+        {
+            NodeState& state = Nodes[chunk.Node];
+            if (state.Points)
+                continue;
+            state.Points.create(DrawPoints, chunk.Points);
+            state.LastUsed = FrameNumber;
+            ResidentPoints += (int64_t)chunk.Points.size();
+            ++ResidentNodes;
+        }
+    }
+
+    // view frustum planes and LOD scale factors of a column-major model-view-projection
+    struct OctreeView
+    {
+        float planes[6][4];
+        float depthRow[4];   // clip space w row, the view depth
+        float pixelsPerUnit; // screen pixels per model unit at view depth 1
+        float depthScale;    // model units to view depth units
+
+        OctreeView(const Matrix4& mvp, int screenHeight)
+        {
+            const float* m = mvp.m;
+            auto plane = [m](int row, float sign, float (&p)[4]) {
+                for (int c = 0; c < 4; ++c)
+                    p[c] = m[c*4 + 3] + sign * m[c*4 + row];
+                const float len = sqrtf(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+                if (len > 0.0f)
+                    for (float& f : p) f /= len;
+            };
+            plane(0, +1.0f, planes[0]); // left
+            plane(0, -1.0f, planes[1]); // right
+            plane(1, +1.0f, planes[2]); // bottom
+            plane(1, -1.0f, planes[3]); // top
+            plane(2, +1.0f, planes[4]); // near
+            plane(2, -1.0f, planes[5]); // far
+            for (int c = 0; c < 4; ++c)
+                depthRow[c] = m[c*4 + 3];
+            pixelsPerUnit = sqrtf(m[1]*m[1] + m[5]*m[5] + m[9]*m[9]) * 0.5f * (float)screenHeight;
+            depthScale    = sqrtf(m[3]*m[3] + m[7]*m[7] + m[11]*m[11]);
+        }
+
+        bool visible(const PointCloudNode& n) const
+        {
+            const float radius = n.halfSize * 1.7320508f;
+            for (const float (&p)[4] : planes)
+                if (p[0]*n.center[0] + p[1]*n.center[1] + p[2]*n.center[2] + p[3] < -radius)
+                    return false;
+            return true;
+        }
+
+        // point spacing of the node projected to pixels at the nearest point of its bounding sphere
+        float projectedSpacing(const PointCloudNode& n) const
+        {
+            const float* w = depthRow;
+            const float depth = w[0]*n.center[0] + w[1]*n.center[1] + w[2]*n.center[2] + w[3]
+                              - n.halfSize * 1.7320508f * depthScale;
+            if (depth <= 1e-4f)
+                return 1e30f; // camera is inside the node
+            return n.spacing * pixelsPerUnit / depth;
+        }
+    };
+
+    void PointCloud::SelectNodes(const Matrix4& modelViewProjection, vector<int>& missing)
+    {
+        struct Candidate
+        {
+            float priority; // projected point spacing in pixels
+            int node;
+            bool operator<(const Candidate& c) const { return priority < c.priority; }
+        };
+
+        const OctreeView view { modelViewProjection, Core.ContextHeight() };
+        vector<Candidate> heap;
+        Selected.clear();
+
+        const PointCloudNode& root = Cloud.node(0);
+        if (view.visible(root))
+            heap.push_back({ view.projectedSpacing(root), 0 });
+
+        int64_t numPoints = 0;
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            const Candidate c = heap.back();
+            heap.pop_back();
+
+            const PointCloudNode& n = Cloud.node(c.node);
+            if (numPoints + n.numPoints > PointBudget && !Selected.empty())
+                break; // everything left in the heap has a smaller projected spacing
+            numPoints += n.numPoints;
+            Selected.push_back(c.node);
+
+            NodeState& state = Nodes[c.node];
+            if (state.Points) state.LastUsed = FrameNumber;
+            else              missing.push_back(c.node);
+
+            if (c.priority <= MaxScreenError)
+                continue;
+            for (uint32_t child : n.children)
+            {
+                if (child == 0) continue;
+                const PointCloudNode& cn = Cloud.node(child);
+                if (view.visible(cn)) {
+                    heap.push_back({ view.projectedSpacing(cn), (int)child });
+                    std::push_heap(heap.begin(), heap.end());
+                }
+            }
+        }
+    }
+
+    void PointCloud::EvictUnused()
+    {
+        if (ResidentPoints <= GpuPointBudget)
+            return;
+
+        vector<int> unused;
+        for (int i = 0; i < Cloud.numNodes(); ++i)
+            if (Nodes[i].Points && Nodes[i].LastUsed != FrameNumber)
+                unused.push_back(i);
+        std::sort(unused.begin(), unused.end(), [this](int a, int b) {
+            return Nodes[a].LastUsed < Nodes[b].LastUsed;
+        });
+
+        for (int i : unused)
+        {
+            if (ResidentPoints <= GpuPointBudget)
+                break;
+            ResidentPoints -= Cloud.node(i).numPoints;
+            --ResidentNodes;
+            Nodes[i].Points.clear();
+        }
+    }
+
+    void PointCloud::Render(const Matrix4& parentWorld, const Matrix4& viewProjection)
+    {
+        Matrix4 worldTransform = WorldTransform(parentWorld);
+        if (Cloud)
+        {
+            ++FrameNumber;
+            UploadLoaded();
+
+            vector<int> missing;
+            SelectNodes(viewProjection * worldTransform, missing);
+            {
+                std::lock_guard<std::mutex> lock { Mutex };
+                LoadQueue.clear();
+                for (auto it = missing.rbegin(); it != missing.rend(); ++it) // highest priority last
+                {
+                    const int node = *it;
+                    bool inFlight = node == Loading;
+                    for (const LoadedChunk& chunk : Loaded)
+                        inFlight |= chunk.Node == node;
+                    if (!inFlight)
+                        LoadQueue.push_back(node);
+                }
+                FrameStats.pendingLoads = (int)(LoadQueue.size() + Loaded.size()) + (Loading != -1 ? 1 : 0);
+            }
+            if (!missing.empty())
+                Wake.notify_one();
+
+            FrameStats.visibleNodes   = (int)Selected.size();
+            FrameStats.renderedNodes  = 0;
+            FrameStats.renderedPoints = 0;
+
+            Shader& shader = *Core.SceneShaders().variant(sf_AlphaTest | sf_VertexColor);
+            shader.bind();
+            if (shader.activeBlock(ub_ObjectData))
+                Core.BindObjectUniforms(worldTransform);
+            else
+                shader.bind(u_Transform, viewProjection * worldTransform);
+            shader.bind(u_DiffuseColor, Color::White());
+            glPointSize(PointSize);
+            for (int node : Selected)
+            {
+                const VertexBuffer& points = Nodes[node].Points;
+                if (!points) continue;
+                points.draw();
+                ++FrameStats.renderedNodes;
+                FrameStats.renderedPoints += Cloud.node(node).numPoints;
+            }
+
+            EvictUnused();
+            FrameStats.residentNodes  = ResidentNodes;
+            FrameStats.residentPoints = ResidentPoints;
+        }
+
+        for (int i = 0; i < (int)ChildNodes.size(); ++i)
+            ChildNodes[i]->Render(worldTransform, viewProjection);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include "SceneNode.h"
+#include "MeshFile.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Header of an .aglpoints file, followed by the PointCloudNode table and the points.
+     * Every octree node owns a contiguous chunk of Vertex3ColorPacked points, which is a
+     * uniform subsample of its subtree, so drawing a node and all its ancestors gives
+     * the full density of that region (additive LOD).
+     */
+    struct PointCloudHeader
+    {
+        static constexpr uint32_t Magic   = 0x43504741; // "AGPC"
+        static constexpr uint32_t Version = 1;
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t numNodes;
+        uint32_t maxNodePoints;
+        uint64_t numPoints;
+        uint64_t nodesOffset;   // byte offset of the node table
+        uint64_t pointsOffset;  // byte offset of the point chunks
+        float    boundsMin[3];
+        float    boundsMax[3];
+    };
+
+    struct PointCloudNode
+    {
+        float    center[3];
+        float    halfSize;    // half of the node cube edge
+        float    spacing;     // average distance between the points of this node
+        uint32_t level;
+        uint32_t children[8]; // node indices, 0 if there is no child (the root is never a child)
+        uint64_t firstPoint;
+        uint32_t numPoints;
+        uint32_t reserved;
+    };
+
+
+    /** @brief Memory mapped .aglpoints octree */
+    class AGL_API PointCloudFile
+    {
+        MappedFile Map;
+
+    public:
+        /**
+         * Maps the file and validates the node table
+         * @return FALSE if the file can't be mapped or is not a valid .aglpoints
+         */
+        bool open(const string& path);
+        void close() { Map.close(); }
+
+        bool good() const { return Map.good(); }
+        explicit operator bool() const { return Map.good(); }
+
+        const PointCloudHeader& header() const { return *(const PointCloudHeader*)Map.data(); }
+        int numNodes() const { return (int)header().numNodes; }
+        const PointCloudNode& node(int i) const
+        {
+            return ((const PointCloudNode*)(Map.data() + header().nodesOffset))[i];
+        }
+        const Vertex3ColorPacked* points(const PointCloudNode& n) const
+        {
+            return (const Vertex3ColorPacked*)(Map.data() + header().pointsOffset) + n.firstPoint;
+        }
+
+        /**
+         * Builds an .aglpoints octree from an in-memory point cloud. Nodes with more than
+         * `maxNodePoints` points keep a random subsample of that size and split the rest into octants.
+         * For datasets that don't fit in memory, build one file per tile
+         */
+        static bool build(const string& path, const Vertex3ColorPacked* points, size_t numPoints,
+                          int maxNodePoints = 20000);
+        static bool build(const string& path, const vector<Vertex3ColorPacked>& points,
+                          int maxNodePoints = 20000)
+        {
+            return build(path, points.data(), points.size(), maxNodePoints);
+        }
+    };
+
+
+    struct PointCloudStats
+    {
+        int visibleNodes   = 0; // nodes selected this frame
+        int renderedNodes  = 0; // selected nodes that were resident and drawn
+        int residentNodes  = 0;
+        int pendingLoads   = 0;
+        int64_t renderedPoints = 0;
+        int64_t residentPoints = 0;
+    };
+
+
+    /**
+     * Out-of-core point cloud scene node. Each frame the octree of an .aglpoints file is
+     * traversed in order of projected node size: nodes outside the view frustum are skipped,
+     * and nodes are refined until their point spacing is below MaxScreenError pixels
+     * or PointBudget is reached. Missing nodes are read on a background thread and
+     * uploaded as DrawPoints buffers, least recently used nodes are evicted past GpuPointBudget.
+     *
+     * @code
+     *     auto* cloud = scene->CreateNode<PointCloud>("scan");
+     *     cloud->Open("scans/city.aglpoints");
+     * @endcode
+     */
+    class AGL_API PointCloud : public SceneNode
+    {
+    public:
+        static constexpr SceneNodeType NodeType = SN_PointCloud;
+
+        int64_t PointBudget    = 5'000'000;  // max points drawn per frame
+        int64_t GpuPointBudget = 20'000'000; // max resident points before eviction
+        float MaxScreenError   = 2.0f;       // target point spacing in pixels
+        float PointSize        = 2.0f;       // glPointSize of the drawn points
+        int MaxUploadsPerFrame = 8;          // loaded nodes uploaded per frame
+
+        PointCloud(GLCore& core, SceneNode* parent, string name, int typeFlags = 0);
+        ~PointCloud();
+
+        /** @return FALSE if the file is not a valid .aglpoints octree */
+        bool Open(const string& path);
+        void Close();
+
+        const PointCloudFile& File() const { return Cloud; }
+        const PointCloudStats& Stats() const { return FrameStats; }
+
+        void Render(const Matrix4& parentWorld, const Matrix4& viewProjection) override;
+
+    private:
+        struct NodeState
+        {
+            VertexBuffer Points;
+            uint32_t LastUsed = 0; // frame number
+        };
+        struct LoadedChunk
+        {
+            int Node;
+            vector<Vertex3ColorPacked> Points;
+        };
+
+        PointCloudFile Cloud;
+        unique_ptr<NodeState[]> Nodes;
+        uint32_t FrameNumber = 0;
+        int64_t ResidentPoints = 0;
+        int ResidentNodes = 0;
+        PointCloudStats FrameStats;
+        vector<int> Selected; // scratch, nodes selected this frame
+
+        // guarded by Mutex, shared with the loader thread
+        std::thread Loader;
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        vector<int> LoadQueue; // highest priority at the back
+        vector<LoadedChunk> Loaded;
+        int Loading = -1;
+        bool Exit = false;
+
+        void LoaderThread();
+        void UploadLoaded();
+        void SelectNodes(const Matrix4& modelViewProjection, vector<int>& missing);
+        void EvictUnused();
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -54,6 +54,15 @@ namespace AGL
         return actor;
     }
 
+    Actor* SceneNode::CreateActor(string name, AGL::VertexBuffer&& mesh, const AGL::TextureHandle& texture)
+    {
+        auto actor = CreateNode<Actor>(name);
+        actor->Mesh = std::move(mesh);
+        actor->Mat.texture = texture.get();
+        actor->SharedTexture = texture;
+        return actor;
+    }
+
     Actor* SceneNode::FindActor(const string& name) const
     {
         return FindActor<Actor>(name);
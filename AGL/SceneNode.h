@@ -10,10 +10,11 @@ namespace AGL
 
     enum SceneNodeType : int
     {
-        SN_None     = 0,
-        SN_Actor    = (1<<0),
-        SN_RootNode = (1<<1),
-        SN_Camera   = (1<<2),
+        SN_None       = 0,
+        SN_Actor      = (1<<0),
+        SN_RootNode   = (1<<1),
+        SN_Camera     = (1<<2),
+        SN_PointCloud = (1<<3),
     };
 
     class SceneNode;
@@ -83,6 +84,7 @@ namespace AGL
         class Actor* CreateActor(string name, AGL::VertexBuffer&& mesh, Color color);
         class Actor* CreateActor(string name, AGL::VertexBuffer&& mesh, const AGL::Texture& texture);
         class Actor* CreateActor(string name, AGL::VertexBuffer&& mesh, const AGL::Texture* texture);
+        class Actor* CreateActor(string name, AGL::VertexBuffer&& mesh, const AGL::TextureHandle& texture);
 
         class Actor* FindActor(const string& name) const;
 
@@ -25,14 +25,19 @@ namespace AGL
     void SceneRoot::Render(const Matrix4& parentWorld, const Matrix4& viewProjection)
     {
         Core.Clear(BackgroundColor);
+        BatchRenderer& batches = Core.Batches();
+        const bool batching = batches.begin(Core.Meshes()); // actors queue arena meshes instead of drawing
         for (SceneNodeRef& node : ChildNodes)
             node->Render(parentWorld, viewProjection);
+        if (batching)
+            batches.flush();
         Core.SwapBuffers();
     }
 
     void SceneRoot::Render()
     {
         Camera->UpdateViewProjection();
+        Core.BindFrameUniforms(*Camera);
         Render(Matrix4::Identity(), Camera->ViewProjection);
     }
 
@@ -2,6 +2,11 @@
 #include "OpenGL.h"
 #include <rpp/file_io.h>
 #include "DefaultShaders.h"
+#include "Hash.h"
+#include "GLState.h"
+#include "UniformBuffer.h"
+#include "MeshArena.h"
+#include <algorithm>
 
 namespace AGL
 {
@@ -13,21 +18,32 @@ namespace AGL
 
     VertexDescr::VertexDescr(int sizeOf, ShaderAttr attr0, int size0, ...) noexcept : sizeOf{sizeOf}
     {
+        memset(items, 0, sizeof(items)); // clear other attributes for accurate memcmp
         items[0].attr = (uint8_t)attr0;
         items[0].size = (uint8_t)size0;
         va_list ap;	va_start(ap, size0);
 
         int offset = size0 * sizeof(float);
-        int i = 1;
-        for (; offset < sizeOf && i < 4; ++i) 
+        for (int i = 1; offset < sizeOf && i < 4; ++i) 
         {
             items[i].attr = va_arg(ap, int);         // attrib location
             items[i].size = va_arg(ap, int);         // attrib size in floats
             offset += items[i].size * sizeof(float); // offset is in bytes
         }
-        for (; i < 4; ++i) { // clear other attributes for accurate memcmp
-            items[i].attr = 0;
-            items[i].size = 0;
+        va_end(ap);
+    #ifdef DEBUG
+        validate(); // ensure this descriptor is actually valid
+    #endif
+    }
+
+    VertexDescr::VertexDescr(int sizeOf, std::initializer_list<VertexDescrElem> elems) noexcept : sizeOf{sizeOf}
+    {
+        memset(items, 0, sizeof(items)); // clear other attributes for accurate memcmp
+        int i = 0;
+        for (const VertexDescrElem& e : elems)
+        {
+            if (i == 4) break;
+            items[i++] = e;
         }
     #ifdef DEBUG
         validate(); // ensure this descriptor is actually valid
@@ -40,12 +56,15 @@ namespace AGL
         for (int i = 0; offset < sizeOf && i < 4; ++i) 
         {
             ShaderAttr a = (ShaderAttr)items[i].attr; // attrib location
-            const int  s = (const int) items[i].size; // attrib size in floats
+            const int  s = (const int) items[i].size; // attrib size in components
+            const int  t = (int) items[i].type; // component VertexType
             Assert(0 <= a && a < a_MaxAttributes, "Invalid attr: check vertex_descr!");
             Assert(1 <= s && s <= 4, "Invalid attr size: check vertex_descr!");
-            Assert(s <= (sizeOf - offset)/(int)sizeof(float), "Invalid layout: vertex_descr sizeOf doesn't match total attr sizes!");
-            offset += s * sizeof(float); // offset is in bytes
-            (void)a;
+            Assert(t <= vt_Int1010102, "Invalid attr type: check vertex_descr!");
+            Assert(t != vt_Int1010102 || s == 4, "Invalid attr size: vt_Int1010102 requires size 4!");
+            Assert(items[i].bytes() <= (sizeOf - offset), "Invalid layout: vertex_descr sizeOf doesn't match total attr sizes!");
+            offset += items[i].bytes(); // offset is in bytes
+            (void)a; (void)t;
         }
         Assert(offset == sizeOf, "Invalid layout: end offset does not match vertex_descr sizeOf!");
     }
@@ -55,6 +74,34 @@ namespace AGL
         memset(this, 0, sizeof(*this));
     }
 
+    void VertexDescr::enableAttribs(uintptr_t offset, uint32_t divisor) const
+    {
+        // map VertexType to GL component types
+        static constexpr GLenum typeMap[] = {
+            GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE, GL_SHORT, GL_UNSIGNED_SHORT, GL_INT_2_10_10_10_REV,
+        };
+        for (int i = 0, off = 0; off < sizeOf; ++i)
+        {
+            const VertexDescrElem& e = items[i];
+            ShaderAttr a = (ShaderAttr)e.attr; // attrib location
+            glEnableVertexAttribArray(a);
+            glVertexAttribPointer(a, e.size, typeMap[e.type], e.norm ? GL_TRUE : GL_FALSE,
+                                  sizeOf, (void*)(offset + off));
+            if (divisor) glVertexAttribDivisor(a, divisor);
+            off += e.bytes(); // offset is in bytes
+        }
+    }
+
+    void VertexDescr::disableAttribs(uint32_t divisor) const
+    {
+        for (int i = 0, off = 0; off < sizeOf; ++i)
+        {
+            glDisableVertexAttribArray((ShaderAttr)items[i].attr);
+            if (divisor) glVertexAttribDivisor((ShaderAttr)items[i].attr, 0);
+            off += items[i].bytes(); // offset is in bytes
+        }
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
 
     VertexBuffer::VertexBuffer() noexcept
@@ -68,110 +115,286 @@ namespace AGL
     // EMSCRIPTEN does not support VertexArrayObjects;
     void VertexBuffer::enableAttribs()
     {
-        for (int i = 0, off = 0; off < layout.sizeOf; ++i)
-        {
-            ShaderAttr a = (ShaderAttr)layout.items[i].attr; // attrib location
-            const int  s = (const int) layout.items[i].size; // attrib size in floats
-            glEnableVertexAttribArray(a);
-            glVertexAttribPointer(a, s, GL_FLOAT, 0, layout.sizeOf, (void*)uintptr_t(off));
-            off += s * sizeof(float); // offset is in bytes
-        }
+        layout.enableAttribs();
     }
 
     void VertexBuffer::disableAttribs()
     {
-        for (int i = 0, off = 0; off < layout.sizeOf; ++i)
+        layout.disableAttribs();
+    }
+
+    static constexpr GLenum usageMap[] = { GL_STATIC_DRAW, GL_DYNAMIC_DRAW, GL_STREAM_DRAW };
+
+    // uploads `data` to the start of the buffer, (re)allocating its storage if needed
+    static void uploadBuffer(GLenum target, uint32_t& buffer, int32_t& capacity,
+                             const void* data, int numBytes, BufferUsage usage)
+    {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+
+        if (usage == UsageStatic) // exact size, no spare capacity for static meshes
         {
-            ShaderAttr a = (ShaderAttr)layout.items[i].attr; // attrib location
-            const int  s = (const int)layout.items[i].size; // attrib size in floats
-            glDisableVertexAttribArray(a);
-            off += s * sizeof(float); // offset is in bytes
+            glBufferData(target, numBytes, data, GL_STATIC_DRAW);
+            capacity = numBytes;
+            return;
         }
+        if (numBytes > capacity)
+            capacity = std::max(numBytes, capacity + capacity / 2); // grow geometrically
+
+        // orphan the old storage, so we don't wait for draws that are still reading it
+        glBufferData(target, capacity, nullptr, usageMap[usage]);
+        glBufferSubData(target, 0, numBytes, data);
     }
 
-    void VertexBuffer::create(const void*    verts,   int numVerts,
+    void VertexBuffer::upload(DrawMode mode, const void* verts, int numVerts,
                               const index_t* indices, int numIndices,
-                              const VertexDescr& layout)
+                              const VertexDescr& newLayout, BufferUsage usage,
+                              int rawIndexBytes)
     {
-        drawMode     = DrawIndexed;
-        vertexCount  = numVerts;
-        indexCount   = numIndices;
-        this->layout = layout;
+        if (arena) // update() of an arena mesh stays in the arena
+        {
+            if (numVerts == vertexCount && numIndices == indexCount && layout == newLayout) {
+                arena->write(arenaSlot, verts, indices);
+                drawMode = mode;
+            }
+            else {
+                MeshArena& meshArena = *arena;
+                clear();
+                uploadToArena(meshArena, mode, verts, numVerts, indices, numIndices, newLayout);
+            }
+            return;
+        }
+
+        GLState& state = GLState::current();
+        const bool newVAO = vertexArray == 0;
+        if (newVAO)
+            glGenVertexArrays(1, &vertexArray);
+        state.bindVertexArray(vertexArray);
+
+        indexSize = 0;
+        if (numIndices > 0) // element buffer binding is part of the VAO state
+        {
+            if (rawIndexBytes) // already in GPU format
+            {
+                indexSize = rawIndexBytes;
+                uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, indexCapacity,
+                             indices, numIndices*indexSize, usage);
+            }
+            else if (numVerts <= MaxShortIndexVertices) // halves index memory and fetch bandwidth
+            {
+                thread_local vector<uint16_t> shortIndices;
+                shortIndices.resize(numIndices);
+                uint16_t* dst = shortIndices.data();
+                for (int i = 0; i < numIndices; ++i)
+                    dst[i] = (uint16_t)indices[i];
+                indexSize = sizeof(uint16_t);
+                uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, indexCapacity,
+                             dst, numIndices*indexSize, usage);
+            }
+            else
+            {
+                indexSize = sizeof(index_t);
+                uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, indexCapacity,
+                             indices, numIndices*indexSize, usage);
+            }
+        }
+        uploadBuffer(GL_ARRAY_BUFFER, vertexBuffer, vertexCapacity,
+                     verts, numVerts*newLayout.sizeOf, usage);
+
+        // attrib pointers refer to the buffer object, so they survive re-specifying its storage
+        if (newVAO || !(layout == newLayout))
+        {
+            if (!newVAO) disableAttribs();
+            layout = newLayout;
+            enableAttribs();
+        }
 
-        if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
-        glGenVertexArrays(1, &vertexArray);
-        glBindVertexArray(vertexArray);
+        state.bindVertexArray(0);
+        drawMode    = mode;
+        vertexCount = numVerts;
+        indexCount  = numIndices;
+    }
+
+    void VertexBuffer::uploadToArena(MeshArena& meshArena, DrawMode mode, const void* verts, int numVerts,
+                                     const index_t* indices, int numIndices, const VertexDescr& newLayout)
+    {
+        arenaSlot = meshArena.allocate(verts, numVerts, indices, numIndices, newLayout);
+        if (arenaSlot == -1)
+            return;
+        arena       = &meshArena;
+        drawMode    = mode;
+        vertexCount = numVerts;
+        indexCount  = numIndices;
+        indexSize   = sizeof(index_t);
+        layout      = newLayout;
+    }
 
-        // create and fill index buffer
-        uint32_t indexBuf;
-        glGenBuffers(1, &indexBuf);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuf);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices*sizeof(index_t), indices, GL_STATIC_DRAW);
+    void VertexBuffer::create(MeshArena& meshArena, const void* verts, int numVerts,
+                              const index_t* indices, int numIndices, const VertexDescr& layout)
+    {
+        if (!MeshArena::supported()) {
+            create(verts, numVerts, indices, numIndices, layout);
+            return;
+        }
+        clear();
+        uploadToArena(meshArena, DrawIndexed, verts, numVerts, indices, numIndices, layout);
+    }
 
-        // create & fill vertex buffer
-        uint32_t vertexBuf;
-        glGenBuffers(1, &vertexBuf);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuf);
-        glBufferData(GL_ARRAY_BUFFER, numVerts*layout.sizeOf, verts, GL_STATIC_DRAW);
+    void VertexBuffer::create(MeshArena& meshArena, DrawMode mode, const void* verts, int numVerts,
+                              const VertexDescr& layout)
+    {
+        if (!MeshArena::supported()) {
+            create(mode, verts, numVerts, layout);
+            return;
+        }
+        clear();
+        uploadToArena(meshArena, mode, verts, numVerts, nullptr, 0, layout);
+    }
 
-        enableAttribs();
+    void VertexBuffer::create(const void*    verts,   int numVerts,
+                              const index_t* indices, int numIndices,
+                              const VertexDescr& layout)
+    {
+        if (arena) clear(); // move out of the arena
+        upload(DrawIndexed, verts, numVerts, indices, numIndices, layout, UsageStatic);
+    }
 
-        glBindVertexArray(0);
-        glDeleteBuffers(1, &vertexBuf);
-        glDeleteBuffers(1, &indexBuf);
+    void VertexBuffer::create(const void* verts,   int numVerts,
+                              const void* indices, int numIndices, int indexBytes,
+                              const VertexDescr& layout)
+    {
+        if (indexBytes != 2 && indexBytes != 4) {
+            LogError("VertexBuffer::create failed: invalid index size %d", indexBytes);
+            return;
+        }
+        if (arena) clear(); // move out of the arena
+        upload(DrawIndexed, verts, numVerts, (const index_t*)indices, numIndices, layout, UsageStatic, indexBytes);
     }
 
     void VertexBuffer::create(DrawMode mode, const void* verts, 
                               int numVerts, const VertexDescr& layout)
     {
-        drawMode     = mode;
-        vertexCount  = numVerts;
-        indexCount   = 0;
-        this->layout = layout;
+        if (arena) clear(); // move out of the arena
+        upload(mode, verts, numVerts, nullptr, 0, layout, UsageStatic);
+    }
+
+    void VertexBuffer::update(const void*    verts,   int numVerts,
+                              const index_t* indices, int numIndices,
+                              const VertexDescr& layout, BufferUsage usage)
+    {
+        upload(DrawIndexed, verts, numVerts, indices, numIndices, layout, usage);
+    }
 
-        if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
-        glGenVertexArrays(1, &vertexArray);
-        glBindVertexArray(vertexArray);
+    void VertexBuffer::update(DrawMode mode, const void* verts, int numVerts,
+                              const VertexDescr& layout, BufferUsage usage)
+    {
+        upload(mode, verts, numVerts, nullptr, 0, layout, usage);
+    }
 
-        // create & fill vertex buffer
-        uint32_t vertexBuf;
-        glGenBuffers(1, &vertexBuf);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuf);
-        glBufferData(GL_ARRAY_BUFFER, numVerts*layout.sizeOf, verts, GL_STATIC_DRAW);
+    bool VertexBuffer::instancingSupported()
+    {
+        // core entry points only, ARB_instanced_arrays alone has glVertexAttribDivisorARB
+        // and the instanced draws would also need ARB_draw_instanced
+        return GLEW_VERSION_3_3;
+    }
 
-        enableAttribs();
+    void VertexBuffer::setInstances(const void* instances, int numInstances,
+                                    const VertexDescr& newLayout, BufferUsage usage)
+    {
+        if (!vertexArray) {
+            LogError("VertexBuffer::setInstances failed: mesh must be created first, outside of a MeshArena");
+            return;
+        }
+        GLState& state = GLState::current();
+        state.bindVertexArray(vertexArray);
 
-        glBindVertexArray(0);
-        glDeleteBuffers(1, &vertexBuf);
+        if (numInstances > 0)
+        {
+            uploadBuffer(GL_ARRAY_BUFFER, instanceBuffer, instanceCapacity,
+                         instances, numInstances*newLayout.sizeOf, usage);
+            if (!(instanceLayout == newLayout))
+            {
+                if (instanceLayout.sizeOf) instanceLayout.disableAttribs(1);
+                instanceLayout = newLayout;
+                instanceLayout.enableAttribs(0, 1);
+            }
+        }
+        else if (instanceLayout.sizeOf)
+        {
+            instanceLayout.disableAttribs(1);
+            instanceLayout = {};
+        }
+
+        state.bindVertexArray(0);
+        instanceCount = numInstances > 0 ? numInstances : 0;
     }
 
+    // map DrawMode: Triangles,TriangleStrip,Indexed; to OpenGL modes
+    static constexpr GLenum modeMap[] = {
+        GL_NONE, GL_NONE, GL_TRIANGLES, GL_TRIANGLE_STRIP,
+        GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_POINTS,
+    };
+
     void VertexBuffer::draw() const
+    {
+        if (arena)
+        {
+            arena->draw(arenaSlot, drawMode);
+            return;
+        }
+        if (instanceCount > 0)
+        {
+            drawInstanced(instanceCount);
+            return;
+        }
+        // VAO is left bound, the state tracker will skip rebinding it on the next draw
+        if (drawMode == DrawIndexed)
+        {
+            GLState::current().bindVertexArray(vertexArray);
+            const GLenum type = indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            glDrawElements(GL_TRIANGLES, indexCount, type, nullptr);
+        }
+        else if (drawMode != DrawNone)
+        {
+            GLState::current().bindVertexArray(vertexArray);
+            glDrawArrays(modeMap[drawMode], 0, vertexCount);
+        }
+    }
+
+    void VertexBuffer::drawInstanced(int count) const
     {
         if (drawMode == DrawIndexed)
         {
-            glBindVertexArray(vertexArray);
-            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
+            GLState::current().bindVertexArray(vertexArray);
+            const GLenum type = indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, type, nullptr, count);
         }
         else if (drawMode != DrawNone)
         {
-            // map DrawMode: Triangles,TriangleStrip,Indexed; to OpenGL modes
-            static constexpr GLenum modeMap[] = {
-                GL_NONE, GL_NONE, GL_TRIANGLES, GL_TRIANGLE_STRIP,
-                GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP,
-            };
-            const GLenum mode = modeMap[drawMode];
-            
-            glBindVertexArray(vertexArray);
-            glDrawArrays(mode, 0, vertexCount);
-            glBindVertexArray(0);
+            GLState::current().bindVertexArray(vertexArray);
+            glDrawArraysInstanced(modeMap[drawMode], 0, vertexCount, count);
         }
     }
 
     void VertexBuffer::clear()
     {
-        if (vertexArray) glDeleteVertexArrays(1, &vertexArray), vertexArray = 0;
-        vertexCount = indexCount = 0;
+        if (arena) {
+            arena->free(arenaSlot);
+            arena = nullptr;
+            arenaSlot = -1;
+        }
+        if (vertexArray) {
+            GLState::current().onVertexArrayDeleted(vertexArray);
+            glDeleteVertexArrays(1, &vertexArray), vertexArray = 0;
+        }
+        if (vertexBuffer) glDeleteBuffers(1, &vertexBuffer), vertexBuffer = 0;
+        if (indexBuffer)  glDeleteBuffers(1, &indexBuffer),  indexBuffer  = 0;
+        if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer), instanceBuffer = 0;
+        vertexCapacity = indexCapacity = instanceCapacity = 0;
+        instanceCount = 0;
+        instanceLayout = {};
+        vertexCount = indexCount = indexSize = 0;
         drawMode = DrawNone;
     }
 
@@ -181,7 +404,7 @@ namespace AGL
         {
             if ((ShaderAttr)layout.items[i].attr == shaderAttr)
                 return true;
-            off += layout.items[i].size * sizeof(float); // offset is in bytes
+            off += layout.items[i].bytes(); // offset is in bytes
         }
         return false;
     }
@@ -199,6 +422,10 @@ namespace AGL
         "outlineColor",  // u_OutlineColor
         "shaderData",    // u_ShaderData
     };
+    static const char* BlockMap[ub_MaxBlocks] = {
+        "FrameData",     // ub_FrameData
+        "ObjectData",    // ub_ObjectData
+    };
     static const char* AttributeMap[a_MaxAttributes] = {
         "position",      // a_Position
         "normal",        // a_Normal
@@ -206,14 +433,59 @@ namespace AGL
         "coord2",        // a_Coord2
         "vertex",        // a_Vertex
         "color",         // a_Color
+        "instance",      // a_Instance
+        "instanceColor", // a_InstanceColor
+        "drawId",        // a_DrawId
     };
 
+    // application declared uniforms, @see DeclareUniform()
+    static string DeclaredUniforms[MaxShaderUniforms - u_MaxUniforms];
+    static int    NumDeclared = u_MaxUniforms; // total number of uniform slots in use
+
     static const char* uniform_name(ShaderUniform uniformSlot) {
         if (0 <= uniformSlot && uniformSlot < u_MaxUniforms)
             return UniformMap[uniformSlot];
+        if (u_MaxUniforms <= uniformSlot && uniformSlot < NumDeclared)
+            return DeclaredUniforms[uniformSlot - u_MaxUniforms].c_str();
         return "u_invalid";
     }
 
+    // UniformHash() of every slot name, built-ins are hashed once on first use
+    static uint32_t* uniform_hashes()
+    {
+        static uint32_t hashes[MaxShaderUniforms] = {};
+        static bool builtins = [] {
+            for (int i = 0; i < u_MaxUniforms; ++i)
+                hashes[i] = UniformHash(UniformMap[i]);
+            return true;
+        }();
+        (void)builtins;
+        return hashes;
+    }
+
+    ShaderUniform FindUniform(uint32_t nameHash)
+    {
+        const uint32_t* hashes = uniform_hashes();
+        for (int i = 0; i < NumDeclared; ++i)
+            if (hashes[i] == nameHash)
+                return (ShaderUniform)i;
+        return u_Invalid;
+    }
+
+    ShaderUniform DeclareUniform(const char* name)
+    {
+        ShaderUniform existing = FindUniform(UniformHash(name));
+        if (existing != u_Invalid)
+            return existing;
+        if (NumDeclared >= MaxShaderUniforms) {
+            LogError("DeclareUniform('%s') failed: all %d uniform slots are taken", name, MaxShaderUniforms);
+            return u_Invalid;
+        }
+        DeclaredUniforms[NumDeclared - u_MaxUniforms] = name;
+        uniform_hashes()[NumDeclared] = UniformHash(name);
+        return (ShaderUniform)NumDeclared++;
+    }
+
     static int glProgramInt(GLuint program, GLenum propertyName) {
         int value = 0; glGetProgramiv(program, propertyName, &value); return value;
     }
@@ -234,8 +506,54 @@ namespace AGL
         }
     }
 
-    static GLuint compileShader(const char* sourceStr, int sourceLen, 
-                                const string& sourceName, GLenum type)
+    // GLSL version preamble which is injected in front of every shader source
+    static const char* glslVersionPreamble()
+    {
+        #if __IPHONEOS__ || __EMSCRIPTEN__
+            return "#version 100 // OpenGL ES 1.0\n";
+        #else
+            // get the actual GLSL version:
+            float version = strview{ (char*)glGetString(GL_SHADING_LANGUAGE_VERSION) }.next_float();
+            if (version <= 1.2f) // OpenGL 2.0 and 2.1
+                return "#version 120 // OpenGL 2.1 \n"
+                       "#define highp \n"
+                       "#define lowp  \n";
+            else if (1.3f <= version && version <= 1.5f) // GL 3.0, 3.1, 3.2
+                return "#version 130 // OpenGL 3.0 \n"
+                       "#define highp \n"
+                       "#define lowp  \n";
+            else if (3.3f <= version && version <= 4.2f) // GL 3.3, 4.0, 4.1, 4.2
+                return "#version 330 // OpenGL 3.3 \n"
+                       "#define highp \n"
+                       "#define lowp  \n";
+            else
+                return "#version 120 // OpenGL 2.1 \n";
+        #endif
+    }
+
+    static const char* glslFeaturePreamble()
+    {
+        // shaders can check AGL_UNIFORM_BLOCKS and read FrameData/ObjectData blocks instead of `transform`
+        static const char* features = UniformBuffer::supported()
+            ? "#extension GL_ARB_uniform_buffer_object : enable \n"
+              "#define AGL_UNIFORM_BLOCKS 1 \n"
+            : "";
+        return features;
+    }
+
+    static const char* glslPreamble()
+    {
+        static string preamble;
+        if (preamble.empty())
+        {
+            preamble = glslVersionPreamble();
+            preamble += glslFeaturePreamble();
+        }
+        return preamble.c_str();
+    }
+
+    // submits GLSL source for compilation, does not wait for the result
+    static GLuint submitShader(const char* sourceStr, int sourceLen, strview definitions, GLenum type)
     {
         GLuint shader = glCreateShader(type);
         if (!shader && glCreateShaderObjectARB) {
@@ -248,77 +566,239 @@ namespace AGL
             return 0;
         }
 
-        const char* defines;
-        #if __IPHONEOS__ || __EMSCRIPTEN__
-            defines = "#version 100 // OpenGL ES 1.0\n";
-        #else
-            // get the actual GLSL version:
-            float version = strview{ (char*)glGetString(GL_SHADING_LANGUAGE_VERSION) }.next_float();
-            if (version <= 1.2f) // OpenGL 2.0 and 2.1
-                defines = "#version 120 // OpenGL 2.1 \n"
-                          "#define highp \n"
-                          "#define lowp  \n";
-            else if (1.3f <= version && version <= 1.5f) // GL 3.0, 3.1, 3.2
-                defines = "#version 130 // OpenGL 3.0 \n"
-                          "#define highp \n"
-                          "#define lowp  \n";
-            else if (3.3f <= version && version <= 4.2f) // GL 3.3, 4.0, 4.1, 4.2
-                defines = "#version 330 // OpenGL 3.3 \n"
-                          "#define highp \n"
-                          "#define lowp  \n";
-            else
-                defines = "#version 120 // OpenGL 2.1 \n";
-
-        #endif
-        const int definesLen = (int)strlen(defines);
+        // sources with their own #version line, eg `#version 430` for SSBOs,
+        // keep it and only get the feature defines of the preamble
+        strview source { sourceStr, sourceLen };
+        strview version;
+        const char* preamble = glslPreamble();
+        if (strview body = source; body.trim_start().starts_with("#version"))
+        {
+            version  = body.next('\n');
+            source   = body;
+            preamble = glslFeaturePreamble();
+        }
+        const int preambleLen = (int)strlen(preamble);
+        const int versionLen  = version ? version.len + 1 : 0;
 
         // concatenate the shader for easier debugging in CodeXL
-        int   shaderLen = definesLen + sourceLen;
+        // #version must be the first line, so variant #defines go after the preamble
+        int   shaderLen = versionLen + preambleLen + definitions.len + source.len;
         char* shaderStr = (char*)alloca(shaderLen + 1);
-        memcpy(shaderStr, defines, (size_t)definesLen);
-        memcpy(shaderStr + definesLen, sourceStr, (size_t)sourceLen);
+        char* dst = shaderStr;
+        if (version) {
+            memcpy(dst, version.str, (size_t)version.len);
+            dst[version.len] = '\n';
+            dst += versionLen;
+        }
+        memcpy(dst, preamble, (size_t)preambleLen);                     dst += preambleLen;
+        memcpy(dst, definitions.str, (size_t)definitions.len);           dst += definitions.len;
+        memcpy(dst, source.str, (size_t)source.len);
         shaderStr[shaderLen] = '\0';
 
         glShaderSource(shader, 1, (const char**)&shaderStr, &shaderLen);
         glCompileShader(shader);
+        return shader;
+    }
+
+    // blocks until the shader has compiled, deletes the shader on failure
+    static bool checkShader(GLuint& shader, const string& sourceName)
+    {
+        if (!shader)
+            return false;
         checkShaderLog(shader); // this can be a warning
-        int status = glShaderInt(shader, GL_COMPILE_STATUS);
-        if (!status) {
+        if (!glShaderInt(shader, GL_COMPILE_STATUS)) {
             LogWarning("error: failed to compile '%s'", sourceName.c_str());
             glDeleteShader(shader);
-            return 0;
+            shader = 0;
+            return false;
         }
-        return shader;
+        return true;
     }
-    static GLuint compileShaderFile(const string& filename, time_t* modified, GLenum type)
+
+    static bool readShaderFile(const string& filename, time_t* modified, string& outSource)
     {
         auto f = rpp::file{filename, rpp::READONLY};
         if (!f) {
             //LogError("error: failed to open file '%s'", filename.c_str());
-            return 0;
+            return false;
         }
 
         int size = f.size_and_time_modified(modified);
+        outSource.resize(size_t(size));
+        f.read(&outSource[0], size);
+        return true;
+    }
 
-        char* mem = (char*)(size <= 65536 ? alloca(size) : malloc(size_t(size)));
-        f.read(mem, size);
-        f.close();
+    // GL_KHR_parallel_shader_compile lets the driver compile on its own threads,
+    // so we can submit all the programs first and poll GL_COMPLETION_STATUS later
+    static bool parallelCompileSupported()
+    {
+        static int supported = -1;
+        if (supported == -1)
+        {
+            const GLubyte* extensions = glGetString(GL_EXTENSIONS);
+            supported = GLEW_ARB_parallel_shader_compile
+                     || glIsExtAvailable(extensions, "GL_KHR_parallel_shader_compile");
+            if (supported && glMaxShaderCompilerThreadsARB)
+                glMaxShaderCompilerThreadsARB(0xFFFFFFFF); // let the driver decide
+        }
+        return supported == 1;
+    }
 
-        GLuint shader = compileShader(mem, size, filename, type);
-        if (size > 65536) free(mem);
-        return shader;
+    struct PendingProgram
+    {
+        GLuint vs, fs, program;
+    };
+
+    // submits compilation of both shaders and the program link without waiting for the driver
+    static PendingProgram submitProgram(strview vsSource, strview fsSource, strview definitions, bool retrievable)
+    {
+        PendingProgram p;
+        p.vs = submitShader(vsSource.str, vsSource.len, definitions, GL_VERTEX_SHADER);
+        p.fs = submitShader(fsSource.str, fsSource.len, definitions, GL_FRAGMENT_SHADER);
+        p.program = 0;
+        if (p.vs && p.fs)
+        {
+            GLuint sp = p.program = glCreateProgram();
+            glAttachShader(sp, p.vs);
+            glAttachShader(sp, p.fs);
+
+            // bind our hard-coded attribute locations:
+            for (GLuint i = 0; i < a_MaxAttributes; ++i)
+                glBindAttribLocation(sp, i, AttributeMap[i]);
+
+            if (retrievable) // hint the driver that we will call glGetProgramBinary
+                glProgramParameteri(sp, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+            glLinkProgram(sp);
+        }
+        return p;
+    }
+
+    // @return TRUE if finishProgram() will not block
+    static bool isProgramReady(GLuint program)
+    {
+        if (!program || !parallelCompileSupported())
+            return true;
+        return glProgramInt(program, GL_COMPLETION_STATUS_ARB) != 0;
+    }
+
+    // waits for compile & link results, returns the linked program or 0 on failure
+    static GLuint finishProgram(PendingProgram p, const string& vsPath, const string& fsPath)
+    {
+        bool vsOK = checkShader(p.vs, vsPath);
+        bool fsOK = checkShader(p.fs, fsPath);
+        GLuint sp = p.program;
+        if (sp && vsOK && fsOK && !glProgramInt(sp, GL_LINK_STATUS)) {
+            LogError("error: (%s|.frag) link failed!", vsPath.c_str());
+            checkShaderLog(sp);
+            vsOK = false;
+        }
+        if (sp && !(vsOK && fsOK)) {
+            glDeleteProgram(sp);
+            sp = 0;
+        }
+        if (p.vs) glDeleteShader(p.vs);
+        if (p.fs) glDeleteShader(p.fs);
+        return sp;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
 
-    Shader::Shader() : program(0), vsMod(0), fsMod(0)
+    string Shader::BinaryCacheDir;
+
+    static bool programBinarySupported()
+    {
+        if (Shader::BinaryCacheDir.empty() || !glProgramBinary || !glGetProgramBinary)
+            return false;
+        int numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }
+
+    // program binaries are only valid for the exact same sources and driver
+    static uint64_t programBinaryKey(strview vsSource, strview fsSource, strview definitions)
+    {
+        uint64_t key = fnv1a64(vsSource.str, size_t(vsSource.len));
+        key = fnv1a64(fsSource.str, size_t(fsSource.len), key);
+        key = fnv1a64(definitions.str, size_t(definitions.len), key);
+        const char* preamble = glslPreamble();
+        key = fnv1a64(preamble, strlen(preamble), key);
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            if (auto* str = (const char*)glGetString(name))
+                key = fnv1a64(str, strlen(str), key);
+        }
+        return key;
+    }
+
+    static string programBinaryPath(uint64_t key)
     {
-        memset(uniforms, -1, sizeof(uniforms));
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "/%016llx.bin", (unsigned long long)key);
+        return Shader::BinaryCacheDir + fileName;
+    }
+
+    // cached binary layout: [GLenum binaryFormat][program binary]
+    static GLuint loadProgramBinary(uint64_t key)
+    {
+        string path = programBinaryPath(key);
+        auto buf = rpp::file::read_all(path);
+        if (!buf || buf.size() <= (int)sizeof(GLenum))
+            return 0; // cache miss
+
+        GLenum format;
+        memcpy(&format, buf.data(), sizeof(format));
+
+        GLuint sp = glCreateProgram();
+        glFlushErrors();
+        glProgramBinary(sp, format, buf.data() + sizeof(GLenum), GLsizei(buf.size() - sizeof(GLenum)));
+        glFlushErrors();
+        if (!glProgramInt(sp, GL_LINK_STATUS)) {
+            // driver rejected the binary (driver update?), drop it and compile from source
+            LogInfo("Shader binary '%s' rejected by driver, recompiling", path.c_str());
+            glDeleteProgram(sp);
+            rpp::delete_file(path);
+            return 0;
+        }
+        return sp;
+    }
+
+    static void saveProgramBinary(GLuint program, uint64_t key)
+    {
+        int length = glProgramInt(program, GL_PROGRAM_BINARY_LENGTH);
+        if (length <= 0)
+            return;
+
+        vector<uint8_t> data(sizeof(GLenum) + length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, data.data() + sizeof(GLenum));
+        memcpy(data.data(), &format, sizeof(format));
+
+        rpp::create_folder(Shader::BinaryCacheDir);
+        string path = programBinaryPath(key);
+        rpp::file f { path, rpp::CREATENEW };
+        if (!f) {
+            LogWarning("failed to create shader binary '%s'", path.c_str());
+            return;
+        }
+        f.write(data.data(), int(sizeof(GLenum) + length));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+
+    Shader::Shader() : program(0), vsMod(0), fsMod(0), binaryKey(0)
+    {
+        memset(uniforms,     -1, sizeof(uniforms));
+        memset(uniformCache, -1, sizeof(uniformCache));
     }
 
     Shader::~Shader()
     {
-        if (program) glDeleteProgram(program);
+        discardPending();
+        if (program) {
+            GLState::current().onProgramDeleted(program);
+            glDeleteProgram(program);
+        }
     }
     
     string Shader::name() const
@@ -326,84 +806,185 @@ namespace AGL
         return rpp::file_name(vsPath);
     }
 
-    bool Shader::loadShader(const string& shaderName)
+    bool Shader::loadShader(const string& shaderName, ShaderCompileMode mode)
+    {
+        return loadShader(shaderName, string{}, mode);
+    }
+
+    bool Shader::loadShader(const string& shaderName, const string& definitions, ShaderCompileMode mode)
     {
+        defines = definitions;
         vsPath = shaderName + ".vert";
         fsPath = shaderName + ".frag";
         vsMod = 0;
         fsMod = 0;
         memset(uniforms,   -1,    sizeof(uniforms));
         memset(attributes, false, sizeof(attributes));
-        return reload();
+        if (mode == CompileLazy) {
+            discardPending();
+            lazyLoad = true;
+            return true;
+        }
+        return reload(mode);
     }
     
     bool Shader::hotload()
     {
-        if (rpp::file_modified(vsPath) != vsMod) return reload();
-        if (rpp::file_modified(fsPath) != fsMod) return reload();
+        if (rpp::file_modified(vsPath) != vsMod || 
+            rpp::file_modified(fsPath) != fsMod)
+        {
+            invalidateBinary();
+            return reload();
+        }
         return false;
     }
 
-    bool Shader::reload()
+    void Shader::invalidateBinary()
+    {
+        if (binaryKey)
+        {
+            rpp::delete_file(programBinaryPath(binaryKey));
+            binaryKey = 0;
+        }
+    }
+
+    bool Shader::reload(ShaderCompileMode mode)
     {
         //printf("loading shader %s|.frag\n", vs_path);
-        GLuint vs = compileShaderFile(vsPath, &vsMod, GL_VERTEX_SHADER);
-        GLuint fs = compileShaderFile(fsPath, &fsMod, GL_FRAGMENT_SHADER);
+        lazyLoad = false;
+        discardPending();
 
-        // one of the files not found? then fall back to engine shader
-        if (!vsMod || !fsMod) {
-            if (ShaderPair s = GetEngineShaderSource(rpp::file_name(vsPath))) {
-                if (vs) glDeleteShader(vs);
-                if (fs) glDeleteShader(fs);
-                vs = compileShader(s.vert.str, s.vert.len, vsPath, GL_VERTEX_SHADER);
-                fs = compileShader(s.frag.str, s.frag.len, fsPath, GL_FRAGMENT_SHADER);
-            }
-            else LogWarning("error: failed to get fallback shader for '%s'", vsPath.c_str());
+        string vsSource, fsSource;
+        strview vs, fs;
+        if (!readSources(vsSource, fsSource, vs, fs))
+            return false;
+
+        // try the program binary cache first, it skips GLSL compilation completely
+        const bool useCache = programBinarySupported();
+        const uint64_t key = useCache ? programBinaryKey(vs, fs, defines) : 0;
+        if (GLuint sp = useCache ? loadProgramBinary(key) : 0) {
+            setProgram(sp, key);
+            return true;
         }
 
-        int status = vs && fs; // ok?
-        if (status) {
-            glDeleteProgram(program);
-            GLuint sp = program = glCreateProgram();
-            glAttachShader(sp, vs);
-            glAttachShader(sp, fs);
+        PendingProgram p = submitProgram(vs, fs, defines, useCache);
+        pendingVS      = p.vs;
+        pendingFS      = p.fs;
+        pendingProgram = p.program;
+        pendingKey     = key;
+        if (!p.program)
+            return finishCompile(); // submit failed, report the errors
 
-            // bind our hard-coded attribute locations:
-            for (GLuint i = 0; i < a_MaxAttributes; ++i)
-                glBindAttribLocation(sp, i, AttributeMap[i]);
+        if (mode == CompileAsync)
+            return true;
+        return finishCompile();
+    }
 
-            glLinkProgram(sp);
-            status = glProgramInt(sp, GL_LINK_STATUS);
-            if (!status) {
-                LogError("error: (%s|.frag) link failed!", vsPath.c_str());
-                checkShaderLog(sp);
+    bool Shader::readSources(string& vsSource, string& fsSource, strview& vs, strview& fs)
+    {
+        bool vsFound = readShaderFile(vsPath, &vsMod, vsSource);
+        bool fsFound = readShaderFile(fsPath, &fsMod, fsSource);
+        vs = vsSource;
+        fs = fsSource;
+
+        // one of the files not found? then fall back to engine shader
+        if (!vsFound || !fsFound) {
+            if (ShaderPair s = GetEngineShaderSource(rpp::file_name(vsPath))) {
+                vs = s.vert;
+                fs = s.frag;
             }
             else {
-                loadUniforms();
-
-                // assign texture unit 0 to diffuseTex uniform:
-                if (uniforms[u_DiffuseTex] != -1) {
-                    glUseProgram(sp);
-                    glUniform1i(uniforms[u_DiffuseTex], 0);
-                    glUseProgram(0);
-                }
-                
-                glValidateProgram(sp);
-                status = glProgramInt(sp, GL_VALIDATE_STATUS);
-                if (!status) LogError("error: (%s|.frag) validate failed!", vsPath.c_str());
-                
-                checkShaderLog(sp); // this can be a warning, so we always display log
+                LogWarning("error: failed to get fallback shader for '%s'", vsPath.c_str());
+                return false;
             }
         }
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        return status != 0;
+        return true;
+    }
+
+    bool Shader::loadSources(const string& shaderName, string& outVert, string& outFrag)
+    {
+        Shader shader;
+        shader.vsPath = shaderName + ".vert";
+        shader.fsPath = shaderName + ".frag";
+        strview vs, fs;
+        if (!shader.readSources(outVert, outFrag, vs, fs))
+            return false;
+        if (outVert.data() != vs.str) outVert = vs.to_string();
+        if (outFrag.data() != fs.str) outFrag = fs.to_string();
+        return true;
+    }
+
+    bool Shader::isReady() const
+    {
+        if (lazyLoad)
+            return false;
+        if (pendingVS || pendingFS || pendingProgram)
+            return isProgramReady(pendingProgram);
+        return program != 0;
+    }
+
+    bool Shader::finishCompile()
+    {
+        if (lazyLoad)
+            return reload(CompileImmediate);
+        if (!pendingVS && !pendingFS && !pendingProgram)
+            return program != 0;
+
+        PendingProgram p { pendingVS, pendingFS, pendingProgram };
+        pendingVS = pendingFS = pendingProgram = 0;
+        GLuint sp = finishProgram(p, vsPath, fsPath);
+        if (!sp)
+            return false;
+
+        if (pendingKey)
+            saveProgramBinary(sp, pendingKey);
+        setProgram(sp, pendingKey);
+        return true;
+    }
+
+    void Shader::discardPending()
+    {
+        if (pendingProgram) glDeleteProgram(pendingProgram), pendingProgram = 0;
+        if (pendingVS) glDeleteShader(pendingVS), pendingVS = 0;
+        if (pendingFS) glDeleteShader(pendingFS), pendingFS = 0;
+    }
+
+    void Shader::setProgram(uint32_t sp, uint64_t key)
+    {
+        GLState& state = GLState::current();
+        if (program) {
+            state.onProgramDeleted(program);
+            glDeleteProgram(program);
+        }
+        program   = sp;
+        binaryKey = key;
+        uniformValid = 0; // newly linked program has all uniforms reset
+        loadUniforms();
+
+        // assign texture unit 0 to diffuseTex uniform:
+        if (uniforms[u_DiffuseTex] != -1) {
+            uint32_t previous = state.program();
+            state.useProgram(sp);
+            glUniform1i(uniforms[u_DiffuseTex], 0);
+            state.useProgram(previous);
+        }
+
+    #if DEBUG || _DEBUG // validation is a driver round-trip, only do it in debug builds
+        glValidateProgram(sp);
+        if (!glProgramInt(sp, GL_VALIDATE_STATUS))
+            LogError("error: (%s|.frag) validate failed!", vsPath.c_str());
+    #endif
+
+        checkShaderLog(sp); // this can be a warning, so we always display log
     }
     
     void Shader::unload()
     {
+        lazyLoad = false;
+        discardPending();
         if (program)
         {
+            GLState::current().onProgramDeleted(program);
             glDeleteProgram(program);
             program = 0;
         }
@@ -411,17 +992,12 @@ namespace AGL
 
     void Shader::loadUniforms()
     {
-        // brute force load all supported uniform and attribute locations
-        int numActive;
-        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numActive);
-        for (int i = 0; numActive && i < u_MaxUniforms; ++i) {
-            int loc = glGetUniformLocation(program, UniformMap[i]);
-            if (loc != -1) {
-                --numActive;
-                //printf(" uniform %d %s\n", loc, UniformMap[i]);
-            }
-            uniforms[i] = (char)loc; // always write result (in case of shader reload)
-        }
+        // brute force load all built-in and declared uniform locations
+        numResolved = 0;
+        uniformValues.clear();
+        memset(uniforms,     -1, sizeof(uniforms));
+        memset(uniformCache, -1, sizeof(uniformCache));
+        resolveUniforms(0);
         //glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &numActive);
         for (int i = 0; i < a_MaxAttributes; ++i) {
             int loc = glGetAttribLocation(program, AttributeMap[i]);
@@ -430,30 +1006,55 @@ namespace AGL
             }
             attributes[i] = loc != -1; // always write result (in case of shader reload)
         }
+        // block bindings are program state, so they must be reassigned after every link
+        const bool blocksSupported = UniformBuffer::supported();
+        for (int i = 0; i < ub_MaxBlocks; ++i) {
+            GLuint index = blocksSupported ? glGetUniformBlockIndex(program, BlockMap[i]) : GL_INVALID_INDEX;
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(program, index, (GLuint)i);
+            blocks[i] = index != GL_INVALID_INDEX;
+        }
+    }
+
+    void Shader::resolveUniforms(int firstSlot)
+    {
+        for (int i = firstSlot; i < NumDeclared; ++i) {
+            int loc = glGetUniformLocation(program, uniform_name((ShaderUniform)i));
+            uniforms[i] = (int16_t)loc; // always write result (in case of shader reload)
+            if (loc != -1) {
+                //printf(" uniform %d %s\n", loc, uniform_name((ShaderUniform)i));
+                uniformCache[i] = (int8_t)uniformValues.size();
+                uniformValues.emplace_back();
+            }
+        }
+        numResolved = NumDeclared;
     }
 
-    static int getActiveProgram()
+    int Shader::location(ShaderUniform uniformSlot)
     {
-        int program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); return program;
+        if (uniformSlot >= numResolved && program)
+            resolveUniforms(numResolved); // uniform was declared after this program was linked
+        return uniforms[uniformSlot];
     }
 
     void Shader::bind()
     {
-        if (program != (uint32_t)getActiveProgram()) {
-            glUseProgram(program);
-        }
+        if (lazyLoad || pendingProgram)
+            finishCompile();
+        GLState::current().useProgram(program);
     }
 
     void Shader::unbind()
     {
-        if (program == (uint32_t)getActiveProgram()) {
-            glUseProgram(0);
+        GLState& state = GLState::current();
+        if (program == state.program()) {
+            state.useProgram(0);
         }
     }
 
     bool Shader::activeUniform(ShaderUniform uniformSlot) const
     {
-        return uniforms[uniformSlot] != -1;
+        return 0 <= uniformSlot && uniformSlot < numResolved && uniforms[uniformSlot] != -1;
     }
 
     bool Shader::activeAttrib(ShaderAttr attrSlot) const
@@ -461,28 +1062,71 @@ namespace AGL
         return attributes[attrSlot];
     }
 
-    void Shader::checkUniform(const char* where, ShaderUniform uniformSlot) const
+    bool Shader::activeBlock(ShaderBlock block) const
+    {
+        return blocks[block];
+    }
+
+    // @return uniform location, or -1 if the uniform can't be bound
+    int Shader::checkUniform(const char* where, ShaderUniform uniformSlot)
     {
-        if (!getActiveProgram())
+        if (!GLState::current().program())
             LogError("%s: no active shader program", where);
-        if (uniformSlot < 0 || u_MaxUniforms <= uniformSlot)
+        if (uniformSlot < 0 || NumDeclared <= uniformSlot) {
             LogError("%s: uniform %d is invalid", where, uniformSlot);
-        if (uniforms[uniformSlot] == -1)
+            return -1;
+        }
+        int loc = location(uniformSlot);
+        if (loc == -1)
             LogError("%s: uniform '%s' not found", where, uniform_name(uniformSlot));
+        return loc;
+    }
+
+    static ShaderUniformStats UniformStats;
+
+    const ShaderUniformStats& Shader::uniformStats()
+    {
+        return UniformStats;
+    }
+
+    void Shader::resetUniformStats()
+    {
+        UniformStats = ShaderUniformStats{};
+    }
+
+    bool Shader::uniformChanged(ShaderUniform uniformSlot, const void* value, size_t numBytes)
+    {
+        const int cache = uniformCache[uniformSlot];
+        if (cache < 0 || numBytes > sizeof(UniformValue)) { // too big to shadow, such as long arrays
+            ++UniformStats.issued;
+            return true;
+        }
+        const uint64_t bit = 1ull << uniformSlot;
+        float* shadow = uniformValues[cache].data;
+        if ((uniformValid & bit) && memcmp(shadow, value, numBytes) == 0) {
+            ++UniformStats.skipped;
+            return false;
+        }
+        memcpy(shadow, value, numBytes);
+        uniformValid |= bit;
+        ++UniformStats.issued;
+        return true;
     }
 
     void Shader::bind(ShaderUniform uniformSlot, const Matrix4& matrix)
     {
-        checkUniform("shader_bind_mat4()", uniformSlot);
-        glUniformMatrix4fv(uniforms[uniformSlot], 1, GL_FALSE, matrix.m);
+        int loc = checkUniform("shader_bind_mat4()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, matrix.m, sizeof(float)*16))
+            glUniformMatrix4fv(loc, 1, GL_FALSE, matrix.m);
     }
     
     void Shader::bind(ShaderUniform uniformSlot, unsigned glTexture)
     {
-        checkUniform("shader_bind_tex()", uniformSlot);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, glTexture);
-        glUniform1i(uniforms[uniformSlot], 0); // 0=GL_TEXTURE0
+        int loc = checkUniform("shader_bind_tex()", uniformSlot);
+        GLState::current().bindTexture(0, glTexture);
+        const int unit = 0; // 0=GL_TEXTURE0
+        if (loc != -1 && uniformChanged(uniformSlot, &unit, sizeof(unit)))
+            glUniform1i(loc, unit);
     }
     
     void Shader::bind(ShaderUniform uniformSlot, const Texture& texture)
@@ -497,20 +1141,97 @@ namespace AGL
     
     void Shader::bind(ShaderUniform uniformSlot, const Vector2& value)
     {
-        checkUniform("shader_bind_vec2()", uniformSlot);
-        glUniform2fv(uniforms[uniformSlot], 1, &value.x);
+        int loc = checkUniform("shader_bind_vec2()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, &value.x, sizeof(float)*2))
+            glUniform2fv(loc, 1, &value.x);
     }
     
     void Shader::bind(ShaderUniform uniformSlot, const Vector3& value)
     {
-        checkUniform("shader_bind_vec3()", uniformSlot);
-        glUniform3fv(uniforms[uniformSlot], 1, &value.x);
+        int loc = checkUniform("shader_bind_vec3()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, &value.x, sizeof(float)*3))
+            glUniform3fv(loc, 1, &value.x);
     }
     
     void Shader::bind(ShaderUniform uniformSlot, const Vector4& value)
     {
-        checkUniform("shader_bind_vec4()", uniformSlot);
-        glUniform4fv(uniforms[uniformSlot], 1, &value.x);
+        int loc = checkUniform("shader_bind_vec4()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, &value.x, sizeof(float)*4))
+            glUniform4fv(loc, 1, &value.x);
+    }
+
+    void Shader::bindFloat(ShaderUniform uniformSlot, float value)
+    {
+        int loc = checkUniform("shader_bind_float()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, &value, sizeof(float)))
+            glUniform1f(loc, value);
+    }
+
+    void Shader::bindInt(ShaderUniform uniformSlot, int value)
+    {
+        int loc = checkUniform("shader_bind_int()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, &value, sizeof(int)))
+            glUniform1i(loc, value);
+    }
+
+    void Shader::bindMat3(ShaderUniform uniformSlot, const float* matrix3x3)
+    {
+        int loc = checkUniform("shader_bind_mat3()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, matrix3x3, sizeof(float)*9))
+            glUniformMatrix3fv(loc, 1, GL_FALSE, matrix3x3);
+    }
+
+    void Shader::bindMat3(ShaderUniform uniformSlot, const Matrix4& matrix)
+    {
+        const float* m = matrix.m;
+        const float matrix3x3[9] = {
+            m[0], m[1], m[2],
+            m[4], m[5], m[6],
+            m[8], m[9], m[10],
+        };
+        bindMat3(uniformSlot, matrix3x3);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const float* values, int count)
+    {
+        int loc = checkUniform("shader_bind_float[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(float)*count))
+            glUniform1fv(loc, count, values);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const int* values, int count)
+    {
+        int loc = checkUniform("shader_bind_int[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(int)*count))
+            glUniform1iv(loc, count, values);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const Vector2* values, int count)
+    {
+        int loc = checkUniform("shader_bind_vec2[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(Vector2)*count))
+            glUniform2fv(loc, count, &values->x);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const Vector3* values, int count)
+    {
+        int loc = checkUniform("shader_bind_vec3[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(Vector3)*count))
+            glUniform3fv(loc, count, &values->x);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const Vector4* values, int count)
+    {
+        int loc = checkUniform("shader_bind_vec4[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(Vector4)*count))
+            glUniform4fv(loc, count, &values->x);
+    }
+
+    void Shader::bind(ShaderUniform uniformSlot, const Matrix4* values, int count)
+    {
+        int loc = checkUniform("shader_bind_mat4[]()", uniformSlot);
+        if (loc != -1 && uniformChanged(uniformSlot, values, sizeof(Matrix4)*count))
+            glUniformMatrix4fv(loc, count, GL_FALSE, values->m);
     }
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -3,7 +3,9 @@
 //
 #pragma once
 #include "Texture.h"
+#include "Hash.h"
 #include <cstdint>
+#include <initializer_list>
 
 namespace AGL
 {
@@ -30,7 +32,42 @@ namespace AGL
         u_DiffuseColor, // uniform vec4 diffuseColor;     diffuse color 
         u_OutlineColor, // uniform vec4 outlineColor;     background or outline color
         u_ShaderData,   // uniform vec4 shaderData;       shader specific data
-        u_MaxUniforms,  // uniform counter
+        u_MaxUniforms,  // uniform counter, also the first DeclareUniform() slot
+        u_Invalid = -1, // invalid or undeclared uniform
+    };
+
+    /** @brief Total number of uniform slots, built-in ShaderUniforms + DeclareUniform() slots */
+    static constexpr int MaxShaderUniforms = 64;
+
+    /** @brief Hash of a uniform name, can be evaluated at compile time */
+    constexpr uint32_t UniformHash(const char* name) { return fnv1a32(name); }
+
+    /**
+     * Declares an application specific uniform. The returned slot can be passed
+     * to Shader::bind() just like the built-in ShaderUniforms, its location is
+     * resolved once per program link instead of a glGetUniformLocation every frame.
+     * Declaring the same name again returns the same slot.
+     *
+     *     static const ShaderUniform u_Time = DeclareUniform("time");
+     *     shader.bindFloat(u_Time, seconds);
+     *
+     * @return New uniform slot, or u_Invalid if all MaxShaderUniforms slots are taken
+     */
+    AGL_API ShaderUniform DeclareUniform(const char* name);
+
+    /**
+     * @return Slot of a built-in or declared uniform by its UniformHash(),
+     *         or u_Invalid if no such uniform was declared
+     */
+    AGL_API ShaderUniform FindUniform(uint32_t nameHash);
+
+
+    /** @brief shader uniform block binding points */
+    enum ShaderBlock : int
+    {
+        ub_FrameData,   // uniform FrameData;  per-frame camera data, @see FrameUniforms
+        ub_ObjectData,  // uniform ObjectData; per-draw model matrix, @see ObjectUniforms
+        ub_MaxBlocks,   // uniform block counter
     };
 
 
@@ -43,6 +80,9 @@ namespace AGL
         a_Coord2,        // attribute vec2 coord2;      texture coordinate 1
         a_Vertex,        // attribute vec4 vertex;      additional generic 4D vertex
         a_Color,         // attribute vec4 color;       per-vertex coloring
+        a_Instance,      // attribute vec4 instance;    per-instance offset xyz and uniform scale w
+        a_InstanceColor, // attribute vec4 instanceColor; per-instance color multiplier
+        a_DrawId,        // attribute float drawId;     multi-draw index into per-draw data, @see BatchRenderer
         a_MaxAttributes, // attribute counter
     };
 
@@ -50,11 +90,35 @@ namespace AGL
     ////////////////////////////////////////////////////////////////////////////////
 
 
+    /** @brief Component type of a vertex attribute */
+    enum VertexType : uint8_t
+    {
+        vt_Float,      // GL_FLOAT                 4 bytes per component
+        vt_Half,       // GL_HALF_FLOAT            2 bytes per component
+        vt_UByte,      // GL_UNSIGNED_BYTE         1 byte per component, eg UNORM8 colors
+        vt_Short,      // GL_SHORT                 2 bytes per component, eg SNORM16 positions
+        vt_UShort,     // GL_UNSIGNED_SHORT        2 bytes per component
+        vt_Int1010102, // GL_INT_2_10_10_10_REV    4 bytes for all 4 components, eg SNORM normals
+    };
+
+    /** @brief Integer attributes are mapped to [0,1] or [-1,1] in the shader */
+    static constexpr uint8_t Normalized = 1;
+
+
     /** @brief Describes a single element in a vertex (visualized by .natvis) */
     struct VertexDescrElem
     {
         uint8_t attr; // ShaderAttr vertex attribute slot identifier (a_Position, etc.)
         uint8_t size; // Number of elements per attribute (1-4 floats or ints)
+        uint8_t type; // VertexType of each component
+        uint8_t norm; // Normalized if integer components are normalized
+
+        /** @return Size of this element in bytes */
+        int bytes() const
+        {
+            static constexpr uint8_t componentSize[] = { 4, 2, 1, 2, 2, 1 };
+            return size * componentSize[type];
+        }
     };
 
 
@@ -70,12 +134,29 @@ namespace AGL
         // constructs a new vertex descriptor performs layout validation
         VertexDescr(int sizeOf, ShaderAttr attr0, int size0, ...) noexcept;
 
+        /**
+         * Constructs a vertex descriptor with packed attribute formats
+         * @code
+         *    VertexDescr vd = { sizeof(Vertex3ColorPacked), {
+         *        { a_Position, 3, vt_Float, 0 },
+         *        { a_Color,    4, vt_UByte, Normalized },
+         *    }};
+         * @endcode
+         */
+        VertexDescr(int sizeOf, std::initializer_list<VertexDescrElem> elems) noexcept;
+
         // validate this vertex layout descriptor
         void validate() const;
         
         // resets layout descriptor
         void clear();
 
+        // enables vertex attributes of the currently bound GL_ARRAY_BUFFER,
+        // starting at byte `offset` of the buffer
+        // if divisor > 0, attributes advance once per `divisor` instances
+        void enableAttribs(uintptr_t offset = 0, uint32_t divisor = 0) const;
+        void disableAttribs(uint32_t divisor = 0) const;
+
         bool operator==(const VertexDescr& d) const { 
             return sizeOf == d.sizeOf && memcmp(items, d.items, sizeof(items)) == 0;
         }
@@ -225,6 +306,77 @@ namespace AGL
         }
     };
 
+    /**
+     * @note Packed Vertex3Color with UNORM8 color, 16 bytes instead of 28
+     * @note Attributes a_Position, a_Color
+     */
+    struct Vertex3ColorPacked
+    {
+        float x, y, z;          // position xyz
+        uint8_t r, g, b, a;     // color rgba, UNORM8
+        static VertexDescr layout() {
+            return { sizeof(Vertex3ColorPacked), {
+                { a_Position, 3, vt_Float, 0 },
+                { a_Color,    4, vt_UByte, Normalized },
+            }};
+        }
+    };
+
+    /**
+     * @note Packed Vertex3UVNorm with half-float UVs and a 2_10_10_10 normal, 20 bytes instead of 32
+     * @note Attributes a_Position, a_Coord, a_Normal
+     */
+    struct Vertex3UVNormPacked
+    {
+        float x, y, z;          // position xyz
+        uint16_t u, v;          // texture coordinates, half-float
+        uint32_t normal;        // vertex normal, SNORM 2_10_10_10_REV, w unused
+        static VertexDescr layout() {
+            return { sizeof(Vertex3UVNormPacked), {
+                { a_Position, 3, vt_Float, 0 },
+                { a_Coord,    2, vt_Half, 0 },
+                { a_Normal,   4, vt_Int1010102, Normalized },
+            }};
+        }
+    };
+
+    /**
+     * @note Per-instance attributes for VertexBuffer::setInstances(), 20 bytes per instance
+     * @note Attributes a_Instance, a_InstanceColor
+     */
+    struct InstanceOffsetColor
+    {
+        float x, y, z;          // instance offset xyz
+        float scale;            // uniform scale of the instanced mesh
+        uint8_t r, g, b, a;     // color multiplier rgba, UNORM8
+        static VertexDescr layout() {
+            return { sizeof(InstanceOffsetColor), {
+                { a_Instance,      4, vt_Float, 0 },
+                { a_InstanceColor, 4, vt_UByte, Normalized },
+            }};
+        }
+    };
+
+    /**
+     * @note Quantized Vertex3UVNorm, 16 bytes instead of 32. Positions are SNORM16 in
+     *       [-1,1] relative to the mesh bounds, the dequantization scale and offset
+     *       must be applied with the model transform, @see MeshQuantizer
+     * @note Attributes a_Position, a_Coord, a_Normal
+     */
+    struct Vertex3UVNormQuantized
+    {
+        int16_t x, y, z, w;     // position xyz, SNORM16, w is padding
+        uint16_t u, v;          // texture coordinates, half-float
+        uint32_t normal;        // vertex normal, SNORM 2_10_10_10_REV, w unused
+        static VertexDescr layout() {
+            return { sizeof(Vertex3UVNormQuantized), {
+                { a_Position, 4, vt_Short, Normalized },
+                { a_Coord,    2, vt_Half, 0 },
+                { a_Normal,   4, vt_Int1010102, Normalized },
+            }};
+        }
+    };
+
 
     ////////////////////////////////////////////////////////////////////////////////
     
@@ -239,19 +391,47 @@ namespace AGL
         DrawLines,         // each vertex pair is a unique line
         DrawLineStrip,     // adjacent vertices are lines. if you pass n vertices, you will get n-1 lines
         DrawLineLoop,      // as line strips, except that the first and last vertices are also used as a line
+        DrawPoints,        // each vertex is a point, size is set by glPointSize(), @see PointCloud::PointSize
+    };
+
+
+    /** @brief GL buffer usage hint of a VertexBuffer */
+    enum BufferUsage
+    {
+        UsageStatic,  // GL_STATIC_DRAW:  uploaded once, drawn many times
+        UsageDynamic, // GL_DYNAMIC_DRAW: updated occasionally
+        UsageStream,  // GL_STREAM_DRAW:  updated every frame
     };
 
 
+    class MeshArena;
+
     /** @brief Provides methods for creating efficient Vertex array objects and rendering them */
     class AGL_API VertexBuffer
     {
         DrawMode drawMode    = DrawNone; // how do we draw the vertices in VAO?
         uint32_t vertexArray = 0;        // vertex array object, required by modern opengl
+        uint32_t vertexBuffer = 0;       // VBO attached to the VAO
+        uint32_t indexBuffer  = 0;       // IBO attached to the VAO
+        int32_t vertexCapacity = 0;      // allocated VBO size in bytes
+        int32_t indexCapacity  = 0;      // allocated IBO size in bytes
         int32_t vertexCount  = 0;        // # of verts
         int32_t indexCount   = 0;        // # of indices
+        int32_t indexSize    = 0;        // bytes per index in the IBO: 2 or 4
         VertexDescr layout;              // vertex layout descriptor
+        uint32_t instanceBuffer = 0;     // per-instance attributes VBO, @see setInstances()
+        int32_t instanceCapacity = 0;    // allocated instance VBO size in bytes
+        int32_t instanceCount    = 0;    // # of instances, 0 if not instanced
+        VertexDescr instanceLayout;      // per-instance layout descriptor
+        MeshArena* arena  = nullptr;     // if set, vertices and indices live in this shared arena
+        int32_t arenaSlot = -1;          // allocation in the arena
 
     public:
+        /**
+         * Meshes with at most this many vertices store their indices as GL_UNSIGNED_SHORT,
+         * 0xFFFF itself is left free since it is the primitive restart index
+         */
+        static constexpr int MaxShortIndexVertices = 0xFFFF;
 
         VertexBuffer() noexcept;
         ~VertexBuffer();
@@ -259,23 +439,56 @@ namespace AGL
         VertexBuffer(VertexBuffer&& v) noexcept :
             drawMode    {v.drawMode},
             vertexArray {v.vertexArray},
+            vertexBuffer{v.vertexBuffer},
+            indexBuffer {v.indexBuffer},
+            vertexCapacity{v.vertexCapacity},
+            indexCapacity {v.indexCapacity},
             vertexCount {v.vertexCount},
             indexCount  {v.indexCount},
-            layout      {v.layout}
+            indexSize   {v.indexSize},
+            layout      {v.layout},
+            instanceBuffer  {v.instanceBuffer},
+            instanceCapacity{v.instanceCapacity},
+            instanceCount   {v.instanceCount},
+            instanceLayout  {v.instanceLayout},
+            arena           {v.arena},
+            arenaSlot       {v.arenaSlot}
         {
             v.drawMode    = DrawNone;
             v.vertexArray = 0;
+            v.vertexBuffer = 0;
+            v.indexBuffer  = 0;
+            v.vertexCapacity = 0;
+            v.indexCapacity  = 0;
             v.vertexCount = 0;
             v.indexCount  = 0;
+            v.indexSize   = 0;
             v.layout      = {};
+            v.instanceBuffer   = 0;
+            v.instanceCapacity = 0;
+            v.instanceCount    = 0;
+            v.instanceLayout   = {};
+            v.arena     = nullptr;
+            v.arenaSlot = -1;
         }
         VertexBuffer& operator=(VertexBuffer&& v) noexcept
         {
             swap(drawMode,    v.drawMode   );
             swap(vertexArray, v.vertexArray);
+            swap(vertexBuffer, v.vertexBuffer);
+            swap(indexBuffer,  v.indexBuffer );
+            swap(vertexCapacity, v.vertexCapacity);
+            swap(indexCapacity,  v.indexCapacity );
             swap(vertexCount, v.vertexCount);
             swap(indexCount,  v.indexCount );
+            swap(indexSize,   v.indexSize  );
             swap(layout,      v.layout     );
+            swap(instanceBuffer,   v.instanceBuffer  );
+            swap(instanceCapacity, v.instanceCapacity);
+            swap(instanceCount,    v.instanceCount   );
+            swap(instanceLayout,   v.instanceLayout  );
+            swap(arena,     v.arena    );
+            swap(arenaSlot, v.arenaSlot);
             return *this;
         }
 
@@ -283,6 +496,9 @@ namespace AGL
         VertexBuffer& operator=(const VertexBuffer&) = delete;
 
         bool empty() const { return vertexCount == 0; }
+
+        /** @return Bytes per index in the index buffer, 2 if the mesh fits 16-bit indices */
+        int indexBytes() const { return indexSize; }
         explicit operator bool() const { return vertexCount != 0; }
         bool     operator!    () const { return vertexCount == 0; }
         
@@ -301,6 +517,7 @@ namespace AGL
 
         /**
          * Creates a new VBO to store a vertex element array (DrawIndexed)
+         * If numVerts <= MaxShortIndexVertices, indices are converted to 16-bit during upload
          * @param verts      Pointer to vertex data
          * @param numVerts   Number of vertices, each sizeOf bytes
          * @param indices    Pointer to index data
@@ -331,6 +548,15 @@ namespace AGL
             create(verts.data(), (int)verts.size(), indices.data(), (int)indices.size(), VERTEX::layout());
         }
 
+        /**
+         * Creates a VBO from indices that are already in their GPU format, eg 16-bit
+         * indices of a memory mapped MeshFile, which are uploaded without conversion
+         * @param indexBytes Size of each index: 2 or 4
+         */
+        void create(const void* verts,   int numVerts,
+                    const void* indices, int numIndices, int indexBytes,
+                    const VertexDescr& layout);
+
         /**
          * Creates a new VBO to store a vertex array
          * @param mode       DrawMode to use: DrawTriangles or DrawTriangleStrip
@@ -365,9 +591,99 @@ namespace AGL
             create(mode, verts.data(), (int)verts.size());
         }
 
+        /**
+         * Creates the mesh in a shared MeshArena instead of its own VAO and buffers,
+         * meshes with the same layout are then drawn from one VAO with a base vertex.
+         * update() keeps the mesh in the arena, create() without an arena moves it out.
+         * Falls back to owned buffers if MeshArena::supported() is false
+         */
+        void create(MeshArena& arena, const void* verts, int numVerts,
+                    const index_t* indices, int numIndices, const VertexDescr& layout);
+
+        void create(MeshArena& arena, DrawMode mode, const void* verts, int numVerts,
+                    const VertexDescr& layout);
+
+        template<class VERTEX>
+        void create(MeshArena& arena, const vector<VERTEX>& verts, const vector<index_t>& indices)
+        {
+            create(arena, verts.data(), (int)verts.size(), indices.data(), (int)indices.size(), VERTEX::layout());
+        }
+
+        /** @return TRUE if this mesh is sub-allocated from a MeshArena */
+        bool inArena() const { return arena != nullptr; }
+        MeshArena* meshArena() const { return arena; }
+        int arenaAllocation() const { return arenaSlot; }
+
+        DrawMode mode() const { return drawMode; }
+
+        /** @return Number of triangles draw() submits, 0 for lines and points */
+        int numTriangles() const
+        {
+            int triangles = 0;
+            if      (drawMode == DrawIndexed)       triangles = indexCount / 3;
+            else if (drawMode == DrawTriangles)     triangles = vertexCount / 3;
+            else if (drawMode == DrawTriangleStrip) triangles = vertexCount > 2 ? vertexCount - 2 : 0;
+            return instanceCount > 0 ? triangles * instanceCount : triangles;
+        }
+
+        /**
+         * Updates the buffer contents in place, keeping the VAO, VBO and IBO.
+         * Buffers grow geometrically and are orphaned before upload, so updating
+         * every frame doesn't allocate GL objects or wait for in-flight draws.
+         * DrawMode, layout and counts are updated as well.
+         * @param usage UsageDynamic or UsageStream for frequently changing geometry
+         */
+        void update(const void*    verts,   int numVerts,
+                    const index_t* indices, int numIndices,
+                    const VertexDescr& layout, BufferUsage usage = UsageDynamic);
+
+        void update(DrawMode mode, const void* verts, int numVerts,
+                    const VertexDescr& layout, BufferUsage usage = UsageDynamic);
+
+        template<class VERTEX>
+        void update(const vector<VERTEX>& verts, const vector<index_t>& indices, BufferUsage usage = UsageDynamic)
+        {
+            update(verts.data(), (int)verts.size(), indices.data(), (int)indices.size(), VERTEX::layout(), usage);
+        }
+
+        template<class VERTEX>
+        void update(DrawMode mode, const vector<VERTEX>& verts, BufferUsage usage = UsageDynamic)
+        {
+            update(mode, verts.data(), (int)verts.size(), VERTEX::layout(), usage);
+        }
+
+        /** @return TRUE if core GL 3.3 glVertexAttribDivisor instancing is available */
+        static bool instancingSupported();
+
+        /**
+         * Sets per-instance attributes for the current mesh, which must be created first.
+         * Instance attributes advance once per instance, so a single shared mesh is
+         * drawn `numInstances` times by draw(). Pass 0 instances to stop instancing.
+         * @code
+         *    mesh.create(unitVerts, unitIndices);
+         *    vector<InstanceOffsetColor> instances = ...;
+         *    mesh.setInstances(instances);
+         * @endcode
+         */
+        void setInstances(const void* instances, int numInstances,
+                          const VertexDescr& layout, BufferUsage usage = UsageDynamic);
+
+        template<class INSTANCE>
+        void setInstances(const vector<INSTANCE>& instances, BufferUsage usage = UsageDynamic)
+        {
+            setInstances(instances.data(), (int)instances.size(), INSTANCE::layout(), usage);
+        }
+
+        bool instanced() const { return instanceCount > 0; }
+        int  instances() const { return instanceCount; }
+
         // draws the vertices; make sure you have bound a shader with some uniforms beforehand
+        // instanced buffers draw all instances
         void draw() const;
 
+        // draws `count` instances of the vertices, the shader must use the instance attributes
+        void drawInstanced(int count) const;
+
         // destroys all buffers and restores default empty state
         void clear();
 
@@ -375,11 +691,34 @@ namespace AGL
          * @return TRUE if `VertexDescr` layout responds to the given attribute
          */
         bool hasAttrib(ShaderAttr shaderAttr) const;
+
+    private:
+        void upload(DrawMode mode, const void* verts, int numVerts,
+                    const index_t* indices, int numIndices,
+                    const VertexDescr& layout, BufferUsage usage,
+                    int rawIndexBytes = 0);
+        void uploadToArena(MeshArena& arena, DrawMode mode, const void* verts, int numVerts,
+                           const index_t* indices, int numIndices, const VertexDescr& layout);
     };
 
 
     ////////////////////////////////////////////////////////////////////////////////
 
+    /** @brief How Shader::loadShader() compiles the GLSL program */
+    enum ShaderCompileMode
+    {
+        CompileImmediate, // compile and link before loadShader() returns
+        CompileAsync,     // submit compile and link to the driver, wait for the result on first bind()
+        CompileLazy,      // don't touch the sources until the first bind()
+    };
+
+    /** @brief Uniform uploads issued vs skipped because the value was unchanged */
+    struct ShaderUniformStats
+    {
+        int issued  = 0;
+        int skipped = 0;
+    };
+
     class AGL_API Shader
     {
         uint32_t program;  // linked glProgram
@@ -387,10 +726,36 @@ namespace AGL
         string fsPath;     // frag shader path
         time_t vsMod;      // last modified time of vert shader file
         time_t fsMod;      // last modified time of frag shader file
-        char uniforms  [u_MaxUniforms]; // uniform locations
+        uint64_t binaryKey; // program binary cache key, 0 if not cached
+        string defines;     // #define lines inserted after the GLSL preamble
+
+        // async compilation state, @see ShaderCompileMode
+        uint32_t pendingVS      = 0;
+        uint32_t pendingFS      = 0;
+        uint32_t pendingProgram = 0;
+        uint64_t pendingKey     = 0;
+        bool     lazyLoad       = false;
+
+        int16_t uniforms[MaxShaderUniforms]; // uniform locations, -1 if not used by the program
+        int     numResolved = 0;             // number of uniform slots resolved since the last link
         bool attributes[a_MaxAttributes] = {};  // attribute present? true/false
+        bool blocks    [ub_MaxBlocks]    = {};  // uniform block present? true/false
+
+        // shadow copy of the last uploaded uniform values, used to skip redundant glUniform calls
+        // only the uniforms that are used by the program have an entry
+        struct UniformValue { float data[16]; };
+        vector<UniformValue> uniformValues;
+        int8_t   uniformCache[MaxShaderUniforms]; // index into uniformValues, -1 if not cached
+        uint64_t uniformValid = 0; // bitmask of uniform slots whose uniformValues match the program state
 
     public:
+        /**
+         * If set, linked programs are cached in this directory as driver specific
+         * program binaries, which makes subsequent loads skip GLSL compilation.
+         * Cache entries are keyed by shader sources, GLSL preamble and GL driver strings.
+         */
+        static string BinaryCacheDir;
+
         /** @brief Default initializes this shader object */
         Shader();
         ~Shader();
@@ -404,32 +769,66 @@ namespace AGL
         bool operator!()const { return !program; }
 
         bool operator==(const Shader& s) const {
-            return vsPath == s.vsPath && fsPath == s.fsPath;
+            return vsPath == s.vsPath && fsPath == s.fsPath && defines == s.defines;
         }
         bool operator!=(const Shader& s) const {
-            return vsPath != s.vsPath || fsPath != s.fsPath;
+            return vsPath != s.vsPath || fsPath != s.fsPath || defines != s.defines;
         }
 
         string name() const;
         const string& vertShader() const { return vsPath; }
         const string& fragShader() const { return fsPath; }
+        const string& definitions() const { return defines; }
 
         /** @return TRUE if the GLSL program has linked */
         bool good() const { return program != 0; }
-        /** @brief Loads shader from {shaderName}.frag and {shaderName}.vert */
-        bool loadShader(const string& shaderName);
+        /**
+         * @brief Loads shader from {shaderName}.frag and {shaderName}.vert
+         * @note With CompileAsync and CompileLazy, compile errors are reported during the first bind()
+         */
+        bool loadShader(const string& shaderName, ShaderCompileMode mode = CompileImmediate);
+        /**
+         * @brief Loads a shader variant, `definitions` are #define lines inserted before the sources
+         * @see ShaderVariants
+         */
+        bool loadShader(const string& shaderName, const string& definitions,
+                        ShaderCompileMode mode = CompileImmediate);
+        /**
+         * @brief Reads {shaderName}.vert and {shaderName}.frag sources,
+         *        falling back to engine shader sources if the files don't exist
+         */
+        static bool loadSources(const string& shaderName, string& outVert, string& outFrag);
         /** @brief Reloads shader if VS or FS are modified. */
         bool hotload();
         /** @brief Forces a full recompile of the shaders */
-        bool reload();
+        bool reload(ShaderCompileMode mode = CompileImmediate);
+        /**
+         * @return TRUE if the program is linked and bind() won't block.
+         * With GL_KHR_parallel_shader_compile this polls GL_COMPLETION_STATUS_KHR
+         */
+        bool isReady() const;
+        /** @brief Blocks until pending async or lazy compilation has finished */
+        bool finishCompile();
+        /** @brief Deletes the cached program binary of this shader, if any */
+        void invalidateBinary();
         /** 
          * @brief Unloads and deletes the shader program
          * @note However, the shader can be reloaded with reload()
          */
         void unload();
+        /** @return Uniform upload statistics of all shaders since the last resetUniformStats() */
+        static const ShaderUniformStats& uniformStats();
+        static void resetUniformStats();
+
     private:
+        bool readSources(string& vsSource, string& fsSource, strview& vs, strview& fs);
+        void discardPending();
+        void setProgram(uint32_t linkedProgram, uint64_t key);
         void loadUniforms();
-        void checkUniform(const char* where, ShaderUniform uniformSlot) const;
+        void resolveUniforms(int firstSlot);
+        int  location(ShaderUniform uniformSlot);
+        int  checkUniform(const char* where, ShaderUniform uniformSlot);
+        bool uniformChanged(ShaderUniform uniformSlot, const void* value, size_t numBytes);
 
     public:
         /** @brief Binds the shader program for rendering */
@@ -443,6 +842,9 @@ namespace AGL
         /** @return TRUE if the specified attribute is active */
         bool activeAttrib(ShaderAttr attrSlot) const;
 
+        /** @return TRUE if the program declares the specified uniform block */
+        bool activeBlock(ShaderBlock block) const;
+
         void bind(ShaderUniform uniformSlot, const Matrix4& matrix);
         void bind(ShaderUniform uniformSlot, unsigned glTexture);
         void bind(ShaderUniform uniformSlot, const Texture& texture);
@@ -450,6 +852,26 @@ namespace AGL
         void bind(ShaderUniform uniformSlot, const Vector2& value);
         void bind(ShaderUniform uniformSlot, const Vector3& value);
         void bind(ShaderUniform uniformSlot, const Vector4& value);
+
+        /**
+         * Scalar uniforms have their own names, so that `bind(slot, 0)` keeps
+         * unbinding textures and double or nullptr arguments stay unambiguous
+         */
+        void bindFloat(ShaderUniform uniformSlot, float value);
+        void bindInt(ShaderUniform uniformSlot, int value);
+
+        /** @brief Binds a column-major 3x3 matrix to a mat3 uniform */
+        void bindMat3(ShaderUniform uniformSlot, const float* matrix3x3);
+        /** @brief Binds the upper left 3x3 of `matrix` to a mat3 uniform, such as a normal matrix */
+        void bindMat3(ShaderUniform uniformSlot, const Matrix4& matrix);
+
+        // array uniforms, such as `uniform vec4 lights[8];`
+        void bind(ShaderUniform uniformSlot, const float*   values, int count);
+        void bind(ShaderUniform uniformSlot, const int*     values, int count);
+        void bind(ShaderUniform uniformSlot, const Vector2* values, int count);
+        void bind(ShaderUniform uniformSlot, const Vector3* values, int count);
+        void bind(ShaderUniform uniformSlot, const Vector4* values, int count);
+        void bind(ShaderUniform uniformSlot, const Matrix4* values, int count);
     };
     
     ////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,141 @@
+#include "ShaderVariants.h"
+#include <rpp/debugging.h>
+#include <algorithm>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    static const char* FeatureMap[sf_MaxFeatureBit] = {
+        "HAS_TEXTURE",   // sf_HasTexture
+        "VERTEX_COLOR",  // sf_VertexColor
+        "ALPHA_TEST",    // sf_AlphaTest
+        "INSTANCED",     // sf_Instanced
+    };
+
+    // parses all `#pragma agl_features A B C` lines
+    static void parseFeatures(strview source, vector<string>& keywords)
+    {
+        strview line;
+        while (source.next(line, '\n'))
+        {
+            line.trim();
+            if (!line.starts_with("#pragma")) continue;
+            line.skip(7);
+            line.trim_start();
+            if (!line.starts_with("agl_features")) continue;
+            line.skip(12);
+
+            strview keyword;
+            while (line.next(keyword, ' '))
+            {
+                if (!keyword.trim()) continue;
+                string name = keyword.to_string();
+                if (std::find(keywords.begin(), keywords.end(), name) == keywords.end())
+                    keywords.push_back(name);
+            }
+        }
+    }
+
+    bool ShaderVariants::load(const string& shaderName, ShaderCompileMode mode)
+    {
+        clear();
+        Name = shaderName;
+        Mode = mode;
+        Features.clear();
+        DeclaredMask = 0;
+
+        string vert, frag;
+        if (!Shader::loadSources(shaderName, vert, frag))
+            return false;
+
+        vector<string> keywords;
+        parseFeatures(vert, keywords);
+        parseFeatures(frag, keywords);
+
+        int nextCustomBit = (int)sf_MaxFeatureBit;
+        for (string& keyword : keywords)
+        {
+            int bit = -1;
+            for (int i = 0; i < (int)sf_MaxFeatureBit; ++i)
+                if (keyword == FeatureMap[i]) { bit = i; break; }
+
+            if (bit == -1) {
+                if (nextCustomBit >= 32) {
+                    LogWarning("%s: too many feature keywords, ignoring '%s'", shaderName.c_str(), keyword.c_str());
+                    continue;
+                }
+                bit = nextCustomBit++;
+            }
+            Features.push_back({ move(keyword), 1u << bit });
+            DeclaredMask |= 1u << bit;
+        }
+        return true;
+    }
+
+    uint32_t ShaderVariants::featureBit(strview keyword) const
+    {
+        for (const Feature& f : Features)
+            if (keyword == f.name) return f.bit;
+        return 0;
+    }
+
+    string ShaderVariants::definitions(uint32_t featureMask) const
+    {
+        string defines;
+        for (const Feature& f : Features)
+        {
+            defines += "#define ";
+            defines += f.name;
+            defines += (featureMask & f.bit) ? " 1\n" : " 0\n";
+        }
+        return defines;
+    }
+
+    Shader* ShaderVariants::variant(uint32_t featureMask)
+    {
+        featureMask &= DeclaredMask; // undeclared features would only create duplicate variants
+        auto it = Variants.find(featureMask);
+        if (it != Variants.end())
+            return it->second.get();
+
+        auto shader = std::make_unique<Shader>();
+        if (!shader->loadShader(Name, definitions(featureMask), Mode))
+            LogError("%s: failed to load variant 0x%x", Name.c_str(), featureMask);
+
+        // failed variants are cached too, so we don't retry every frame; hotload() retries
+        Shader* result = shader.get();
+        Variants[featureMask] = move(shader);
+        return result;
+    }
+
+    void ShaderVariants::hotload()
+    {
+        for (auto& kv : Variants)
+            kv.second->hotload();
+    }
+
+    bool ShaderVariants::reload()
+    {
+        auto variants = move(Variants);
+        if (!load(Name, Mode)) {
+            Variants = move(variants);
+            return false;
+        }
+        for (auto& kv : variants)
+        {
+            uint32_t featureMask = kv.first & DeclaredMask;
+            kv.second->invalidateBinary();
+            kv.second->loadShader(Name, definitions(featureMask), Mode);
+            Variants.emplace(featureMask, move(kv.second));
+        }
+        return true;
+    }
+
+    void ShaderVariants::clear()
+    {
+        Variants.clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
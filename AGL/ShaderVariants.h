@@ -0,0 +1,91 @@
+#pragma once
+#include "Shader.h"
+#include <unordered_map>
+#include <memory>
+
+namespace AGL
+{
+    using std::unique_ptr;
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /** @brief Well known shader feature keywords, used as variant mask bits */
+    enum ShaderFeature : uint32_t
+    {
+        sf_HasTexture  = (1 << 0), // HAS_TEXTURE;  sample diffuseTex
+        sf_VertexColor = (1 << 1), // VERTEX_COLOR; multiply by vertex color attribute
+        sf_AlphaTest   = (1 << 2), // ALPHA_TEST;   discard transparent fragments
+        sf_Instanced   = (1 << 3), // INSTANCED;    apply a_Instance offset/scale and a_InstanceColor
+        sf_MaxFeatureBit = 4,      // custom keywords are assigned bits from here on
+    };
+
+
+    /**
+     * A set of specialized variants of a single shader.
+     *
+     * Shader sources declare the feature keywords they can be specialized on:
+     *
+     *     #pragma agl_features HAS_TEXTURE VERTEX_COLOR ALPHA_TEST
+     *
+     * and test them with `#if HAS_TEXTURE`. Each variant is compiled with every declared
+     * keyword defined as 0 or 1, on first request, and cached by its feature mask.
+     * Known keywords map to ShaderFeature bits, other keywords get the next free bits.
+     */
+    class AGL_API ShaderVariants
+    {
+        struct Feature
+        {
+            string   name;
+            uint32_t bit;
+        };
+
+        string Name;
+        ShaderCompileMode Mode = CompileAsync;
+        vector<Feature> Features; // declared feature keywords
+        uint32_t DeclaredMask = 0;
+        std::unordered_map<uint32_t, unique_ptr<Shader>> Variants;
+
+    public:
+        ShaderVariants() = default;
+
+        /**
+         * Reads the shader sources and parses the declared feature keywords.
+         * No variants are compiled until they are requested.
+         * @param mode Compile mode for new variants
+         */
+        bool load(const string& shaderName, ShaderCompileMode mode = CompileAsync);
+
+        const string& name() const { return Name; }
+
+        /** @return Mask of all feature bits declared by the shader sources */
+        uint32_t declaredMask() const { return DeclaredMask; }
+
+        /** @return Mask bit of the declared feature keyword, or 0 if the shader doesn't declare it */
+        uint32_t featureBit(strview keyword) const;
+
+        /**
+         * @return Shader specialized for `featureMask`, compiled on demand.
+         *         Features that the shader doesn't declare are ignored.
+         */
+        Shader* variant(uint32_t featureMask);
+
+        /** @return Number of variants that have been requested so far */
+        int numVariants() const { return (int)Variants.size(); }
+
+        /** @brief Hotloads all the compiled variants */
+        void hotload();
+
+        /**
+         * @brief Re-parses the feature keywords and recompiles all the requested variants.
+         * Shader pointers returned by variant() stay valid.
+         */
+        bool reload();
+
+        /** @brief Destroys all compiled variants */
+        void clear();
+
+        /** @return #define lines for the given feature mask */
+        string definitions(uint32_t featureMask) const;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,210 @@
+#include "StreamBuffer.h"
+#include "OpenGL.h"
+#include "GLState.h"
+#include "MeshOptimizer.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    StreamBuffer::~StreamBuffer()
+    {
+        destroy();
+    }
+
+    bool StreamBuffer::create(int bytesPerFrame)
+    {
+        destroy();
+        RegionSize = (bytesPerFrame + 255) & ~255;
+        const int totalSize = RegionSize * NumFrames;
+        BaseVertex = GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex;
+
+        glGenBuffers(1, &Buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+        if (GLEW_ARB_buffer_storage && glBufferStorage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+            Mapped = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+            if (!Mapped)
+                LogWarning("StreamBuffer: persistent mapping failed: %s", glGetErrorStr());
+        }
+        if (!Mapped) // fallback: CPU staging memory, flushed with glBufferSubData
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &Buffer); // buffer storage is immutable, so start over
+            glGenBuffers(1, &Buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+            glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+            Staging.resize((size_t)totalSize);
+            Mapped = Staging.data();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        Frame = 0;
+        Offset = Flushed = 0;
+        return true;
+    }
+
+    void StreamBuffer::destroy()
+    {
+        for (void*& fence : Fences) {
+            if (fence) glDeleteSync((GLsync)fence), fence = nullptr;
+        }
+        GLState& state = GLState::current();
+        for (auto& vao : VertexArrays) {
+            state.onVertexArrayDeleted(vao.second);
+            glDeleteVertexArrays(1, &vao.second);
+        }
+        VertexArrays.clear();
+        if (Buffer) {
+            if (persistent()) {
+                glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &Buffer), Buffer = 0;
+        }
+        Mapped = nullptr;
+        Staging.clear();
+        Staging.shrink_to_fit();
+        RegionSize = Offset = Flushed = 0;
+    }
+
+    void StreamBuffer::beginFrame()
+    {
+        if (!Buffer) return;
+        Frame = (Frame + 1) % NumFrames;
+        Offset = Flushed = 0;
+
+        if (GLsync fence = (GLsync)Fences[Frame])
+        {
+            // only blocks if the CPU is NumFrames ahead of the GPU
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            while (result == GL_TIMEOUT_EXPIRED)
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000/*1ms*/);
+            glDeleteSync(fence);
+            Fences[Frame] = nullptr;
+        }
+    }
+
+    void StreamBuffer::endFrame()
+    {
+        if (!Buffer) return;
+        if (Fences[Frame])
+            glDeleteSync((GLsync)Fences[Frame]);
+        Fences[Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    uint32_t StreamBuffer::vertexArray(const VertexDescr& layout)
+    {
+        for (auto& vao : VertexArrays)
+            if (vao.first == layout)
+                return vao.second;
+
+        // attributes start at offset 0, meshes select their vertices with baseVertex
+        uint32_t vao;
+        glGenVertexArrays(1, &vao);
+        GLState& state = GLState::current();
+        state.bindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+        layout.enableAttribs();
+        state.bindVertexArray(0);
+
+        VertexArrays.emplace_back(layout, vao);
+        return vao;
+    }
+
+    TransientMesh StreamBuffer::allocate(DrawMode mode, const VertexDescr& layout,
+                                         int numVerts, void** outVerts,
+                                         int numIndices, index_t** outIndices)
+    {
+        if (!Buffer || numVerts <= 0)
+            return {};
+
+        // vertices must start at a multiple of the stride from the buffer start,
+        // to be addressable by baseVertex
+        const int stride = layout.sizeOf;
+        const int regionStart = Frame * RegionSize;
+        const int vertexStart = ((regionStart + Offset + stride - 1) / stride) * stride - regionStart;
+        const int indexStart  = vertexStart + numVerts*stride;
+        const int end         = indexStart + numIndices*(int)sizeof(index_t);
+        if (end > RegionSize) {
+            LogWarning("StreamBuffer: frame region of %d bytes is full", RegionSize);
+            return {};
+        }
+        Offset = end;
+
+        TransientMesh mesh;
+        mesh.drawMode    = numIndices ? DrawIndexed : mode;
+        mesh.vertexArray = vertexArray(layout);
+        mesh.baseVertex  = (regionStart + vertexStart) / stride;
+        mesh.vertexCount = numVerts;
+        mesh.indexOffset = uint32_t(regionStart + indexStart);
+        mesh.indexCount  = numIndices;
+
+        *outVerts = Mapped + regionStart + vertexStart;
+        if (outIndices)
+            *outIndices = numIndices ? (index_t*)(Mapped + regionStart + indexStart) : nullptr;
+        return mesh;
+    }
+
+    TransientMesh StreamBuffer::submit(DrawMode mode, const VertexDescr& layout,
+                                       const void* verts, int numVerts,
+                                       const index_t* indices, int numIndices)
+    {
+        void* dstVerts; index_t* dstIndices;
+        TransientMesh mesh = allocate(mode, layout, numVerts, &dstVerts, numIndices, &dstIndices);
+        if (!mesh)
+            return mesh;
+
+        memcpy(dstVerts, verts, size_t(numVerts*layout.sizeOf));
+        if (numIndices)
+        {
+            if (BaseVertex) {
+                memcpy(dstIndices, indices, numIndices*sizeof(index_t));
+            }
+            else { // no glDrawElementsBaseVertex, so rebase the indices while copying
+                MeshOptimizer::rebaseIndices(dstIndices, indices, numIndices, (index_t)mesh.baseVertex);
+                mesh.baseVertex = 0;
+            }
+        }
+        return mesh;
+    }
+
+    void StreamBuffer::flush()
+    {
+        if (persistent() || Flushed == Offset)
+            return;
+        const int regionStart = Frame * RegionSize;
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, regionStart + Flushed, Offset - Flushed, Mapped + regionStart + Flushed);
+        Flushed = Offset;
+    }
+
+    void StreamBuffer::draw(const TransientMesh& mesh)
+    {
+        if (!mesh) return;
+        flush();
+
+        GLState::current().bindVertexArray(mesh.vertexArray);
+        if (mesh.drawMode == DrawIndexed)
+        {
+            void* indices = (void*)uintptr_t(mesh.indexOffset);
+            if (mesh.baseVertex)
+                glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, indices, mesh.baseVertex);
+            else
+                glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, indices);
+        }
+        else if (mesh.drawMode != DrawNone)
+        {
+            static constexpr GLenum modeMap[] = {
+                GL_NONE, GL_NONE, GL_TRIANGLES, GL_TRIANGLE_STRIP,
+                GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_POINTS,
+            };
+            glDrawArrays(modeMap[mesh.drawMode], mesh.baseVertex, mesh.vertexCount);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Shader.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Geometry that lives in a StreamBuffer until the end of the current frame
+     */
+    struct TransientMesh
+    {
+        DrawMode drawMode    = DrawNone;
+        uint32_t vertexArray = 0; // shared VAO of this vertex layout
+        int32_t  baseVertex  = 0; // first vertex in the stream buffer
+        int32_t  vertexCount = 0;
+        uint32_t indexOffset = 0; // byte offset of the first index in the stream buffer
+        int32_t  indexCount  = 0;
+
+        explicit operator bool() const { return vertexCount != 0; }
+        bool     operator!    () const { return vertexCount == 0; }
+    };
+
+
+    /**
+     * Frame-scoped allocator for immediate geometry that is rebuilt every frame.
+     *
+     * One large buffer is split into NumFrames regions. With GL_ARB_buffer_storage
+     * it is mapped once with GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT and callers write
+     * vertices directly into GPU visible memory. Each region is guarded by a fence, so
+     * the CPU only waits if it gets NumFrames ahead of the GPU. Meshes are drawn with a
+     * base vertex offset, so there are no per-frame GL allocations at all.
+     *
+     * Without buffer storage, writes go into a CPU staging copy of the region which
+     * is flushed with glBufferSubData before the next draw.
+     */
+    class AGL_API StreamBuffer
+    {
+    public:
+        static constexpr int NumFrames = 3;
+
+    private:
+        uint32_t Buffer = 0;
+        uint8_t* Mapped = nullptr;    // persistent mapping or staging memory
+        vector<uint8_t> Staging;      // fallback if persistent mapping is not supported
+        int RegionSize = 0;           // bytes per frame
+        int Frame  = 0;               // current frame region
+        int Offset = 0;               // next free byte in the current region
+        int Flushed = 0;              // staging bytes already flushed to the buffer
+        void* Fences[NumFrames] = {}; // GLsync of each region
+        bool BaseVertex = false;      // glDrawElementsBaseVertex is available
+        vector<std::pair<VertexDescr, uint32_t>> VertexArrays; // VAO for each vertex layout
+
+    public:
+        StreamBuffer() = default;
+        ~StreamBuffer();
+
+        StreamBuffer(const StreamBuffer&) = delete;
+        StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+        /** @param bytesPerFrame Maximum size of vertices and indices allocated in one frame */
+        bool create(int bytesPerFrame);
+        void destroy();
+
+        bool good() const { return Buffer != 0; }
+        /** @return TRUE if the buffer is persistently mapped */
+        bool persistent() const { return Mapped && Staging.empty(); }
+        /** @return FALSE if indices written into allocate() must be rebased by TransientMesh::baseVertex */
+        bool baseVertexSupported() const { return BaseVertex; }
+        /** @return Bytes left in the current frame */
+        int available() const { return RegionSize - Offset; }
+
+        /** @brief Moves to the next frame region, waits if the GPU still reads it */
+        void beginFrame();
+        /** @brief Fences the current frame region, call after all draws of this frame */
+        void endFrame();
+
+        /**
+         * Allocates a mesh for this frame and returns pointers where to write it.
+         * @return Empty mesh if the current frame region is full
+         */
+        TransientMesh allocate(DrawMode mode, const VertexDescr& layout,
+                               int numVerts, void** outVerts,
+                               int numIndices = 0, index_t** outIndices = nullptr);
+
+        /**
+         * Allocates the mesh and copies the vertices and indices straight into the
+         * mapped buffer, indices are rebased if base vertex draws are not supported
+         */
+        TransientMesh submit(DrawMode mode, const VertexDescr& layout,
+                             const void* verts, int numVerts,
+                             const index_t* indices = nullptr, int numIndices = 0);
+
+        /** @brief Draws a mesh which was allocated during this frame */
+        void draw(const TransientMesh& mesh);
+
+    private:
+        uint32_t vertexArray(const VertexDescr& layout);
+        void flush();
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -1,5 +1,6 @@
 #include "Texture.h"
 #include "OpenGL.h"
+#include "GLState.h"
 #include <rpp/file_io.h>
 
 namespace AGL
@@ -32,6 +33,7 @@ namespace AGL
     Texture::~Texture()
     {
         if (glTexture) {
+            GLState::current().onTextureDeleted(glTexture);
             glDeleteTextures(1, &glTexture);
         }
     }
@@ -78,6 +80,38 @@ namespace AGL
         return false;
     }
 
+    bool Texture::reload()
+    {
+        auto buf = rpp::file::read_all(texname);
+        if (!buf) {
+            LogWarning("failed to reload file '%s'", texname.c_str());
+            return false;
+        }
+        // decode first, so a broken file keeps the current texture
+        Bitmap bitmap;
+        if (!decodeBitmap(bitmap, buf.data(), buf.size(), getTextureHint(texname))) {
+            LogWarning("failed to decode reloaded file '%s', keeping the current texture", texname.c_str());
+            return false;
+        }
+        bool tiled = glTiled;
+        unload();
+        if (!load(bitmap))
+            return false;
+        if (tiled) enableTextureTiling(true);
+        return true;
+    }
+
+    bool Texture::loadFromMemory(const string& filename, const void* fileData, int numBytes)
+    {
+        if (glTexture) {
+            LogWarning("warning: tried to load already loaded texture with '%s'", filename.c_str());
+            return true; // we already have a texture; success.
+        }
+
+        texname = filename;
+        return loadBitmap(fileData, numBytes, getTextureHint(filename));
+    }
+
     bool Texture::loadBitmap(const void* bitmapData, int numBytes, TextureHint hint)
     {
         if (glTexture) {
@@ -86,13 +120,19 @@ namespace AGL
         }
 
         Bitmap bitmap;
+        decodeBitmap(bitmap, bitmapData, numBytes, hint);
+        return load(bitmap);
+    }
+
+    bool Texture::decodeBitmap(Bitmap& bitmap, const void* bitmapData, int numBytes, TextureHint hint)
+    {
         switch (hint) {
             case TexHintPNG: bitmap.loadPNG(bitmapData, numBytes); break;
             case TexHintJPG: bitmap.loadJPG(bitmapData, numBytes); break;
             case TexHintBMP: bitmap.loadBMP(bitmapData, numBytes); break;
             default:         LogError("error: unsupported image format: %d", hint);
         }
-        return load(bitmap);
+        return (bool)bitmap;
     }
 
     bool Texture::load(const void* data, int width, int height, int channels, int stride)
@@ -120,6 +160,7 @@ namespace AGL
     void Texture::unload()
     {
         if (glTexture) {
+            GLState::current().onTextureDeleted(glTexture);
             glDeleteTextures(1, &glTexture);
             glTexture = 0, glWidth = 0, glHeight = 0, glChannels = 0;
             glTiled = false;
@@ -135,21 +176,21 @@ namespace AGL
         glTiled = enable;
         if (glTexture)
         {
-            glBindTexture(GL_TEXTURE_2D, glTexture);
+            bind();
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, enable ? GL_REPEAT : GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, enable ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            unbind();
         }
     }
 
     void Texture::bind()
     {
-        glBindTexture(GL_TEXTURE_2D, glTexture);
+        GLState::current().bindTexture(0, glTexture);
     }
 
     void Texture::unbind()
     {
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLState::current().bindTexture(0, 0);
     }
 
     int Texture::getTextureDataSize() const
@@ -241,7 +282,8 @@ namespace AGL
             LogError("error: glGenTexture failed. Did you bind a valid GL context?");
         }
 
-        glBindTexture(GL_TEXTURE_2D, glTexture);
+        GLState& state = GLState::current();
+        state.bindTexture(0, glTexture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -261,13 +303,14 @@ namespace AGL
 
         if (const char* err = glGetErrorStr()) {
             LogError("glTexImage2D failed: %s", err);
+            state.onTextureDeleted(glTexture);
             glDeleteTextures(1, &glTexture);
             return 0;
         }
 
         if (pow2) glGenerateMipmap(GL_TEXTURE_2D); // generate mipmaps
 
-        glBindTexture(GL_TEXTURE_2D, 0); // unbind the texture
+        state.bindTexture(0, 0); // unbind the texture
         return glTexture;
     }
 
@@ -76,6 +76,7 @@ namespace AGL
 
         int width()  const { return glWidth; }
         int height() const { return glHeight; }
+        int channels() const { return glChannels; }
         const string& name() const { return texname; }
         Vector2 size() const { return Vector2{ (float)glWidth, (float)glHeight }; }
         uint nativeHandle() const { return glTexture; }
@@ -85,6 +86,18 @@ namespace AGL
          */
         bool loadFromFile(const string& filename);
 
+        /**
+         * Loads an image file that has already been read into memory,
+         * image format is detected from the `filename` extension
+         */
+        bool loadFromMemory(const string& filename, const void* fileData, int numBytes);
+
+        /**
+         * Reloads the texture from the file it was loaded from, used for hot-reloading.
+         * On failure the current texture is kept
+         */
+        bool reload();
+
         /**
          * Loads image data such as JPG, PNG, BMP
          * into raw texture data into GPU texture memory
@@ -92,6 +105,9 @@ namespace AGL
          */
         bool loadBitmap(const void* bitmapData, int numBytes, TextureHint hint);
 
+        /** Decodes JPG, PNG, BMP data into `bitmap` without touching any GL texture */
+        static bool decodeBitmap(Bitmap& bitmap, const void* bitmapData, int numBytes, TextureHint hint);
+
         /**
          * Loads raw data into GPU texture memory
          * @note each row must be aligned to 4-byte boundary
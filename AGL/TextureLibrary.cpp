@@ -0,0 +1,111 @@
+#include "TextureLibrary.h"
+#include "Hash.h"
+#include <rpp/file_io.h>
+#include <rpp/debugging.h>
+#include <unordered_set>
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    string TextureLibrary::pathKey(const string& filename, TextureOptions options)
+    {
+        string key;
+        key.reserve(filename.size() + 2);
+        key += filename;
+        key += '|';
+        key += char('0' + options.flags());
+        return key;
+    }
+
+    TextureHandle TextureLibrary::find(const string& filename, TextureOptions options) const
+    {
+        auto it = byPath.find(pathKey(filename, options));
+        return it != byPath.end() ? it->second.lock() : TextureHandle{};
+    }
+
+    TextureHandle TextureLibrary::load(const string& filename, TextureOptions options)
+    {
+        string key = pathKey(filename, options);
+        weak_ptr<Texture>& entry = byPath[key];
+        if (TextureHandle existing = entry.lock()) {
+            ++numHits;
+            return existing;
+        }
+
+        auto buf = rpp::file::read_all(filename);
+        if (!buf) {
+            LogWarning("failed to load file '%s'", filename.c_str());
+            return {};
+        }
+
+        uint64_t contentKey = 0;
+        if (contentDedup)
+        {
+            contentKey = fnv1a64(buf.data(), size_t(buf.size())) ^ uint64_t(options.flags());
+            auto it = byContent.find(contentKey);
+            if (it != byContent.end()) {
+                if (TextureHandle existing = it->second.lock()) {
+                    ++numHits, ++numDeduped;
+                    entry = existing;
+                    return existing;
+                }
+            }
+        }
+
+        ++numMisses;
+
+        // GPUCompression is a global load flag, so we override it just for this load
+        bool compression = Texture::GPUCompression;
+        Texture::GPUCompression = options.gpuCompression;
+        auto texture = std::make_shared<Texture>();
+        bool loaded = texture->loadFromMemory(filename, buf.data(), buf.size());
+        Texture::GPUCompression = compression;
+
+        if (!loaded) {
+            byPath.erase(key);
+            return {};
+        }
+        if (options.tiled)
+            texture->enableTextureTiling(true);
+
+        entry = texture;
+        if (contentDedup)
+            byContent[contentKey] = texture;
+        return texture;
+    }
+
+    template<class Map> static int purgeExpired(Map& map)
+    {
+        int removed = 0;
+        for (auto it = map.begin(); it != map.end(); )
+        {
+            if (it->second.expired()) it = map.erase(it), ++removed;
+            else ++it;
+        }
+        return removed;
+    }
+
+    int TextureLibrary::purge()
+    {
+        return purgeExpired(byPath) + purgeExpired(byContent);
+    }
+
+    void TextureLibrary::clear()
+    {
+        byPath.clear();
+        byContent.clear();
+    }
+
+    int TextureLibrary::numAlive() const
+    {
+        // aliases from content dedup share a single texture, so don't count them twice
+        std::unordered_set<const Texture*> alive;
+        for (auto& kv : byPath)
+            if (TextureHandle tex = kv.second.lock())
+                alive.insert(tex.get());
+        return (int)alive.size();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "Texture.h"
+#include <memory>
+#include <unordered_map>
+
+namespace AGL
+{
+    using std::shared_ptr;
+    using std::weak_ptr;
+    using std::unordered_map;
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /** @brief Refcounted texture handle, the GL texture is freed with the last handle */
+    using TextureHandle = shared_ptr<Texture>;
+
+
+    /** @brief Load options which are part of the texture cache key */
+    struct TextureOptions
+    {
+        bool gpuCompression = false; // @see Texture::GPUCompression
+        bool tiled          = false; // @see Texture::enableTextureTiling()
+
+        int flags() const { return (gpuCompression ? 1 : 0) | (tiled ? 2 : 0); }
+    };
+
+
+    /**
+     * Shares GPU textures between everyone who loads the same image.
+     * Textures are keyed by file path + load options, so repeated loads are a
+     * single hash lookup. With `contentDedup` enabled, identical image files under
+     * different names will also share a single GL texture.
+     *
+     * @note The library only holds weak references, a texture is released
+     *       as soon as the last TextureHandle goes out of scope.
+     */
+    class AGL_API TextureLibrary
+    {
+        unordered_map<string,   weak_ptr<Texture>> byPath;    // "path|flags" -> texture
+        unordered_map<uint64_t, weak_ptr<Texture>> byContent; // hash(file data)^flags -> texture
+        int numHits    = 0;
+        int numMisses  = 0;
+        int numDeduped = 0;
+
+    public:
+
+        // if TRUE, file contents are hashed to detect duplicate images under different names
+        bool contentDedup = false;
+
+        TextureLibrary() = default;
+        TextureLibrary(const TextureLibrary&) = delete; // NOCOPY
+        TextureLibrary& operator=(const TextureLibrary&) = delete;
+
+        /**
+         * Gets a shared texture or loads it from file if it isn't resident yet
+         * @return Shared texture handle or NULL if loading failed
+         */
+        TextureHandle load(const string& filename, TextureOptions options = {});
+
+        /**
+         * @return Shared texture handle if it's already resident, NULL otherwise
+         */
+        TextureHandle find(const string& filename, TextureOptions options = {}) const;
+
+        /**
+         * Removes all expired weak references from the lookup tables
+         * @return Number of entries removed
+         */
+        int purge();
+
+        /** @brief Drops all lookup entries. Existing handles remain valid. */
+        void clear();
+
+        /** @return Number of textures that are still alive */
+        int numAlive() const;
+
+        int hits()    const { return numHits; }    // load() calls served from cache
+        int misses()  const { return numMisses; }  // load() calls that decoded a file
+        int deduped() const { return numDeduped; } // misses that were resolved by content hash
+
+    private:
+        static string pathKey(const string& filename, TextureOptions options);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,77 @@
+#include "UniformBuffer.h"
+#include "OpenGL.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    UniformBuffer::~UniformBuffer()
+    {
+        destroy();
+    }
+
+    bool UniformBuffer::supported()
+    {
+    #if __IPHONEOS__ || __EMSCRIPTEN__
+        return false;
+    #else
+        return GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+    #endif
+    }
+
+    bool UniformBuffer::create(ShaderBlock binding, int blockSize, int numBlocks)
+    {
+        destroy();
+        if (!supported())
+            return false;
+
+        int alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment <= 0) alignment = 256;
+
+        Binding   = (uint32_t)binding;
+        BlockSize = ((blockSize + alignment - 1) / alignment) * alignment;
+        Capacity  = BlockSize * (numBlocks > 0 ? numBlocks : 1);
+        Offset    = 0;
+
+        glGenBuffers(1, &Buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+        glBufferData(GL_UNIFORM_BUFFER, Capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return true;
+    }
+
+    void UniformBuffer::destroy()
+    {
+        if (Buffer) {
+            glDeleteBuffers(1, &Buffer);
+            Buffer = 0;
+        }
+        BlockSize = Capacity = Offset = 0;
+    }
+
+    void UniformBuffer::reset()
+    {
+        if (!Buffer) return;
+        glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+        glBufferData(GL_UNIFORM_BUFFER, Capacity, nullptr, GL_STREAM_DRAW);
+        Offset = 0;
+    }
+
+    void UniformBuffer::push(const void* block, int numBytes)
+    {
+        if (!Buffer) return;
+        Assert(numBytes <= BlockSize, "UniformBuffer::push block is bigger than the created blockSize");
+
+        if (Offset + BlockSize > Capacity)
+            reset(); // all slots used: orphan and start over
+        else
+            glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+
+        glBufferSubData(GL_UNIFORM_BUFFER, Offset, numBytes, block);
+        glBindBufferRange(GL_UNIFORM_BUFFER, Binding, Buffer, Offset, BlockSize);
+        Offset += BlockSize;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
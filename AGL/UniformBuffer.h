@@ -0,0 +1,77 @@
+#pragma once
+#include "Shader.h"
+
+namespace AGL
+{
+    ////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * std140 layout of the FrameData uniform block, bound to ub_FrameData.
+     * Uploaded once per frame by SceneRoot::Render
+     */
+    struct FrameUniforms
+    {
+        Matrix4 View;
+        Matrix4 Projection;
+        Matrix4 ViewProjection;
+        Vector4 Time; // x: seconds since GLCore creation, y: DeltaTime
+    };
+
+    /**
+     * std140 layout of the ObjectData uniform block, bound to ub_ObjectData.
+     * Uploaded once per draw call
+     */
+    struct ObjectUniforms
+    {
+        Matrix4 Model; // world transform of the drawn object
+    };
+
+    /**
+     * A std140 uniform buffer object that is attached to a fixed block binding point.
+     *
+     * The buffer is split into `numBlocks` slots which are written sequentially
+     * with push(), so consecutive draws never overwrite a block that an earlier
+     * draw in the same frame is still reading. When all the slots are used up,
+     * the storage is orphaned and writing starts over from the first slot.
+     */
+    class AGL_API UniformBuffer
+    {
+        uint32_t Buffer    = 0;
+        uint32_t Binding   = 0;
+        int      BlockSize = 0; // size of one block, padded to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+        int      Capacity  = 0; // total buffer size in bytes
+        int      Offset    = 0; // next free write offset
+
+    public:
+        UniformBuffer() = default;
+        ~UniformBuffer();
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+        /** @return TRUE if the current context supports uniform buffer objects */
+        static bool supported();
+
+        /**
+         * Creates the buffer storage
+         * @param binding Uniform block binding point, such as ub_FrameData
+         * @param blockSize Size of the std140 block struct
+         * @param numBlocks Number of blocks that can be pushed before orphaning the storage
+         */
+        bool create(ShaderBlock binding, int blockSize, int numBlocks = 1);
+        void destroy();
+
+        bool good() const { return Buffer != 0; }
+        uint32_t binding() const { return Binding; }
+
+        /** @brief Orphans the storage, subsequent writes won't wait for in-flight draws */
+        void reset();
+
+        /** @brief Writes the block into the next free slot and binds that range to binding() */
+        void push(const void* block, int numBytes);
+
+        template<class T> void push(const T& block) { push(&block, (int)sizeof(T)); }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,74 @@
+#include <AGL/BatchRenderer.h>
+#include <rpp/tests.h>
+using namespace AGL;
+
+TestImpl(test_batch_renderer)
+{
+    TestInit(test_batch_renderer)
+    {
+    }
+
+    static MeshArena::DrawRange Range(uint32_t vertexArray, int baseVertex, int firstIndex, int numIndices)
+    {
+        MeshArena::DrawRange range;
+        range.vertexArray = vertexArray;
+        range.baseVertex  = baseVertex;
+        range.firstIndex  = firstIndex;
+        range.numIndices  = numIndices;
+        return range;
+    }
+
+    static Matrix4 Translate(float x)
+    {
+        Matrix4 m = Matrix4::Identity();
+        m.m[12] = x;
+        return m;
+    }
+
+    TestCase(draws_are_grouped_by_shader_texture_and_pool)
+    {
+        Shader opaque, textured;
+        BatchRenderer batches;
+        batches.queue(Range(1, 0,   0, 36), opaque,   nullptr, Translate(0.0f), Color::White());
+        batches.queue(Range(1, 24, 36, 12), textured, nullptr, Translate(1.0f), Color::Red());
+        batches.queue(Range(1, 30, 48,  6), opaque,   nullptr, Translate(2.0f), Color::Green());
+        batches.queue(Range(2, 0,   0,  3), opaque,   nullptr, Translate(3.0f), Color::Blue());
+        AssertThat(batches.numBatches(), 3);
+
+        AssertThat(batches.prepare(), 4);
+        const vector<BatchRenderer::DrawCommand>& commands = batches.commands();
+        const vector<BatchRenderer::DrawData>& draws = batches.draws();
+        AssertThat((int)commands.size(), 4);
+        AssertThat((int)draws.size(), 4);
+
+        // batch order: {opaque, pool 1}, {textured, pool 1}, {opaque, pool 2}
+        AssertThat(commands[0].firstIndex, 0u);
+        AssertThat(commands[0].count, 36u);
+        AssertThat(commands[1].firstIndex, 48u);
+        AssertThat(commands[1].baseVertex, 30);
+        AssertThat(commands[2].firstIndex, 36u);
+        AssertThat(commands[3].count, 3u);
+        AssertThat(draws[1].Model.m[12], 2.0f);
+        AssertThat(draws[2].Model.m[12], 1.0f);
+        AssertThat(draws[3].Model.m[12], 3.0f);
+
+        // every command reads its own DrawData through a_DrawId
+        for (int i = 0; i < (int)commands.size(); ++i)
+        {
+            AssertThat(commands[i].baseInstance, (uint32_t)i);
+            AssertThat(commands[i].instanceCount, 1u);
+        }
+    }
+
+    TestCase(prepare_restarts_the_concatenation)
+    {
+        Shader shader;
+        BatchRenderer batches;
+        batches.queue(Range(1, 0, 0, 3), shader, nullptr, Translate(0.0f), Color::White());
+        batches.queue(Range(1, 3, 3, 3), shader, nullptr, Translate(1.0f), Color::White());
+        AssertThat(batches.prepare(), 2);
+        AssertThat(batches.prepare(), 2);
+        AssertThat(batches.commands()[1].baseInstance, 1u);
+        AssertThat(batches.numBatches(), 1);
+    }
+};
@@ -0,0 +1,148 @@
+#include <AGL/GLDraw.h>
+#include <rpp/tests.h>
+#include <rpp/timer.h>
+using namespace AGL;
+
+TestImpl(test_gldraw)
+{
+    vector<Vector3> A, B;
+
+    TestInit(test_gldraw)
+    {
+    }
+
+    // pseudo-random trajectory-like segments
+    void CreateSegments(int count)
+    {
+        A.resize(count);
+        B.resize(count);
+        Vector3 p = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < count; ++i)
+        {
+            A[i] = p;
+            p.x += float((i * 7919) % 13) - 6.0f;
+            p.y += float((i * 104729) % 7) - 3.0f;
+            p.z += float((i * 1299709) % 11) - 5.0f;
+            B[i] = p;
+        }
+    }
+
+    static bool NearlyEqual(const vector<Vertex3Color>& a, const vector<Vertex3Color>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (fabsf(a[i].x - b[i].x) > 0.001f || fabsf(a[i].y - b[i].y) > 0.001f ||
+                fabsf(a[i].z - b[i].z) > 0.001f || a[i].r != b[i].r || a[i].g != b[i].g ||
+                a[i].b != b[i].b || a[i].a != b[i].a)
+                return false;
+        return true;
+    }
+
+    TestCase(bulk_lines_match_line)
+    {
+        CreateSegments(100);
+        GLDraw3D single, bulk;
+        single.Line({ 1.0f, 2.0f, 3.0f }, { 4.0f, 5.0f, 6.0f }, 0.5f, Color::White());
+        for (int i = 0; i < (int)A.size(); ++i)
+            single.Line(A[i], B[i], 0.25f, Color::Red(), Color::Blue());
+
+        bulk.Line({ 1.0f, 2.0f, 3.0f }, { 4.0f, 5.0f, 6.0f }, 0.5f, Color::White());
+        bulk.Lines(A, B, 0.25f, Color::Red(), Color::Blue());
+
+        AssertTrue(NearlyEqual(single.Vertices(), bulk.Vertices()));
+        AssertTrue(single.Indices() == bulk.Indices());
+    }
+
+    TestCase(bulk_boxes_match_box)
+    {
+        vector<BoundingBox> boxes;
+        for (int i = 0; i < 20; ++i)
+            boxes.push_back({ { float(i), 0.0f, -1.0f }, { float(i) + 0.5f, 2.0f, 1.0f } });
+
+        GLDraw3D single, bulk;
+        for (const BoundingBox& box : boxes)
+        {
+            single.Box(box.min, box.max, Color::Green());
+            single.HollowBox(box.min, box.max, 0.1f, Color::Green());
+        }
+        for (const BoundingBox& box : boxes)
+        {
+            bulk.Boxes({ &box, 1 }, Color::Green());
+            bulk.HollowBoxes({ &box, 1 }, 0.1f, Color::Green());
+        }
+        AssertTrue(NearlyEqual(single.Vertices(), bulk.Vertices()));
+        AssertTrue(single.Indices() == bulk.Indices());
+
+        GLDraw3D boxesOnly;
+        boxesOnly.Boxes(boxes, Color::Green());
+        AssertThat((int)boxesOnly.Vertices().size(), 20*8);
+        AssertThat((int)boxesOnly.Indices().size(), 20*36);
+    }
+
+    TestCase(bulk_lines_benchmark)
+    {
+        constexpr int numSegments = 500'000;
+        CreateSegments(numSegments);
+        GLDraw3D perCallDraw, bulkDraw; // both start from empty storage
+
+        rpp::Timer perCall;
+        for (int i = 0; i < numSegments; ++i)
+            perCallDraw.Line(A[i], B[i], 0.1f, Color::White());
+        const double perCallSeconds = perCall.elapsed();
+
+        rpp::Timer bulk;
+        bulkDraw.Lines(A, B, 0.1f, Color::White());
+        const double bulkSeconds = bulk.elapsed();
+
+        printf("GLDraw3D Line():  %.1fM segments/s\n", numSegments / perCallSeconds / 1e6);
+        printf("GLDraw3D Lines(): %.1fM segments/s\n", numSegments / bulkSeconds / 1e6);
+        AssertThat(bulkDraw.Vertices().size(), perCallDraw.Vertices().size());
+    }
+
+    TestCase(parallel_build_matches_serial)
+    {
+        CreateSegments(20'000);
+        GLDraw3D serial;
+        for (int i = 0; i < (int)A.size(); ++i)
+            serial.Line(A[i], B[i], 0.1f, Color::White());
+
+        // the same workers are reused for every frame
+        ParallelDraw3D parallel { 4 };
+        for (int frame = 0; frame < 3; ++frame)
+        {
+            parallel.Clear();
+            parallel.Build((int)A.size(), [&](GLDraw3D& shard, int i) {
+                shard.Line(A[i], B[i], 0.1f, Color::White());
+            });
+            AssertThat(parallel.NumVertices(), (int)serial.Vertices().size());
+
+            GLDraw3D merged;
+            parallel.Merge(merged);
+            AssertTrue(NearlyEqual(serial.Vertices(), merged.Vertices()));
+            AssertTrue(serial.Indices() == merged.Indices());
+        }
+    }
+
+    TestCase(cached_spheres_are_offset)
+    {
+        GLDraw3D draw;
+        draw.Sphere({ 0.0f, 0.0f, 0.0f }, 1.0f, Color::White());
+        const int firstVertices = (int)draw.Vertices().size();
+        const int firstIndices  = (int)draw.Indices().size();
+        draw.Sphere({ 10.0f, 0.0f, 0.0f }, 2.0f, Color::Red());
+
+        // the second sphere must only reference its own vertices
+        AssertThat((int)draw.Vertices().size(), firstVertices * 2);
+        for (int i = firstIndices; i < (int)draw.Indices().size(); ++i)
+            AssertLess((int)draw.Indices()[i] - firstVertices, firstVertices);
+        for (int i = firstIndices; i < (int)draw.Indices().size(); ++i)
+            AssertLess(firstVertices - 1, (int)draw.Indices()[i]);
+
+        const Vertex3Color& v = draw.Vertices()[firstVertices + 5];
+        const float dx = v.x - 10.0f;
+        AssertLess(fabsf(sqrtf(dx*dx + v.y*v.y + v.z*v.z) - 2.0f), 0.0001f);
+        AssertThat(v.r, 1.0f);
+        AssertThat(v.g, 0.0f);
+    }
+};
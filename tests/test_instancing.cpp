@@ -0,0 +1,46 @@
+#include <AGL/Shader.h>
+#include <rpp/tests.h>
+#include <cstddef>
+using namespace AGL;
+
+TestImpl(test_instancing)
+{
+    TestInit(test_instancing)
+    {
+    }
+
+    TestCase(instance_layout_is_packed)
+    {
+        AssertThat((int)sizeof(InstanceOffsetColor), 20);
+        AssertThat((int)offsetof(InstanceOffsetColor, scale), 12);
+        AssertThat((int)offsetof(InstanceOffsetColor, r), 16);
+
+        const VertexDescr layout = InstanceOffsetColor::layout();
+        AssertThat(layout.sizeOf, 20);
+
+        const VertexDescrElem& offsetScale = layout.items[0];
+        AssertThat((int)offsetScale.attr, (int)a_Instance);
+        AssertThat((int)offsetScale.size, 4);
+        AssertThat((int)offsetScale.type, (int)vt_Float);
+        AssertThat((int)offsetScale.norm, 0);
+        AssertThat(offsetScale.bytes(), 16);
+
+        const VertexDescrElem& color = layout.items[1];
+        AssertThat((int)color.attr, (int)a_InstanceColor);
+        AssertThat((int)color.size, 4);
+        AssertThat((int)color.type, (int)vt_UByte);
+        AssertThat((int)color.norm, (int)Normalized);
+        AssertThat(color.bytes(), 4);
+
+        AssertThat((int)layout.items[2].size, 0);
+    }
+
+    TestCase(set_instances_requires_a_created_mesh)
+    {
+        vector<InstanceOffsetColor> instances(3);
+        VertexBuffer mesh;
+        mesh.setInstances(instances);
+        AssertFalse(mesh.instanced());
+        AssertThat(mesh.instances(), 0);
+    }
+};
@@ -0,0 +1,126 @@
+#include <AGL/MeshFile.h>
+#include <rpp/file_io.h>
+#include <rpp/tests.h>
+using namespace AGL;
+
+TestImpl(test_mesh_file)
+{
+    static constexpr const char* Path = "test_mesh_file.aglmesh";
+
+    TestInit(test_mesh_file)
+    {
+    }
+
+    static bool WriteFile(const MeshFileHeader& h, size_t fileSize)
+    {
+        vector<uint8_t> data(fileSize, 0);
+        memcpy(data.data(), &h, sizeof(h));
+        rpp::file f { string{Path}, rpp::CREATENEW };
+        return f.write(data.data(), (int)data.size()) == (int)data.size();
+    }
+
+    static MeshFileHeader ValidHeader()
+    {
+        MeshFileHeader h {};
+        h.magic        = MeshFileHeader::Magic;
+        h.version      = MeshFileHeader::Version;
+        h.vertexSize   = sizeof(Vertex3UV);
+        h.attributes[0] = { a_Position, 3, vt_Float, 0 };
+        h.attributes[1] = { a_Coord, 2, vt_Float, 0 };
+        h.drawMode     = DrawIndexed;
+        h.indexSize    = 2;
+        h.numVertices  = 3;
+        h.numIndices   = 3;
+        h.vertexOffset = 256;
+        h.indexOffset  = 256 + 3 * sizeof(Vertex3UV);
+        return h;
+    }
+
+    TestCase(save_open_roundtrip)
+    {
+        vector<Vertex3UV> verts = {
+            { -1.0f, 0.0f, 2.0f, 0.0f, 0.0f },
+            {  3.0f, 1.0f, 0.0f, 1.0f, 0.0f },
+            {  0.0f, 4.0f, -5.0f, 1.0f, 1.0f },
+            {  1.0f, 1.0f, 1.0f, 0.0f, 1.0f },
+        };
+        vector<index_t> indices = { 0, 1, 2, 0, 2, 3, 0, 1, 3 };
+        vector<MeshLod> lods(2);
+        lods[0].numIndices = 9;
+        lods[1].firstIndex = 6;
+        lods[1].numIndices = 3;
+        lods[1].error = 0.5f;
+        AssertTrue(MeshFile::save(Path, verts, indices, lods));
+
+        MeshFile file;
+        AssertTrue(file.open(Path));
+        AssertThat(file.numVertices(), 4);
+        AssertThat(file.numIndices(), 9);
+        AssertThat(file.indexSize(), 2);
+        AssertThat((int)file.mode(), (int)DrawIndexed);
+        AssertThat(file.numLods(), 2);
+        AssertThat(file.lod(1).firstIndex, 6u);
+        AssertThat(file.lod(1).numIndices, 3u);
+        AssertThat(file.lod(1).error, 0.5f);
+
+        const MeshFileHeader& h = file.header();
+        AssertThat(h.boundsMin[0], -1.0f);
+        AssertThat(h.boundsMin[2], -5.0f);
+        AssertThat(h.boundsMax[0], 3.0f);
+        AssertThat(h.boundsMax[1], 4.0f);
+
+        VertexDescr expected = Vertex3UV::layout();
+        VertexDescr layout = file.layout();
+        AssertThat(layout.sizeOf, expected.sizeOf);
+        for (int i = 0; i < 4; ++i)
+        {
+            AssertThat(layout.items[i].attr, expected.items[i].attr);
+            AssertThat(layout.items[i].size, expected.items[i].size);
+            AssertThat(layout.items[i].type, expected.items[i].type);
+            AssertThat(layout.items[i].norm, expected.items[i].norm);
+        }
+
+        AssertTrue(memcmp(file.vertices(), verts.data(), verts.size() * sizeof(Vertex3UV)) == 0);
+        const uint16_t* idx = (const uint16_t*)file.indices();
+        for (size_t i = 0; i < indices.size(); ++i)
+            AssertThat((index_t)idx[i], indices[i]);
+        file.close();
+        rpp::delete_file(Path);
+    }
+
+    TestCase(corrupted_headers_are_rejected)
+    {
+        const size_t fileSize = 256 + 3 * sizeof(Vertex3UV) + 3 * 2;
+        MeshFile file;
+
+        AssertTrue(WriteFile(ValidHeader(), fileSize));
+        AssertTrue(file.open(Path));
+        file.close();
+
+        MeshFileHeader h = ValidHeader();
+        h.vertexSize = 0;
+        AssertTrue(WriteFile(h, fileSize));
+        AssertFalse(file.open(Path));
+
+        h = ValidHeader();
+        h.vertexOffset = ~uint64_t(0) - 8; // offset + size would wrap around
+        AssertTrue(WriteFile(h, fileSize));
+        AssertFalse(file.open(Path));
+
+        h = ValidHeader();
+        h.numIndices = 4; // index blob runs past the end of the file
+        AssertTrue(WriteFile(h, fileSize));
+        AssertFalse(file.open(Path));
+
+        h = ValidHeader();
+        h.attributes[1].type = 42;
+        AssertTrue(WriteFile(h, fileSize));
+        AssertFalse(file.open(Path));
+
+        h = ValidHeader();
+        h.attributes[1].size = 4; // 28 bytes of attributes in a 20 byte vertex
+        AssertTrue(WriteFile(h, fileSize));
+        AssertFalse(file.open(Path));
+        rpp::delete_file(Path);
+    }
+};
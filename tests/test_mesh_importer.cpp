@@ -0,0 +1,215 @@
+#include <AGL/MeshImporter.h>
+#include <rpp/tests.h>
+using namespace AGL;
+
+TestImpl(test_mesh_importer)
+{
+    TestInit(test_mesh_importer)
+    {
+    }
+
+    static float ParseFloat(const char* str)
+    {
+        return MeshImporter::parseFloat(str, str + strlen(str));
+    }
+
+    TestCase(parse_float)
+    {
+        AssertThat(ParseFloat("1.5"), 1.5f);
+        AssertThat(ParseFloat(" -0.25"), -0.25f);
+        AssertThat(ParseFloat("3e2"), 300.0f);
+        AssertThat(ParseFloat("1.0E-3"), 0.001f);
+        AssertThat(ParseFloat("0.000001234"), 0.000001234f);
+        AssertThat(ParseFloat("abc"), 0.0f);
+    }
+
+    TestCase(obj_quad_is_triangulated)
+    {
+        const char obj[] =
+            "# quad\n"
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+            "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+            "f 1/1 2/2 3/3 4/4\n"
+            "f -4/-4 -2/-2 -1/-1\n";
+        ImportedMesh mesh;
+        AssertTrue(MeshImporter::loadObj(obj, sizeof(obj) - 1, mesh, 4));
+        AssertFalse(mesh.hasColors);
+        AssertTrue(mesh.hasCoords);
+        AssertThat(mesh.numVertices(), 4);
+        AssertThat(mesh.numTriangles(), 3);
+        AssertThat(mesh.indices[5], 3u);
+        AssertThat(mesh.indices[8], 3u);
+        AssertThat(mesh.vertices[2].u, 1.0f);
+        AssertThat(mesh.vertices[0].nz, 1.0f); // generated normal
+    }
+
+    TestCase(ply_ascii_colored_points)
+    {
+        const char ply[] =
+            "ply\n"
+            "format ascii 1.0\n"
+            "element vertex 3\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+            "end_header\n"
+            "0 0 0 255 0 0\n"
+            "1 2 3 0 255 0\n"
+            "4 5 6 0 0 255\n";
+        ImportedMesh mesh;
+        AssertTrue(MeshImporter::loadPly(ply, sizeof(ply) - 1, mesh, 2));
+        AssertTrue(mesh.hasColors);
+        AssertThat(mesh.mode(), DrawPoints);
+        AssertThat(mesh.numVertices(), 3);
+        AssertThat(mesh.colorVertices[1].y, 2.0f);
+        AssertThat(mesh.colorVertices[1].g, 1.0f);
+        AssertThat(mesh.colorVertices[2].r, 0.0f);
+    }
+
+    TestCase(obj_unreferenced_coords_are_ignored)
+    {
+        const char obj[] =
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\n"
+            "vt 0.5 0.5\nvt 0.7 0.7\n"
+            "f 1 2 3\n";
+        ImportedMesh mesh;
+        AssertTrue(MeshImporter::loadObj(obj, sizeof(obj) - 1, mesh, 1));
+        AssertFalse(mesh.hasCoords);
+        AssertThat(mesh.vertices[1].u, 0.0f);
+        AssertThat(mesh.vertices[1].v, 0.0f);
+    }
+
+    // grid of `n*n` quads, each row of faces references the previous two vertex rows
+    // with negative indices, so faces in one parser chunk point into the previous chunk
+    static string CreateGridObj(int n)
+    {
+        string obj;
+        char line[128];
+        for (int y = 0; y <= n; ++y)
+        {
+            for (int x = 0; x <= n; ++x)
+            {
+                snprintf(line, sizeof(line), "v %d.25 %d.5 0.125\nvn 0 0 1\n", x, y);
+                obj += line;
+            }
+            if (y == 0) continue;
+            const int row = n + 1;
+            for (int x = 0; x < n; ++x)
+            {
+                // relative to the last vertex: current row starts at -row, previous at -2*row
+                const int a = -2*row + x, b = a + 1, c = -row + x, d = c + 1;
+                snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d %d//%d\n", a, a, b, b, d, d, c, c);
+                obj += line;
+            }
+        }
+        return obj;
+    }
+
+    TestCase(obj_multithreaded_matches_single_thread)
+    {
+        const string obj = CreateGridObj(400); // ~6 MB, many 256 KB parser chunks
+        AssertLess(size_t(4 * 1024 * 1024), obj.size());
+
+        ImportedMesh single, multi;
+        AssertTrue(MeshImporter::loadObj(obj.data(), obj.size(), single, 1));
+        AssertTrue(MeshImporter::loadObj(obj.data(), obj.size(), multi, 8));
+        AssertThat(single.numVertices(), 401*401);
+        AssertThat(single.numTriangles(), 400*400*2);
+        AssertThat(multi.numVertices(), single.numVertices());
+        AssertTrue(multi.indices == single.indices);
+        AssertTrue(memcmp(multi.vertices.data(), single.vertices.data(),
+                          single.vertices.size() * sizeof(Vertex3UVNorm)) == 0);
+
+        // first quad of the last row: vertices (0,399) (1,399) (1,400) (0,400)
+        const int last = (int)single.indices.size() - 400*6;
+        AssertThat(single.indices[last + 0], index_t(399*401));
+        AssertThat(single.indices[last + 2], index_t(400*401 + 1));
+        AssertThat(single.vertices[400*401 + 1].y, 400.5f);
+    }
+
+    template<class T> static void Put(string& out, T value)
+    {
+        out.append((const char*)&value, sizeof(T));
+    }
+
+    TestCase(ply_binary_bulk_copy_and_faces)
+    {
+        string ply =
+            "ply\n"
+            "format binary_little_endian 1.0\n"
+            "element vertex 4\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "property float u\nproperty float v\n"
+            "property float nx\nproperty float ny\nproperty float nz\n"
+            "element face 1\n"
+            "property list uchar int vertex_indices\n"
+            "end_header\n";
+        const float verts[4][8] = {
+            { 0, 0, 0,  0, 0,  0, 0, 1 },
+            { 1, 0, 0,  1, 0,  0, 0, 1 },
+            { 1, 1, 0,  1, 1,  0, 0, 1 },
+            { 0, 1, 0,  0, 1,  0, 0, 1 },
+        };
+        for (const auto& v : verts)
+            for (float f : v) Put(ply, f);
+        Put<uint8_t>(ply, 4);
+        for (int i : { 0, 1, 2, 3 }) Put<int32_t>(ply, i);
+
+        ImportedMesh mesh;
+        AssertTrue(MeshImporter::loadPly(ply.data(), ply.size(), mesh, 2));
+        AssertTrue(mesh.hasCoords);
+        AssertTrue(mesh.hasNormals);
+        AssertThat(mesh.numVertices(), 4);
+        AssertThat(mesh.numTriangles(), 2);
+        AssertThat(mesh.vertices[2].u, 1.0f);
+        AssertThat(mesh.vertices[3].y, 1.0f);
+        AssertThat(mesh.indices[5], 3u);
+    }
+
+    TestCase(ply_binary_converted_colors)
+    {
+        string ply =
+            "ply\n"
+            "format binary_little_endian 1.0\n"
+            "element vertex 2\n"
+            "property double x\nproperty double y\nproperty double z\n"
+            "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+            "end_header\n";
+        Put(ply, 1.0); Put(ply, 2.0); Put(ply, 3.0); Put<uint8_t>(ply, 255); Put<uint8_t>(ply, 0);   Put<uint8_t>(ply, 0);
+        Put(ply, 4.0); Put(ply, 5.0); Put(ply, 6.0); Put<uint8_t>(ply, 0);   Put<uint8_t>(ply, 255); Put<uint8_t>(ply, 0);
+
+        ImportedMesh mesh;
+        AssertTrue(MeshImporter::loadPly(ply.data(), ply.size(), mesh, 2));
+        AssertTrue(mesh.hasColors);
+        AssertThat(mesh.mode(), DrawPoints);
+        AssertThat(mesh.colorVertices[1].z, 6.0f);
+        AssertThat(mesh.colorVertices[1].g, 1.0f);
+        AssertThat(mesh.colorVertices[0].g, 0.0f);
+    }
+
+    TestCase(ply_malformed_headers_are_rejected)
+    {
+        const char noProperties[] =
+            "ply\nformat binary_little_endian 1.0\nelement vertex 3\nend_header\n";
+        const char hugeCount[] =
+            "ply\nformat binary_little_endian 1.0\nelement vertex 4000000000\n"
+            "property float x\nproperty float y\nproperty float z\nend_header\n0123456789ab";
+        ImportedMesh mesh;
+        AssertFalse(MeshImporter::loadPly(noProperties, sizeof(noProperties) - 1, mesh, 1));
+        AssertFalse(MeshImporter::loadPly(hugeCount, sizeof(hugeCount) - 1, mesh, 1));
+    }
+
+    TestCase(obj_malformed_faces_are_rejected)
+    {
+        const char zeroPosition[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 0 2 3\n";
+        const char zeroPositionWithCoord[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nf 1/1 0/1 3/1\n";
+        const char outOfRange[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n";
+        const char absentCoord[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1//1 2//1 3//1\n";
+        ImportedMesh mesh;
+        AssertFalse(MeshImporter::loadObj(zeroPosition, sizeof(zeroPosition) - 1, mesh, 1));
+        AssertFalse(MeshImporter::loadObj(zeroPositionWithCoord, sizeof(zeroPositionWithCoord) - 1, mesh, 1));
+        AssertFalse(MeshImporter::loadObj(outOfRange, sizeof(outOfRange) - 1, mesh, 1));
+        AssertTrue(MeshImporter::loadObj(absentCoord, sizeof(absentCoord) - 1, mesh, 1)); // 0 vt is just absent
+        AssertFalse(mesh.hasCoords);
+        AssertTrue(mesh.hasNormals);
+    }
+};
@@ -0,0 +1,140 @@
+#include <AGL/MeshOptimizer.h>
+#include <rpp/tests.h>
+using namespace AGL;
+
+TestImpl(test_mesh_optimizer)
+{
+    vector<Vertex3Color> Vertices;
+    vector<index_t> Indices;
+
+    TestInit(test_mesh_optimizer)
+    {
+    }
+
+    // regular N*N quad grid with its triangles in scrambled order
+    void CreateScrambledGrid(int n)
+    {
+        Vertices.clear();
+        Indices.clear();
+        for (int y = 0; y <= n; ++y)
+            for (int x = 0; x <= n; ++x)
+                Vertices.push_back({ (float)x, (float)y, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f });
+
+        for (int y = 0; y < n; ++y)
+        {
+            for (int x = 0; x < n; ++x)
+            {
+                index_t a = y*(n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+                Indices.insert(Indices.end(), { a, b, c,  b, d, c });
+            }
+        }
+
+        const int numTriangles = (int)Indices.size() / 3;
+        for (int t = 0; t < numTriangles; ++t)
+        {
+            int other = (t * 7919) % numTriangles;
+            for (int k = 0; k < 3; ++k)
+                std::swap(Indices[t*3 + k], Indices[other*3 + k]);
+        }
+    }
+
+    // sum of vertex positions of all triangles, reordering must keep this intact
+    Vector3 TriangleSum() const
+    {
+        Vector3 sum = { 0.0f, 0.0f, 0.0f };
+        for (index_t i : Indices)
+        {
+            sum.x += Vertices[i].x;
+            sum.y += Vertices[i].y;
+        }
+        return sum;
+    }
+
+    TestCase(vertex_cache_improves_acmr)
+    {
+        CreateScrambledGrid(64);
+        Vector3 sumBefore = TriangleSum();
+
+        MeshOptimizeStats stats = MeshOptimizer::optimize(Vertices, Indices);
+        AssertLess(stats.after.acmr, stats.before.acmr);
+        AssertLess(stats.after.acmr, 1.0f);
+        AssertLess(stats.after.atvr, 1.5f);
+        AssertThat((int)Indices.size(), 64*64*6);
+
+        Vector3 sumAfter = TriangleSum();
+        AssertThat(sumAfter.x, sumBefore.x);
+        AssertThat(sumAfter.y, sumBefore.y);
+    }
+
+    TestCase(vertex_fetch_removes_unused)
+    {
+        CreateScrambledGrid(8);
+        Vertices.push_back({ 100.0f, 100.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f }); // unreferenced
+
+        MeshOptimizeStats stats = MeshOptimizer::optimize(Vertices, Indices, OptimizeVertexFetch);
+        AssertThat(stats.verticesBefore, 9*9 + 1);
+        AssertThat(stats.verticesAfter,  9*9);
+        AssertThat(Indices.front(), 0u); // first-use order
+    }
+
+    TestCase(empty_mesh_is_unchanged)
+    {
+        vector<Vertex3Color> vertices;
+        vector<index_t> indices;
+        MeshOptimizeStats stats = MeshOptimizer::optimize(vertices, indices);
+        AssertThat(stats.verticesBefore, 0);
+        AssertThat(stats.verticesAfter, 0);
+        AssertTrue(vertices.empty());
+        AssertTrue(indices.empty());
+    }
+
+    TestCase(weld_merges_duplicates)
+    {
+        Vertices = {
+            { 0.0f, 0.0f,  0.0f,  1.0f, 1.0f, 1.0f, 1.0f },
+            { 1.0f, 0.0f,  0.0f,  1.0f, 1.0f, 1.0f, 1.0f },
+            { 0.0f, 1.0f,  0.0f,  1.0f, 1.0f, 1.0f, 1.0f },
+            { 1.0f, 0.0f, -0.0f,  1.0f, 1.0f, 1.0f, 1.0f }, // exact duplicate of 1
+            { 0.0f, 1.0001f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f }, // duplicate of 2 within epsilon
+            { 1.0f, 1.0f,  0.0f,  1.0f, 1.0f, 1.0f, 1.0f },
+        };
+        Indices = { 0, 1, 2,  3, 5, 4 };
+
+        AssertThat(MeshOptimizer::weldVertices(Vertices, Indices), 5);
+        AssertThat(Indices[3], 1u);
+
+        AssertThat(MeshOptimizer::weldVertices(Vertices, Indices, 0.001f), 4);
+        AssertThat(Indices[5], 2u);
+        AssertThat(Indices[4], 3u);
+    }
+
+    TestCase(simplify_flat_grid_is_lossless)
+    {
+        CreateScrambledGrid(32);
+        vector<index_t> simplified;
+        float error = MeshOptimizer::simplify(Indices.data(), (int)Indices.size(), &Vertices[0].x,
+                                              sizeof(Vertex3Color), (int)Vertices.size(),
+                                              (int)Indices.size() / 4, FLT_MAX, simplified);
+        AssertLess((int)simplified.size(), (int)Indices.size() / 4 + 1);
+        AssertLess(error, 0.0001f);
+        AssertThat((int)simplified.size() % 3, 0);
+    }
+
+    TestCase(generate_lods_appends_coarser_levels)
+    {
+        CreateScrambledGrid(32);
+        const int fullIndices = (int)Indices.size();
+        vector<MeshLod> lods = MeshOptimizer::generateLods(Indices, &Vertices[0].x, sizeof(Vertex3Color),
+                                                           (int)Vertices.size(), 3);
+        AssertLess(1, (int)lods.size());
+        AssertThat((int)lods[0].firstIndex, 0);
+        AssertThat((int)lods[0].numIndices, fullIndices);
+        for (size_t i = 1; i < lods.size(); ++i)
+        {
+            AssertLess(lods[i].numIndices, lods[i-1].numIndices);
+            AssertThat(lods[i].firstIndex, lods[i-1].firstIndex + lods[i-1].numIndices);
+        }
+        const MeshLod& last = lods.back();
+        AssertThat((int)Indices.size(), (int)(last.firstIndex + last.numIndices));
+    }
+};
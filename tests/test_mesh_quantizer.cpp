@@ -0,0 +1,142 @@
+#include <AGL/MeshQuantizer.h>
+#include <rpp/tests.h>
+#include <random>
+#include <cmath>
+using namespace AGL;
+
+TestImpl(test_mesh_quantizer)
+{
+    TestInit(test_mesh_quantizer)
+    {
+    }
+
+    TestCase(half_float_special_values)
+    {
+        AssertThat(toHalf(0.0f), (uint16_t)0x0000);
+        AssertThat(toHalf(-0.0f), (uint16_t)0x8000);
+        AssertThat(toHalf(1.0f), (uint16_t)0x3C00);
+        AssertThat(toHalf(-1.0f), (uint16_t)0xBC00);
+        AssertThat(toHalf(65504.0f), (uint16_t)0x7BFF); // largest finite half
+        AssertThat(toHalf(65520.0f), (uint16_t)0x7C00); // rounds up to Inf
+        AssertThat(toHalf(INFINITY), (uint16_t)0x7C00);
+        AssertThat(toHalf(-INFINITY), (uint16_t)0xFC00);
+        AssertThat(fromHalf(0x3C00), 1.0f);
+        AssertThat(fromHalf(0xBC00), -1.0f);
+        AssertTrue(std::isinf(fromHalf(0x7C00)) && fromHalf(0x7C00) > 0.0f);
+        AssertTrue(std::isinf(fromHalf(0xFC00)) && fromHalf(0xFC00) < 0.0f);
+
+        const uint16_t nan = toHalf(NAN);
+        AssertThat(nan & 0x7C00, 0x7C00);
+        AssertTrue((nan & 0x03FF) != 0);
+        AssertTrue(std::isnan(fromHalf(nan)));
+
+        // subnormals: 2^-24 is the smallest half, 2^-15 has only the top mantissa bit
+        AssertThat(toHalf(ldexpf(1.0f, -24)), (uint16_t)0x0001);
+        AssertThat(fromHalf(0x0001), ldexpf(1.0f, -24));
+        AssertThat(toHalf(ldexpf(1.0f, -15)), (uint16_t)0x0200);
+        AssertThat(fromHalf(0x8200), -ldexpf(1.0f, -15));
+        AssertThat(toHalf(ldexpf(1.0f, -26)), (uint16_t)0x0000); // underflows to zero
+    }
+
+    TestCase(half_float_roundtrip)
+    {
+        // every finite half and infinity survives the conversion to float and back
+        int mismatches = 0;
+        for (uint32_t h = 0; h <= 0xFFFF; ++h)
+        {
+            if ((h & 0x7C00) == 0x7C00 && (h & 0x03FF)) // NaN payloads are not preserved
+                continue;
+            if (toHalf(fromHalf((uint16_t)h)) != h)
+                ++mismatches;
+        }
+        AssertThat(mismatches, 0);
+
+        // rounding error of normal values is at most half an ulp, 2^-11 relative
+        std::mt19937 rng { 42 };
+        std::uniform_real_distribution<float> dist { -1000.0f, 1000.0f };
+        for (int i = 0; i < 10'000; ++i)
+        {
+            const float f = dist(rng);
+            const float err = fabsf(fromHalf(toHalf(f)) - f);
+            AssertTrue(err <= fabsf(f) * (1.0f / 2048.0f));
+        }
+    }
+
+    TestCase(packed_normals_angular_error)
+    {
+        // 10-bit SNORM components are off by at most 0.5/511, which is ~0.1 degrees
+        const float maxAngle = 0.25f * rpp::PIf / 180.0f;
+        std::mt19937 rng { 7 };
+        std::normal_distribution<float> dist;
+        float worst = 0.0f;
+        for (int i = 0; i < 10'000; ++i)
+        {
+            Vector3 n = { dist(rng), dist(rng), dist(rng) };
+            const float len = sqrtf(n.x*n.x + n.y*n.y + n.z*n.z);
+            if (len < 1e-3f) continue;
+            n = { n.x / len, n.y / len, n.z / len };
+
+            const Vector3 u = unpackNormal(packNormal(n));
+            const float ulen = sqrtf(u.x*u.x + u.y*u.y + u.z*u.z);
+            const float cosAngle = std::min(1.0f, (u.x*n.x + u.y*n.y + u.z*n.z) / ulen);
+            worst = std::max(worst, acosf(cosAngle));
+        }
+        AssertTrue(worst < maxAngle);
+
+        // axis aligned normals are exact, w stays 0
+        const uint32_t up = packNormal({ 0.0f, 1.0f, 0.0f });
+        AssertThat(up >> 30, 0u);
+        const Vector3 u = unpackNormal(up);
+        AssertThat(u.x, 0.0f);
+        AssertThat(u.y, 1.0f);
+        AssertThat(u.z, 0.0f);
+        AssertThat(unpackNormal(packNormal({ 0.0f, 0.0f, -1.0f })).z, -1.0f);
+    }
+
+    TestCase(quantized_positions_stay_in_bounds)
+    {
+        // flat in z, so one axis has a zero extent
+        std::mt19937 rng { 3 };
+        std::uniform_real_distribution<float> x { -50.0f, 20.0f }, y { 100.0f, 101.0f };
+        vector<Vertex3UVNorm> verts(2'000);
+        for (Vertex3UVNorm& v : verts)
+            v = { x(rng), y(rng), 5.0f, 0.25f, 0.75f, 0.0f, 0.0f, 1.0f };
+        vector<index_t> indices;
+        for (index_t i = 0; i + 2 < (index_t)verts.size(); i += 3)
+            indices.insert(indices.end(), { i, i + 1, i + 2 });
+        const vector<index_t> original = indices;
+
+        QuantizedPositions q;
+        vector<Vertex3UVNormQuantized> out = MeshQuantizer::quantize(verts, q);
+        AssertThat(out.size(), verts.size());
+        AssertTrue(indices == original); // index buffers are shared as they are
+        AssertThat(q.Scale.z, 0.0f);
+        AssertThat(q.Offset.z, 5.0f);
+
+        Vector3 min = { 1e30f, 1e30f, 1e30f }, max = { -1e30f, -1e30f, -1e30f };
+        for (const Vertex3UVNorm& v : verts)
+        {
+            min = { std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z) };
+            max = { std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z) };
+        }
+
+        const Vector3 tolerance = { q.Scale.x / 32767.0f, q.Scale.y / 32767.0f, 0.0f };
+        for (index_t i : indices)
+        {
+            const Vertex3UVNormQuantized& o = out[i];
+            const Vector3 p = {
+                o.x / 32767.0f * q.Scale.x + q.Offset.x,
+                o.y / 32767.0f * q.Scale.y + q.Offset.y,
+                o.z / 32767.0f * q.Scale.z + q.Offset.z,
+            };
+            AssertTrue(p.x >= min.x - tolerance.x && p.x <= max.x + tolerance.x);
+            AssertTrue(p.y >= min.y - tolerance.y && p.y <= max.y + tolerance.y);
+            AssertThat(p.z, 5.0f);
+            AssertTrue(fabsf(p.x - verts[i].x) <= tolerance.x);
+            AssertTrue(fabsf(p.y - verts[i].y) <= tolerance.y);
+            AssertThat(o.w, (int16_t)0);
+            AssertThat(fromHalf(o.u), 0.25f);
+            AssertThat(fromHalf(o.v), 0.75f);
+        }
+    }
+};
@@ -0,0 +1,131 @@
+#include <AGL/PointCloud.h>
+#include <rpp/file_io.h>
+#include <rpp/tests.h>
+#include <random>
+using namespace AGL;
+
+TestImpl(test_point_cloud)
+{
+    static constexpr const char* Path = "test_point_cloud.aglpoints";
+
+    TestInit(test_point_cloud)
+    {
+    }
+
+    static vector<Vertex3ColorPacked> RandomPoints(int count)
+    {
+        std::mt19937 rng { 1234 };
+        std::uniform_real_distribution<float> x { -10.0f, 30.0f };
+        std::uniform_real_distribution<float> y { 0.0f, 5.0f };
+        std::uniform_real_distribution<float> z { -2.0f, 2.0f };
+        vector<Vertex3ColorPacked> points(count);
+        for (int i = 0; i < count; ++i)
+            points[i] = { x(rng), y(rng), z(rng), uint8_t(i), 128, 255, 255 };
+        return points;
+    }
+
+    static bool Inside(const Vertex3ColorPacked& p, const PointCloudNode& n)
+    {
+        const float* xyz = &p.x;
+        for (int d = 0; d < 3; ++d)
+            if (fabsf(xyz[d] - n.center[d]) > n.halfSize) return false;
+        return true;
+    }
+
+    TestCase(build_open_octree)
+    {
+        const int numPoints = 20'000;
+        const int maxNodePoints = 500;
+        vector<Vertex3ColorPacked> points = RandomPoints(numPoints);
+        AssertTrue(PointCloudFile::build(Path, points, maxNodePoints));
+
+        PointCloudFile cloud;
+        AssertTrue(cloud.open(Path));
+        const PointCloudHeader& h = cloud.header();
+        AssertThat(h.numPoints, (uint64_t)numPoints);
+        AssertThat(h.maxNodePoints, (uint32_t)maxNodePoints);
+        AssertTrue(cloud.numNodes() > numPoints / maxNodePoints);
+
+        float min[3] = { +1e30f, +1e30f, +1e30f }, max[3] = { -1e30f, -1e30f, -1e30f };
+        for (const Vertex3ColorPacked& p : points)
+        {
+            const float* xyz = &p.x;
+            for (int d = 0; d < 3; ++d) {
+                min[d] = std::min(min[d], xyz[d]);
+                max[d] = std::max(max[d], xyz[d]);
+            }
+        }
+        for (int d = 0; d < 3; ++d)
+        {
+            AssertThat(h.boundsMin[d], min[d]);
+            AssertThat(h.boundsMax[d], max[d]);
+        }
+
+        // every point is stored exactly once, inside the cube of its node
+        uint64_t stored = 0;
+        int children = 0;
+        for (int i = 0; i < cloud.numNodes(); ++i)
+        {
+            const PointCloudNode& n = cloud.node(i);
+            AssertTrue(n.numPoints <= (uint32_t)maxNodePoints);
+            stored += n.numPoints;
+            const Vertex3ColorPacked* p = cloud.points(n);
+            for (uint32_t k = 0; k < n.numPoints; ++k)
+                AssertTrue(Inside(p[k], n));
+            for (uint32_t child : n.children)
+                if (child) {
+                    ++children;
+                    AssertThat(cloud.node(child).level, n.level + 1);
+                }
+        }
+        AssertThat(stored, (uint64_t)numPoints);
+        AssertThat(children, cloud.numNodes() - 1); // every node but the root has one parent
+        cloud.close();
+        rpp::delete_file(Path);
+    }
+
+    TestCase(corrupted_node_links_are_rejected)
+    {
+        vector<Vertex3ColorPacked> points = RandomPoints(5'000);
+        AssertTrue(PointCloudFile::build(Path, points, 500));
+
+        rpp::load_buffer file = rpp::file::read_all(string{Path});
+        AssertTrue((bool)file);
+        vector<uint8_t> data { file.str, file.str + file.len };
+        const PointCloudHeader& h = *(const PointCloudHeader*)data.data();
+        PointCloudNode* nodes = (PointCloudNode*)(data.data() + h.nodesOffset);
+        const uint32_t numNodes = h.numNodes;
+
+        // find a grandchild of the root, its parent is an ancestor with a non-zero index
+        uint32_t parent = 0, leaf = 0;
+        for (uint32_t child : nodes[0].children)
+            for (uint32_t i = 0; child && !leaf && i < 8; ++i)
+                if ((leaf = nodes[child].children[i]) != 0) parent = child;
+        AssertTrue(leaf != 0);
+
+        auto writeAndOpen = [&]() {
+            {
+                rpp::file f { string{Path}, rpp::CREATENEW };
+                f.write(data.data(), (int)data.size());
+            }
+            PointCloudFile cloud;
+            return cloud.open(Path);
+        };
+        AssertTrue(writeAndOpen()); // unmodified copy is valid
+
+        PointCloudNode& node = nodes[leaf];
+        const uint32_t original = node.children[0];
+        node.children[0] = parent; // cycle through an ancestor
+        AssertFalse(writeAndOpen());
+
+        node.children[0] = leaf; // self loop
+        AssertFalse(writeAndOpen());
+
+        node.children[0] = numNodes; // out of range
+        AssertFalse(writeAndOpen());
+
+        node.children[0] = original;
+        AssertTrue(writeAndOpen());
+        rpp::delete_file(Path);
+    }
+};
@@ -0,0 +1,116 @@
+#include <AGL/MeshArena.h>
+#include <rpp/tests.h>
+using namespace AGL;
+
+TestImpl(test_range_allocator)
+{
+    TestInit(test_range_allocator)
+    {
+    }
+
+    TestCase(released_ranges_are_coalesced)
+    {
+        RangeAllocator alloc;
+        alloc.reset(100, 0);
+        const int a = alloc.allocate(10);
+        const int b = alloc.allocate(20);
+        const int c = alloc.allocate(30);
+        AssertThat(a, 0);
+        AssertThat(b, 10);
+        AssertThat(c, 30);
+        AssertThat(alloc.used(), 60);
+        AssertThat(alloc.freeRanges(), 1);
+        AssertFalse(alloc.fragmented());
+
+        alloc.release(a, 10);
+        AssertThat(alloc.freeRanges(), 2);
+        AssertTrue(alloc.fragmented());
+
+        alloc.release(c, 30); // merges with the free tail
+        AssertThat(alloc.freeRanges(), 2);
+        AssertThat(alloc.largestFree(), 70);
+
+        alloc.release(b, 20); // merges with both neighbours
+        AssertThat(alloc.freeRanges(), 1);
+        AssertThat(alloc.largestFree(), 100);
+        AssertThat(alloc.used(), 0);
+        AssertFalse(alloc.fragmented());
+    }
+
+    TestCase(allocate_picks_the_best_fit)
+    {
+        RangeAllocator alloc;
+        alloc.reset(100, 0);
+        const int a = alloc.allocate(30);
+        alloc.allocate(10);
+        const int c = alloc.allocate(8);
+        alloc.allocate(10);
+        alloc.release(a, 30);
+        alloc.release(c, 8);
+
+        AssertThat(alloc.allocate(8), c);   // exact fit in the small hole
+        AssertThat(alloc.allocate(20), a);  // smallest hole that is large enough
+        AssertThat(alloc.allocate(60), -1); // nothing this large is free
+        AssertThat(alloc.used(), 48);
+    }
+
+    TestCase(grow_adds_free_space_to_the_end)
+    {
+        RangeAllocator alloc;
+        alloc.reset(16, 16);
+        AssertThat(alloc.allocate(1), -1);
+
+        alloc.grow(64);
+        AssertThat(alloc.capacity(), 64);
+        AssertThat(alloc.used(), 16);
+        AssertThat(alloc.allocate(48), 16);
+
+        // a free tail is merged with the grown space
+        alloc.release(40, 24);
+        alloc.grow(128);
+        AssertThat(alloc.freeRanges(), 1);
+        AssertThat(alloc.largestFree(), 88);
+        alloc.grow(32); // never shrinks
+        AssertThat(alloc.capacity(), 128);
+    }
+
+    TestCase(compact_preserves_live_ranges)
+    {
+        // `memory` stands in for the pool buffer, every range is filled with its own id
+        RangeAllocator alloc;
+        alloc.reset(64, 0);
+        vector<int> memory(64, -1);
+        int offsets[6], counts[6] = { 5, 7, 3, 9, 4, 6 };
+        for (int i = 0; i < 6; ++i)
+        {
+            offsets[i] = alloc.allocate(counts[i]);
+            std::fill(&memory[offsets[i]], &memory[offsets[i]] + counts[i], i);
+        }
+        alloc.release(offsets[1], counts[1]);
+        alloc.release(offsets[4], counts[4]);
+        AssertTrue(alloc.fragmented());
+
+        const int live[4] = { 0, 2, 3, 5 };
+        int liveCounts[4], newOffsets[4];
+        for (int i = 0; i < 4; ++i)
+            liveCounts[i] = counts[live[i]];
+        alloc.compact(liveCounts, 4, newOffsets);
+
+        vector<int> compacted(64, -1);
+        for (int i = 0; i < 4; ++i)
+            std::copy(&memory[offsets[live[i]]], &memory[offsets[live[i]]] + liveCounts[i], &compacted[newOffsets[i]]);
+
+        AssertFalse(alloc.fragmented());
+        AssertThat(alloc.used(), 5 + 3 + 9 + 6);
+        AssertThat(alloc.largestFree(), 64 - alloc.used());
+        int expected = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            AssertThat(newOffsets[i], expected);
+            for (int k = 0; k < liveCounts[i]; ++k)
+                AssertThat(compacted[newOffsets[i] + k], live[i]);
+            expected += liveCounts[i];
+        }
+        AssertThat(alloc.allocate(1), expected); // new allocations go right after the live ranges
+    }
+};